@@ -0,0 +1,984 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "alu.h"
+#include "batch_simulator.h"
+#include "commands.h"
+#include "configs_loader.h"
+#include "executor.h"
+#include "jit.h"
+#include "listing_generator.h"
+#include "program_cache.h"
+#include "simulator.h"
+#include "simulator_daemon.h"
+#include "threaded_code.h"
+
+// Micro-benchmarks for simulator_lib. Every figure printed is also recorded as a
+// metric so --json can write a machine-readable report for comparing builds.
+
+struct BenchConfigs {
+    Config<std::string> json_file{
+        "json_file",
+        nullptr,
+        "--json",
+        "Write all metrics as JSON to this path",
+        false,
+        ""
+    };
+
+    Config<std::string> generate_file{
+        "generate_file",
+        nullptr,
+        "--generate",
+        "Write a generated listing to this path and exit",
+        false,
+        ""
+    };
+
+    Config<int> lines{
+        "lines",
+        nullptr,
+        "--lines",
+        "Length of the generated listing",
+        false,
+        100000
+    };
+
+    Config<int> seed{
+        "seed",
+        nullptr,
+        "--seed",
+        "Seed for the generated listing",
+        false,
+        8086
+    };
+
+    auto get_all_configs() {
+        return std::tie(json_file, generate_file, lines, seed);
+    }
+
+    auto get_all_configs() const {
+        return std::tie(json_file, generate_file, lines, seed);
+    }
+};
+
+namespace {
+
+constexpr size_t ALU_SAMPLE_COUNT = 1 << 16;
+constexpr int ALU_REPEATS = 64;
+
+// Results are folded into this so the optimizer cannot drop the measured work
+volatile uint32_t g_sink;
+
+struct Metric {
+    std::string name;
+    double value;
+    const char* unit;
+};
+
+std::vector<Metric> g_metrics;
+
+void record(std::string name, double value, const char* unit) {
+    g_metrics.push_back({std::move(name), value, unit});
+}
+
+template <typename F>
+double seconds_for(F&& work) {
+    auto start = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct OperandPair {
+    uint16_t a;
+    uint16_t b;
+};
+
+// xorshift32, so runs are reproducible across builds
+uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+std::vector<OperandPair> make_operands(uint32_t seed) {
+    std::vector<OperandPair> pairs(ALU_SAMPLE_COUNT);
+    for (auto& pair : pairs) {
+        uint32_t r = next_random(seed);
+        pair = {static_cast<uint16_t>(r), static_cast<uint16_t>(r >> 16)};
+    }
+    return pairs;
+}
+
+const char* kernel_name(AluKernel kernel) {
+    return kernel == AluKernel::Table ? "table" : "reference";
+}
+
+// Both kernels must agree on every 8-bit pair and on a 16-bit sample
+bool verify_alu_kernels(const std::vector<OperandPair>& pairs) {
+    for (FlagsOp op : {FlagsOp::Add, FlagsOp::Sub}) {
+        for (unsigned a = 0; a < 256; ++a) {
+            for (unsigned b = 0; b < 256; ++b) {
+                AluResult ref = alu_execute(AluKernel::Reference, op, static_cast<uint16_t>(a), static_cast<uint16_t>(b), true);
+                AluResult tab = alu_execute(AluKernel::Table, op, static_cast<uint16_t>(a), static_cast<uint16_t>(b), true);
+                if (ref.value != tab.value || ref.flags != tab.flags) {
+                    std::printf("ALU mismatch (8-bit) a=%u b=%u\n", a, b);
+                    return false;
+                }
+            }
+        }
+        for (const auto& pair : pairs) {
+            AluResult ref = alu_execute(AluKernel::Reference, op, pair.a, pair.b, false);
+            AluResult tab = alu_execute(AluKernel::Table, op, pair.a, pair.b, false);
+            if (ref.value != tab.value || ref.flags != tab.flags) {
+                std::printf("ALU mismatch (16-bit) a=%u b=%u\n", pair.a, pair.b);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+double bench_alu(AluKernel kernel, FlagsOp op, bool is_8bit, const std::vector<OperandPair>& pairs) {
+    uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < ALU_REPEATS; ++repeat) {
+        for (const auto& pair : pairs) {
+            AluResult result = alu_execute(kernel, op, pair.a, pair.b, is_8bit);
+            sink += result.value ^ result.flags;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    g_sink = sink;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (static_cast<double>(pairs.size()) * ALU_REPEATS);
+}
+
+bool run_alu_benchmarks() {
+    std::vector<OperandPair> pairs = make_operands(0x8086);
+    if (!verify_alu_kernels(pairs)) {
+        return false;
+    }
+
+    std::printf("ALU kernels (ns/op)\n");
+    for (AluKernel kernel : {AluKernel::Reference, AluKernel::Table}) {
+        for (bool is_8bit : {true, false}) {
+            double add_ns = bench_alu(kernel, FlagsOp::Add, is_8bit, pairs);
+            double sub_ns = bench_alu(kernel, FlagsOp::Sub, is_8bit, pairs);
+            std::printf("  %-9s %2d-bit  add %6.2f  sub/cmp %6.2f\n",
+                        kernel_name(kernel), is_8bit ? 8 : 16, add_ns, sub_ns);
+            std::string prefix = std::string("alu.") + kernel_name(kernel) + (is_8bit ? ".8bit" : ".16bit");
+            record(prefix + ".add", add_ns, "ns/op");
+            record(prefix + ".sub", sub_ns, "ns/op");
+        }
+    }
+    return true;
+}
+
+constexpr size_t BATCH_LANES = 1 << 16;
+constexpr size_t BATCH_PROGRAM_LENGTH = 64;
+constexpr int BATCH_REPEATS = 8;
+constexpr size_t BATCH_VERIFY_STRIDE = 61;
+
+// Register/immediate mov/add/sub/cmp mix with both operand widths
+Program make_random_alu_program(uint32_t seed, size_t length) {
+    static constexpr Opcode OPCODES[] = {Opcode::Mov, Opcode::Add, Opcode::Sub, Opcode::Cmp};
+
+    Program program;
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t r = next_random(seed);
+        bool is_8bit = (r & 1) != 0;
+        bool src_is_immediate = (r & 2) != 0;
+        auto pick = [&](uint32_t bits) {
+            return is_8bit ? static_cast<RegisterId>(static_cast<size_t>(RegisterId::AL) + bits % 8)
+                           : static_cast<RegisterId>(bits % REGISTER16_COUNT);
+        };
+
+        Instruction instr{};
+        instr.opcode = OPCODES[(r >> 2) & 3];
+        instr.width = is_8bit ? OperandWidth::Byte : OperandWidth::Word;
+        instr.dest_kind = OperandKind::Register;
+        instr.dest = pick(r >> 4);
+        instr.src_kind = src_is_immediate ? OperandKind::Immediate : OperandKind::Register;
+        instr.src = src_is_immediate ? RegisterId::None : pick(r >> 8);
+        instr.immediate = static_cast<uint16_t>(is_8bit ? (r >> 16) & 0xFF : r >> 16);
+        instr.ea = EffectiveAddress::None;
+        instr.segment = RegisterId::None;
+
+        ProgramLine line;
+        line.line_number = static_cast<int>(i + 1);
+        line.display = program.keep(format_instruction(instr));
+        line.has_expected = false;
+
+        program.instructions.push_back(instr);
+        program.lines.push_back(std::move(line));
+    }
+    program.threaded = thread_instructions(program.instructions);
+    return program;
+}
+
+// Every register a listing may name as an operand: both widths and the segment registers
+constexpr RegisterId RANDOM_OPERANDS[] = {
+    RegisterId::AX, RegisterId::BX, RegisterId::CX, RegisterId::DX, RegisterId::SI, RegisterId::DI,
+    RegisterId::BP, RegisterId::SP, RegisterId::AL, RegisterId::AH, RegisterId::BL, RegisterId::BH,
+    RegisterId::CL, RegisterId::CH, RegisterId::DL, RegisterId::DH, RegisterId::ES, RegisterId::CS,
+    RegisterId::SS, RegisterId::DS,
+};
+
+// Random mov/add/sub/cmp lines compiled as a listing would be. Destination and
+// source are drawn independently, so every operand form comes up and the program
+// holds exactly the ones try_compile_command accepts.
+Program make_random_compiled_program(uint32_t seed, size_t length) {
+    static constexpr Opcode OPCODES[] = {Opcode::Mov, Opcode::Add, Opcode::Sub, Opcode::Cmp};
+
+    Program program;
+    while (program.instructions.size() < length) {
+        uint32_t r = next_random(seed);
+        bool src_is_immediate = (r & 1) != 0;
+        std::string_view dest = register_name(RANDOM_OPERANDS[(r >> 3) % std::size(RANDOM_OPERANDS)]);
+        std::string source = src_is_immediate ? std::to_string(r >> 16)
+                                              : register_name(RANDOM_OPERANDS[(r >> 8) % std::size(RANDOM_OPERANDS)]);
+        std::string_view operands[2] = {dest, source};
+
+        Instruction instr;
+        std::string_view fault;
+        if (try_compile_command(OPCODES[(r >> 1) & 3], operands, 2, instr, fault) != SimStatus::Ok) continue;
+
+        ProgramLine line;
+        line.line_number = static_cast<int>(program.instructions.size() + 1);
+        line.display = program.keep(format_instruction(instr));
+        line.has_expected = false;
+
+        program.instructions.push_back(instr);
+        program.lines.push_back(std::move(line));
+    }
+    program.threaded = thread_instructions(program.instructions);
+    return program;
+}
+
+Registers make_random_registers(uint32_t& seed) {
+    Registers regs;
+    for (size_t slot = 0; slot < REGISTER16_COUNT; ++slot) {
+        regs.write(word_register_id(slot), static_cast<uint16_t>(next_random(seed)));
+    }
+    regs.flags.value = static_cast<uint16_t>(next_random(seed) & ARITHMETIC_FLAGS_MASK);
+    return regs;
+}
+
+const char* batch_kernel_name(BatchKernel kernel) {
+    switch (kernel) {
+        case BatchKernel::Scalar: return "scalar";
+        case BatchKernel::Sse2: return "sse2";
+        case BatchKernel::Avx2: return "avx2";
+        default: return "auto";
+    }
+}
+
+bool same_state(const Registers& a, const Registers& b) {
+    for (size_t slot = 0; slot < WORD_REGISTER_COUNT; ++slot) {
+        if (a.read(word_register_id(slot)) != b.read(word_register_id(slot))) return false;
+    }
+    return a.resolved_flags().value == b.resolved_flags().value;
+}
+
+// Runs the program per lane through the scalar executor and compares a sample of lanes
+bool verify_batch(const BatchSimulator& batch, const std::vector<Registers>& initial, const Program& program) {
+    for (size_t lane = 0; lane < initial.size(); lane += BATCH_VERIFY_STRIDE) {
+        Registers expected = initial[lane];
+        for (const auto& instr : program.instructions) {
+            execute_instruction<BenchPolicy>(expected, instr);
+        }
+        if (!same_state(expected, batch.lane_registers(lane))) {
+            std::printf("Batch mismatch on lane %zu\n", lane);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool run_batch_benchmarks() {
+    Program program = make_random_alu_program(0x0047, BATCH_PROGRAM_LENGTH);
+
+    uint32_t seed = 0x1234;
+    std::vector<Registers> initial;
+    initial.reserve(BATCH_LANES);
+    for (size_t lane = 0; lane < BATCH_LANES; ++lane) {
+        initial.push_back(make_random_registers(seed));
+    }
+
+    std::printf("Batch simulation (%zu lanes, %zu instructions)\n", BATCH_LANES, BATCH_PROGRAM_LENGTH);
+    for (BatchKernel kernel : {BatchKernel::Scalar, BatchKernel::Sse2, BatchKernel::Avx2}) {
+        BatchSimulator batch(BATCH_LANES);
+        batch.set_kernel(kernel);
+        if (batch.resolved_kernel() != kernel) {
+            std::printf("  %-6s unavailable\n", batch_kernel_name(kernel));
+            continue;
+        }
+
+        for (size_t lane = 0; lane < BATCH_LANES; ++lane) {
+            batch.set_lane(lane, initial[lane]);
+        }
+        batch.run(program);
+        if (!verify_batch(batch, initial, program)) {
+            return false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < BATCH_REPEATS; ++repeat) {
+            batch.run(program);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double states = static_cast<double>(BATCH_LANES) * BATCH_REPEATS;
+        std::printf("  %-6s %8.2f M states/s  %8.2f M lane-instr/s\n", batch_kernel_name(kernel),
+                    states / seconds / 1e6, states * BATCH_PROGRAM_LENGTH / seconds / 1e6);
+        record(std::string("batch.") + batch_kernel_name(kernel), states / seconds / 1e6, "M states/s");
+    }
+    return true;
+}
+
+constexpr size_t POLICY_PROGRAM_LENGTH = 256;
+constexpr int POLICY_REPEATS = 2000;
+
+// ns per instruction for repeated run_program<Policy> passes. Traced output goes
+// to the buffer and is dropped each pass, so this measures tracing, not the console.
+template <typename Policy>
+double bench_policy(const Program& program, Registers& final_state) {
+    Simulator sim;
+    sim.output().set_buffered(true);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < POLICY_REPEATS; ++repeat) {
+        sim.run_program<Policy>(program);
+        sim.output().clear();
+    }
+    auto end = std::chrono::steady_clock::now();
+    final_state = sim.get_registers();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (static_cast<double>(program.instructions.size()) * POLICY_REPEATS);
+}
+
+bool run_policy_benchmarks() {
+    Program program = make_random_alu_program(0x0009, POLICY_PROGRAM_LENGTH);
+
+    Registers traced_state;
+    Registers bench_state;
+    double traced_ns = bench_policy<TracePolicy>(program, traced_state);
+    double bench_ns = bench_policy<BenchPolicy>(program, bench_state);
+    if (!same_state(traced_state, bench_state)) {
+        std::printf("Execution policies disagree on the final state\n");
+        return false;
+    }
+
+    std::printf("Execution policy (%zu instructions, ns/instr)\n", POLICY_PROGRAM_LENGTH);
+    std::printf("  trace  %8.2f\n", traced_ns);
+    std::printf("  bench  %8.2f\n", bench_ns);
+    record("policy.trace", traced_ns, "ns/instr");
+    record("policy.bench", bench_ns, "ns/instr");
+    return true;
+}
+
+constexpr size_t LOOP_BODY_LENGTH = 15;
+constexpr uint16_t LOOP_ITERATIONS = 20000;
+
+// "mov cx, N" then a random ALU body closed by "loop"
+Program make_loop_program() {
+    Program body = make_random_alu_program(0x0041, LOOP_BODY_LENGTH);
+    Program program;
+
+    Instruction counter{};
+    counter.opcode = Opcode::Mov;
+    counter.width = OperandWidth::Word;
+    counter.dest_kind = OperandKind::Register;
+    counter.dest = RegisterId::CX;
+    counter.src_kind = OperandKind::Immediate;
+    counter.src = RegisterId::None;
+    counter.immediate = LOOP_ITERATIONS;
+    counter.ea = EffectiveAddress::None;
+    counter.segment = RegisterId::None;
+    program.instructions.push_back(counter);
+
+    for (Instruction instr : body.instructions) {
+        // The body must leave the loop counter alone
+        if (instr.dest == RegisterId::CX) instr.dest = RegisterId::DX;
+        if (instr.dest == RegisterId::CL) instr.dest = RegisterId::DL;
+        if (instr.dest == RegisterId::CH) instr.dest = RegisterId::DH;
+        program.instructions.push_back(instr);
+    }
+
+    Instruction loop{};
+    loop.opcode = Opcode::Loop;
+    loop.width = OperandWidth::Byte;
+    loop.ea = EffectiveAddress::None;
+    loop.segment = RegisterId::None;
+    program.instructions.push_back(loop);
+
+    for (size_t i = 0; i < program.instructions.size(); ++i) {
+        ProgramLine line;
+        line.line_number = static_cast<int>(i + 1);
+        line.display = program.keep(format_instruction(program.instructions[i]));
+        line.has_expected = false;
+        program.lines.push_back(std::move(line));
+    }
+    program.lines.back().jump_target = 1;
+    program.threaded = thread_instructions(program.instructions);
+    return program;
+}
+
+// A hot loop; every pass after the first goes block to block through the cached
+// successor links
+bool run_loop_benchmark() {
+    Program program = make_loop_program();
+
+    auto time_policy = [&](auto policy) {
+        using Policy = decltype(policy);
+        Simulator sim;
+        sim.output().set_buffered(true);
+        SimulationResult result;
+        double seconds = seconds_for([&] { result = sim.run_program<Policy>(program); });
+        bool ok = result.errors == 0 && sim.get_registers().cx.value == 0 && sim.blocks().size() == 2;
+        return ok ? seconds * 1e9 / static_cast<double>(result.instructions) : -1.0;
+    };
+
+    double bench_ns = time_policy(BenchPolicy{});
+    double validate_ns = time_policy(ValidatePolicy{});
+    if (bench_ns < 0 || validate_ns < 0) {
+        std::printf("Loop benchmark did not run to completion\n");
+        return false;
+    }
+
+    std::printf("Hot loop (%zu-instruction body x %u, ns/instr)\n  bench    %6.2f\n  validate %6.2f\n",
+                LOOP_BODY_LENGTH + 1, static_cast<unsigned>(LOOP_ITERATIONS), bench_ns, validate_ns);
+    record("loop.bench", bench_ns, "ns/instr");
+    record("loop.validate", validate_ns, "ns/instr");
+    return true;
+}
+
+constexpr uint32_t SEEK_COUNT = 1000;
+
+// Timeline over the hot loop: journaled forward steps, undoing every step, and
+// seeks to random steps, which restore a checkpoint and re-execute the rest
+bool run_timeline_benchmark() {
+    Program program = make_loop_program();
+
+    Simulator reference;
+    reference.output().set_buffered(true);
+    reference.run_program<ValidatePolicy>(program);
+    std::string final_state = reference.get_registers().dump();
+
+    Simulator sim;
+    sim.output().set_buffered(true);
+    std::string initial_state = sim.get_registers().dump();
+    Timeline timeline = sim.timeline(program);
+
+    double forward_seconds = seconds_for([&] { while (timeline.step()) {} });
+    uint64_t total = timeline.current_step();
+    bool ok = sim.get_registers().dump() == final_state;
+
+    double back_seconds = seconds_for([&] { while (timeline.step_back()) {} });
+    ok = ok && sim.get_registers().dump() == initial_state;
+
+    timeline.seek(total);
+    uint32_t state = 0x8086;
+    double seek_seconds = seconds_for([&] {
+        for (uint32_t i = 0; i < SEEK_COUNT; ++i) {
+            state = state * 1103515245u + 12345u;
+            timeline.seek(state % total);
+        }
+    });
+    timeline.seek(total);
+    ok = ok && timeline.finished() && sim.get_registers().dump() == final_state;
+    if (!ok) {
+        std::printf("Timeline state does not match a straight run\n");
+        return false;
+    }
+
+    double forward_ns = forward_seconds * 1e9 / static_cast<double>(total);
+    double back_ns = back_seconds * 1e9 / static_cast<double>(total);
+    double seek_us = seek_seconds * 1e6 / SEEK_COUNT;
+    std::printf("Timeline (%llu steps, checkpoint every %u)\n  step      %8.2f ns\n  step back %8.2f ns\n"
+                "  seek      %8.2f us\n",
+                static_cast<unsigned long long>(total), DEFAULT_CHECKPOINT_INTERVAL, forward_ns, back_ns, seek_us);
+    record("timeline.step", forward_ns, "ns/step");
+    record("timeline.step_back", back_ns, "ns/step");
+    record("timeline.seek", seek_us, "us/seek");
+    return true;
+}
+
+constexpr size_t DAEMON_LISTING_LINES = 16;
+constexpr int DAEMON_RUNS = 2000;
+
+// Per-request cost of a small listing: a new Simulator per run (what a process per
+// listing pays beyond start-up), a pooled one through SimulatorDaemon::run, and the
+// full round trip over the daemon's socket
+bool run_daemon_benchmark() {
+    ListingSpec spec;
+    spec.line_count = DAEMON_LISTING_LINES;
+    std::string listing = generate_listing(spec);
+
+    DaemonRequest request;
+    request.source = DaemonSource::Text;
+    request.program = listing;
+
+    double fresh = seconds_for([&] {
+        for (int run = 0; run < DAEMON_RUNS; ++run) {
+            Simulator sim;
+            sim.output().set_buffered(true);
+            sim.run_program(sim.load_text(listing));
+        }
+    });
+
+    std::string socket_path =
+        (std::filesystem::temp_directory_path() / ("simulator_bench_" + std::to_string(spec.seed) + ".sock")).string();
+    SimulatorDaemon daemon(socket_path, 1, nullptr);
+    bool passed = true;
+    double pooled = seconds_for([&] {
+        for (int run = 0; run < DAEMON_RUNS; ++run) {
+            passed = daemon.run(request).result.passed() && passed;
+        }
+    });
+
+    std::atomic<bool> stop{false};
+    std::thread server([&] {
+        try {
+            daemon.serve(stop);
+        } catch (const std::exception& e) {
+            std::printf("Daemon error: %s\n", e.what());
+        }
+    });
+    double socket = 0.0;
+    try {
+        std::unique_ptr<DaemonClient> client;
+        for (int attempt = 0; !client; ++attempt) {   // Until the server thread has bound the socket
+            try {
+                client = std::make_unique<DaemonClient>(socket_path);
+            } catch (const std::exception&) {
+                if (attempt == 100) throw;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        socket = seconds_for([&] {
+            for (int run = 0; run < DAEMON_RUNS; ++run) {
+                passed = client->run(request).result.passed() && passed;
+            }
+        });
+    } catch (const std::exception& e) {
+        std::printf("Daemon client error: %s\n", e.what());
+        passed = false;
+    }
+    stop = true;
+    server.join();
+    if (!passed) {
+        std::printf("Daemon run failed validation\n");
+        return false;
+    }
+
+    std::printf("Daemon request, %zu lines (us)\n  new simulator %8.2f\n  pooled        %8.2f\n  socket        %8.2f\n",
+                DAEMON_LISTING_LINES, fresh * 1e6 / DAEMON_RUNS, pooled * 1e6 / DAEMON_RUNS, socket * 1e6 / DAEMON_RUNS);
+    record("daemon.fresh", fresh * 1e6 / DAEMON_RUNS, "us/request");
+    record("daemon.pooled", pooled * 1e6 / DAEMON_RUNS, "us/request");
+    record("daemon.socket", socket * 1e6 / DAEMON_RUNS, "us/request");
+    return true;
+}
+
+constexpr int LISTING_REPEATS = 5;
+
+// Parse: mapping and compiling the generated listing, best of LISTING_REPEATS
+bool run_parse_benchmark(const std::string& path, size_t bytes, size_t line_count) {
+    double best = 1e30;
+    for (int repeat = 0; repeat < LISTING_REPEATS; ++repeat) {
+        Simulator sim;
+        sim.output().set_buffered(true);
+        best = std::min(best, seconds_for([&] { sim.load_program(path); }));
+    }
+
+    double ns_per_line = best * 1e9 / static_cast<double>(line_count);
+    double mb_per_s = static_cast<double>(bytes) / best / 1e6;
+    std::printf("Parse (%zu lines)\n  %8.2f ns/line  %8.2f MB/s\n", line_count, ns_per_line, mb_per_s);
+    record("parse", ns_per_line, "ns/line");
+    record("parse.throughput", mb_per_s, "MB/s");
+    return true;
+}
+
+// Dispatch: run_command on each raw command line, i.e. tokenize, look up, compile, execute
+bool run_dispatch_benchmark(const std::string& listing) {
+    std::vector<std::string> commands;
+    size_t pos = listing.find('\n') + 1;  // Skip the "--- ... ---" header
+    while (pos < listing.size()) {
+        size_t end = listing.find('\n', pos);
+        std::string line = listing.substr(pos, end - pos);
+        pos = end + 1;
+        if (line.empty()) break;  // Blank line before "Final registers:"
+        commands.push_back(line.substr(0, line.find(" ;")));
+    }
+
+    Simulator sim;
+    double seconds = seconds_for([&] {
+        for (const auto& command : commands) {
+            sim.run_command(command);
+        }
+    });
+
+    double ns_per_command = seconds * 1e9 / static_cast<double>(commands.size());
+    std::printf("Dispatch (run_command)\n  %8.2f ns/command\n", ns_per_command);
+    record("dispatch", ns_per_command, "ns/command");
+    return true;
+}
+
+// The hash-then-scan lookup find_command used before the slot index
+const CommandEntry* find_command_linear(std::string_view mnemonic) {
+    uint32_t cmd_hash = hash_command(mnemonic);
+    for (const auto& entry : commands_table) {
+        if (entry.hash == cmd_hash) return &entry;
+    }
+    return nullptr;
+}
+
+// Dispatch strategies over the same program: command lookup by mnemonic, the
+// execute_instruction switch, and threaded code. All must end in the same state.
+bool run_threaded_benchmark(const std::string& path) {
+    Simulator loader;
+    loader.output().set_buffered(true);
+    Program program = loader.load_program(path);
+    size_t count = program.instructions.size();
+
+    std::vector<std::string_view> mnemonics;
+    mnemonics.reserve(count);
+    for (const auto& line : program.lines) {
+        mnemonics.push_back(line.display.substr(0, line.display.find(' ')));
+    }
+
+    auto best_ns = [&](auto&& work) {
+        double best = 1e30;
+        for (int repeat = 0; repeat < LISTING_REPEATS; ++repeat) {
+            best = std::min(best, seconds_for(work));
+        }
+        return best * 1e9 / static_cast<double>(count);
+    };
+
+    size_t found = 0;
+    double linear_ns = best_ns([&] {
+        for (std::string_view mnemonic : mnemonics) found += find_command_linear(mnemonic) != nullptr;
+    });
+    double indexed_ns = best_ns([&] {
+        for (std::string_view mnemonic : mnemonics) found += find_command(mnemonic) != nullptr;
+    });
+
+    Registers switch_regs;
+    double switch_ns = best_ns([&] {
+        switch_regs = Registers();
+        for (const Instruction& instr : program.instructions) {
+            execute_instruction<BenchPolicy>(switch_regs, instr);
+        }
+    });
+
+    Registers threaded_regs;
+    size_t stop = 0;
+    double threaded_ns = best_ns([&] {
+        threaded_regs = Registers();
+        stop = run_threaded(threaded_regs, program.threaded.data(), 0);
+    });
+
+    if (found != 2 * LISTING_REPEATS * count || stop != count || switch_regs.dump() != threaded_regs.dump()) {
+        std::printf("Threaded code diverged from the switch interpreter\n  switch   %s\n  threaded %s\n",
+                    switch_regs.dump().c_str(), threaded_regs.dump().c_str());
+        return false;
+    }
+
+    std::printf("Command lookup (ns/lookup)\n  table scan %6.2f\n  hash index %6.2f\n", linear_ns, indexed_ns);
+    std::printf("Dispatch loop (ns/instr)\n  switch     %6.2f\n  threaded   %6.2f\n", switch_ns, threaded_ns);
+    record("lookup.table_scan", linear_ns, "ns/lookup");
+    record("lookup.hash_index", indexed_ns, "ns/lookup");
+    record("dispatch.switch", switch_ns, "ns/instr");
+    record("dispatch.threaded", threaded_ns, "ns/instr");
+    return true;
+}
+
+constexpr uint32_t JIT_DIFFERENTIAL_PROGRAMS = 500;
+constexpr size_t JIT_DIFFERENTIAL_LENGTH = 64;
+
+// The JIT against the interpreter: random compiled programs from random register
+// files (flags and segments included), then the generated listing and the hot loop
+// end to end
+bool run_jit_benchmark(const std::string& path) {
+    if (!jit_available()) {
+        std::printf("JIT unavailable on this host\n");
+        return true;
+    }
+
+    uint32_t seed = 0x0018;
+    size_t translated = 0;
+    for (uint32_t n = 0; n < JIT_DIFFERENTIAL_PROGRAMS; ++n) {
+        Program program = make_random_compiled_program(next_random(seed), JIT_DIFFERENTIAL_LENGTH);
+        std::shared_ptr<const JitProgram> jit = jit_compile(program);
+        Registers interpreted = make_random_registers(seed);
+        for (RegisterId segment : {RegisterId::ES, RegisterId::CS, RegisterId::SS, RegisterId::DS}) {
+            interpreted.write(segment, static_cast<uint16_t>(next_random(seed)));
+        }
+        Registers native = interpreted;
+
+        for (const Instruction& instr : program.instructions) {
+            execute_instruction<BenchPolicy>(interpreted, instr);
+        }
+        // As the simulator does: native runs where one starts, the interpreter elsewhere
+        for (uint32_t i = 0; i < program.instructions.size();) {
+            const JitEntry* entry = jit ? jit->entry(i) : nullptr;
+            if (entry) {
+                entry->function(&native);
+                translated += entry->end - i;
+                i = entry->end;
+            } else {
+                execute_instruction<BenchPolicy>(native, program.instructions[i]);
+                ++i;
+            }
+        }
+
+        if (interpreted.dump() != native.dump() || interpreted.flags.value != native.flags.value) {
+            std::printf("JIT diverged on random program %u\n  interpreter %s\n  jit         %s\n", n,
+                        interpreted.dump().c_str(), native.dump().c_str());
+            return false;
+        }
+    }
+    if (translated == 0) {
+        std::printf("JIT translated none of the random programs\n");
+        return false;
+    }
+
+    auto run = [](const Program& program) {
+        Simulator sim;
+        sim.output().set_buffered(true);
+        SimulationResult result;
+        double best = 1e30;
+        for (int repeat = 0; repeat < LISTING_REPEATS; ++repeat) {
+            best = std::min(best, seconds_for([&] { result = sim.run_program<BenchPolicy>(program); }));
+        }
+        return std::make_pair(best * 1e9 / static_cast<double>(result.instructions), sim.get_registers().dump());
+    };
+
+    Simulator loader;
+    loader.output().set_buffered(true);
+    Program listing = loader.load_program(path);
+    loader.set_jit(true);
+    Program listing_jit = loader.load_program(path);
+    Program loop = make_loop_program();
+    Program loop_jit = make_loop_program();
+    loop_jit.jit = jit_compile(loop_jit);
+
+    auto [listing_ns, listing_state] = run(listing);
+    auto [listing_jit_ns, listing_jit_state] = run(listing_jit);
+    auto [loop_ns, loop_state] = run(loop);
+    auto [loop_jit_ns, loop_jit_state] = run(loop_jit);
+    if (listing_state != listing_jit_state || loop_state != loop_jit_state) {
+        std::printf("JIT run diverged from the interpreter\n");
+        return false;
+    }
+
+    std::printf("JIT (%u random programs match the interpreter, ns/instr)\n", JIT_DIFFERENTIAL_PROGRAMS);
+    std::printf("  listing threaded %6.2f  native %6.2f  (%.0f M instr/s)\n", listing_ns, listing_jit_ns,
+                1e3 / listing_jit_ns);
+    std::printf("  loop    threaded %6.2f  native %6.2f  (%.0f M instr/s)\n", loop_ns, loop_jit_ns, 1e3 / loop_jit_ns);
+    record("jit.listing.threaded", listing_ns, "ns/instr");
+    record("jit.listing.native", listing_jit_ns, "ns/instr");
+    record("jit.loop.threaded", loop_ns, "ns/instr");
+    record("jit.loop.native", loop_jit_ns, "ns/instr");
+    return true;
+}
+
+// Expectation checking: ValidatePolicy minus BenchPolicy over the same program. Each
+// pass starts from a fresh register file, since the expectations assume one.
+bool run_expectation_benchmark(const std::string& path) {
+    Simulator loader;
+    loader.output().set_buffered(true);
+    Program program = loader.load_program(path);
+
+    Simulator checker;
+    checker.output().set_buffered(true);
+    SimulationResult result = checker.run_program<ValidatePolicy>(program);
+    if (!result.passed()) {
+        checker.output().set_buffered(false);
+        checker.output().flush();
+        std::printf("Generated listing failed validation: %zu errors, %zu mismatches\n",
+                    result.errors, result.mismatches);
+        return false;
+    }
+
+    auto time_policy = [&](auto policy) {
+        using Policy = decltype(policy);
+        double best = 1e30;
+        for (int repeat = 0; repeat < LISTING_REPEATS; ++repeat) {
+            Simulator sim;
+            sim.output().set_buffered(true);
+            best = std::min(best, seconds_for([&] { sim.run_program<Policy>(program); }));
+        }
+        return best * 1e9 / static_cast<double>(program.instructions.size());
+    };
+
+    double execute_ns = time_policy(BenchPolicy{});
+    double validate_ns = time_policy(ValidatePolicy{});
+    std::printf("Expectation checking (ns/line)\n  execute  %8.2f\n  validate %8.2f  (checks %.2f)\n",
+                execute_ns, validate_ns, validate_ns - execute_ns);
+    record("expectations.execute", execute_ns, "ns/line");
+    record("expectations.validate", validate_ns, "ns/line");
+    record("expectations.check", validate_ns - execute_ns, "ns/line");
+    return true;
+}
+
+// Program cache: load_program parsing the listing, against loading its cached compile
+bool run_program_cache_benchmark(const std::string& path, size_t line_count) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "simulator_bench_cache";
+    ProgramCache cache(directory.string());
+
+    Simulator writer;
+    writer.output().set_buffered(true);
+    writer.set_program_cache(&cache);
+    Program parsed = writer.load_program(path);   // Writes the entry
+
+    double parse = 1e30;
+    double cached = 1e30;
+    bool hit = true;
+    for (int repeat = 0; repeat < LISTING_REPEATS; ++repeat) {
+        Simulator sim;
+        sim.output().set_buffered(true);
+        parse = std::min(parse, seconds_for([&] { sim.load_program(path); }));
+
+        Simulator reader;
+        reader.output().set_buffered(true);
+        reader.set_program_cache(&cache);
+        Program program;
+        cached = std::min(cached, seconds_for([&] { program = reader.load_program(path); }));
+        hit = hit && program.instructions.size() == parsed.instructions.size() &&
+              std::memcmp(program.instructions.data(), parsed.instructions.data(),
+                          parsed.instructions.size() * sizeof(Instruction)) == 0;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    if (!hit) {
+        std::printf("Cached program differs from the parsed one\n");
+        return false;
+    }
+
+    double lines = static_cast<double>(line_count);
+    std::printf("Load (ns/line)\n  parse  %8.2f\n  cached %8.2f\n", parse * 1e9 / lines, cached * 1e9 / lines);
+    record("load.parse", parse * 1e9 / lines, "ns/line");
+    record("load.cached", cached * 1e9 / lines, "ns/line");
+    return true;
+}
+
+// Pipelining: parsing on a second thread while validating, against loading the whole
+// listing first and then validating it
+bool run_pipeline_benchmark(const std::string& path, size_t line_count) {
+    double sequential = 1e30;
+    double pipelined = 1e30;
+    for (int repeat = 0; repeat < LISTING_REPEATS; ++repeat) {
+        Simulator sim;
+        sim.output().set_buffered(true);
+        sequential = std::min(sequential, seconds_for([&] { sim.run_program<ValidatePolicy>(sim.load_program(path)); }));
+
+        Simulator piped;
+        piped.output().set_buffered(true);
+        SimulationResult result;
+        pipelined = std::min(pipelined, seconds_for([&] { result = piped.run_pipelined<ValidatePolicy>(path); }));
+        if (!result.passed()) {
+            piped.output().set_buffered(false);
+            piped.output().flush();
+            std::printf("Pipelined run failed validation: %zu errors, %zu mismatches\n", result.errors,
+                        result.mismatches);
+            return false;
+        }
+    }
+
+    double lines = static_cast<double>(line_count);
+    std::printf("Parse + validate (ns/line)\n  sequential %8.2f\n  pipelined  %8.2f\n", sequential * 1e9 / lines,
+                pipelined * 1e9 / lines);
+    record("pipeline.sequential", sequential * 1e9 / lines, "ns/line");
+    record("pipeline.pipelined", pipelined * 1e9 / lines, "ns/line");
+    return true;
+}
+
+bool run_listing_benchmarks(const ListingSpec& spec) {
+    std::string listing = generate_listing(spec);
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 ("simulator_bench_" + std::to_string(spec.seed) + ".txt");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << listing;
+        if (!file) {
+            std::printf("Cannot write %s\n", path.string().c_str());
+            return false;
+        }
+    }
+
+    bool ok = run_expectation_benchmark(path.string()) &&
+              run_parse_benchmark(path.string(), listing.size(), spec.line_count) &&
+              run_program_cache_benchmark(path.string(), spec.line_count) &&
+              run_pipeline_benchmark(path.string(), spec.line_count) &&
+              run_dispatch_benchmark(listing) &&
+              run_threaded_benchmark(path.string()) &&
+              run_jit_benchmark(path.string());
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return ok;
+}
+
+bool write_json(const std::string& path, const ListingSpec& spec) {
+    std::ofstream out(path);
+    out << "{\n  \"listing\": {\"seed\": " << spec.seed << ", \"lines\": " << spec.line_count << "},\n";
+    out << "  \"metrics\": [\n";
+    for (size_t i = 0; i < g_metrics.size(); ++i) {
+        const Metric& metric = g_metrics[i];
+        out << "    {\"name\": \"" << metric.name << "\", \"value\": " << metric.value << ", \"unit\": \""
+            << metric.unit << "\"}" << (i + 1 < g_metrics.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    ConfigsLoader<BenchConfigs> configs(argv[0]);
+    if (!configs.parse_and_validate(argc, argv) || configs.lines.value <= 0) {
+        std::printf("%s\n", configs.get_error().empty() ? "--lines must be positive" : configs.get_error().c_str());
+        configs.print_usage();
+        return 1;
+    }
+
+    ListingSpec spec;
+    spec.seed = static_cast<uint32_t>(configs.seed.value);
+    spec.line_count = static_cast<size_t>(configs.lines.value);
+
+    if (configs.generate_file.was_provided) {
+        std::ofstream file(configs.generate_file.value, std::ios::binary);
+        file << generate_listing(spec);
+        return file ? 0 : 1;
+    }
+
+    if (!run_listing_benchmarks(spec)) return 1;
+    if (!run_alu_benchmarks()) return 1;
+    if (!run_batch_benchmarks()) return 1;
+    if (!run_policy_benchmarks()) return 1;
+    if (!run_loop_benchmark()) return 1;
+    if (!run_timeline_benchmark()) return 1;
+    if (!run_daemon_benchmark()) return 1;
+
+    if (configs.json_file.was_provided && !write_json(configs.json_file.value, spec)) {
+        std::printf("Cannot write %s\n", configs.json_file.value.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <string_view>
+#include "commands.h"
+#include "executor.h"
+#include "listing_generator.h"
+#include "registers.h"
+
+namespace {
+
+// Letter order used by the listings' flags:OLD->NEW fields and Final block
+constexpr struct {
+    char letter;
+    uint16_t mask;
+} LISTING_FLAGS[] = {
+    {'C', FLAG_CF}, {'P', FLAG_PF}, {'A', FLAG_AF}, {'Z', FLAG_ZF}, {'S', FLAG_SF}, {'O', FLAG_OF},
+};
+
+constexpr const char* MNEMONICS[] = {"mov", "add", "sub", "cmp"};
+
+// xorshift32; a zero seed would stick at zero
+uint32_t next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void append_flag_letters(std::string& out, uint16_t flags) {
+    for (const auto& flag : LISTING_FLAGS) {
+        if (flags & flag.mask) out += flag.letter;
+    }
+}
+
+void append_format(std::string& out, const char* format, unsigned a, unsigned b = 0) {
+    char buffer[64];
+    int length = std::snprintf(buffer, sizeof(buffer), format, a, b);
+    out.append(buffer, static_cast<size_t>(length));
+}
+
+RegisterId pick_register(uint32_t bits, bool is_8bit) {
+    return is_8bit ? static_cast<RegisterId>(static_cast<size_t>(RegisterId::AL) + bits % 8)
+                   : static_cast<RegisterId>(bits % REGISTER16_COUNT);
+}
+
+}  // namespace
+
+std::string generate_listing(const ListingSpec& spec) {
+    uint32_t seed = spec.seed ? spec.seed : 1;
+    Registers regs;
+    std::string out;
+    out.reserve(spec.line_count * 48 + 256);
+
+    out += "--- generated_listing_seed_";
+    out += std::to_string(spec.seed);
+    out += " execution ---\n";
+
+    std::string command;
+    for (size_t i = 0; i < spec.line_count; ++i) {
+        uint32_t r = next_random(seed);
+        bool is_8bit = spec.byte_operands && (r & 1) != 0;
+        bool src_is_immediate = (r & 2) != 0;
+        const char* mnemonic = MNEMONICS[(r >> 2) & 3];
+        RegisterId dest = pick_register(r >> 4, is_8bit);
+
+        std::string source = src_is_immediate ? std::to_string(is_8bit ? (r >> 16) & 0xFF : r >> 16)
+                                              : register_name(pick_register(r >> 8, is_8bit));
+        command = mnemonic;
+        command += ' ';
+        command += register_name(dest);
+        command += ", ";
+        command += source;
+
+        // Execute the line to learn what it changes; those changes are its expectation
+        std::string_view operands[2] = {register_name(dest), source};
+        Instruction instr = compile_command(find_command(mnemonic)->opcode, operands, 2);
+
+        uint16_t flags_before = regs.flags.value;
+        regs.capture_flags();
+        execute_instruction(regs, instr);
+        regs.check_flag_changes();
+        ChangeSet changes = regs.get_last_changes();
+
+        out += command;
+        if (changes.has_changes()) {
+            out += " ; ";
+            for (const auto& change : changes.register_changes) {
+                out += register_name(change.id);
+                append_format(out, ":0x%x->0x%x ", change.old_value, change.new_value);
+            }
+            if (!changes.flags_changes.empty()) {
+                out += "flags:";
+                append_flag_letters(out, flags_before);
+                out += "->";
+                append_flag_letters(out, regs.flags.value);
+                out += ' ';
+            }
+        }
+        out += '\n';
+    }
+
+    out += "\nFinal registers:\n";
+    for (size_t slot = 0; slot < WORD_REGISTER_COUNT; ++slot) {
+        RegisterId id = word_register_id(slot);
+        uint16_t value = regs.read(id);
+        if (value == 0) continue;
+        out += "      ";
+        out += register_name(id);
+        append_format(out, ": 0x%04x (%u)\n", value, value);
+    }
+    out += "   flags: ";
+    append_flag_letters(out, regs.flags.value);
+    out += "\n";
+    return out;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Reproducible synthetic listings for benchmarks. The output uses the same format
+// as the resources listings: a "--- name execution ---" header, one mov/add/sub/cmp
+// per line followed by its expected changes ("; bx:0x0->0x7530 flags:->P "), and a
+// "Final registers:" block. Expectations come from executing each line as it is
+// generated, so a correct simulator passes every check.
+struct ListingSpec {
+    uint32_t seed = 8086;
+    size_t line_count = 1000;
+    bool byte_operands = true;  // Mix 8-bit registers in with the 16-bit ones
+};
+
+std::string generate_listing(const ListingSpec& spec);
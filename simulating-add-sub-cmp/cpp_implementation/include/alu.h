@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include "register_types.h"
+
+// Flag bits written by add/sub/cmp
+constexpr uint16_t ARITHMETIC_FLAGS_MASK = FLAG_CF | FLAG_PF | FLAG_AF | FLAG_ZF | FLAG_SF | FLAG_OF;
+
+enum class AluKernel : uint8_t {
+    Reference,  // Bitwise flag computation
+    Table,      // constexpr-generated 8-bit lookup tables
+};
+
+struct AluResult {
+    uint16_t value;
+    uint16_t flags;  // ARITHMETIC_FLAGS_MASK bits in Flags::value layout
+};
+
+constexpr bool even_parity(uint8_t value) {
+    value ^= static_cast<uint8_t>(value >> 4);
+    value ^= static_cast<uint8_t>(value >> 2);
+    value ^= static_cast<uint8_t>(value >> 1);
+    return (value & 1) == 0;
+}
+
+// Computes the arithmetic flags of one add/sub/cmp, in Flags::value layout.
+// constexpr so listings can be simulated at compile time (constexpr_simulator.h).
+constexpr uint16_t arithmetic_flags(uint16_t result, uint16_t old_val, uint16_t operand, bool is_8bit, bool is_sub) {
+    uint16_t sign = is_8bit ? 0x80 : 0x8000;
+    bool carry = is_sub ? old_val < operand : result < (is_8bit ? (old_val & 0xFF) : old_val);
+    // Overflow: add of same-signed operands, or sub of differently signed ones, changing sign
+    bool overflow = is_sub ? ((old_val ^ operand) & (old_val ^ result) & sign) != 0
+                           : ((old_val ^ result) & (operand ^ result) & sign) != 0;
+
+    uint16_t flags = 0;
+    if (carry) flags |= FLAG_CF;
+    if (even_parity(static_cast<uint8_t>(result))) flags |= FLAG_PF;
+    if ((old_val ^ operand ^ result) & 0x10) flags |= FLAG_AF;
+    if (result == 0) flags |= FLAG_ZF;
+    if (result & sign) flags |= FLAG_SF;
+    if (overflow) flags |= FLAG_OF;
+    return flags;
+}
+
+// The reference kernel: one add or sub on already masked operands
+constexpr AluResult alu_reference(FlagsOp op, uint16_t a, uint16_t b, bool is_8bit) {
+    bool is_sub = op == FlagsOp::Sub;
+    uint16_t mask = is_8bit ? 0xFF : 0xFFFF;
+    uint16_t value = static_cast<uint16_t>((is_sub ? a - b : a + b) & mask);
+    return {value, arithmetic_flags(value, a, b, is_8bit, is_sub)};
+}
+
+// Runs one add or sub (cmp is a sub whose value is discarded) through the chosen kernel
+AluResult alu_execute(AluKernel kernel, FlagsOp op, uint16_t a, uint16_t b, bool is_8bit);
+
+// Evaluates a deferred operation recorded in lazy-flags mode
+uint16_t arithmetic_flags(AluKernel kernel, const PendingFlags& pending);
+
+// --- 8-bit table entries ---
+// Each entry packs the 8-bit result in bits 0-7 and the flags in bits 8-15. The packed
+// flags are the low byte of Flags::value (CF, PF, AF, ZF, SF) with OF folded into bit 3.
+
+constexpr uint16_t ALU_ENTRY_OF = 0x08;
+
+// a + b + carry_in, or a - b - carry_in when is_sub
+constexpr uint16_t alu8_entry(uint8_t a, uint8_t b, bool carry_in, bool is_sub) {
+    unsigned wide = is_sub ? unsigned(a) - b - carry_in : unsigned(a) + b + carry_in;
+    uint8_t result = static_cast<uint8_t>(wide);
+
+    unsigned packed = 0;
+    if (wide & 0x100) packed |= FLAG_CF;
+    if (even_parity(result)) packed |= FLAG_PF;
+    if ((a ^ b ^ result) & 0x10) packed |= FLAG_AF;
+    if (result == 0) packed |= FLAG_ZF;
+    if (result & 0x80) packed |= FLAG_SF;
+
+    bool overflow = is_sub ? ((a ^ b) & (a ^ result) & 0x80) != 0
+                           : ((a ^ result) & (b ^ result) & 0x80) != 0;
+    if (overflow) packed |= ALU_ENTRY_OF;
+
+    return static_cast<uint16_t>(result | (packed << 8));
+}
+
+constexpr uint8_t alu_entry_value(uint16_t entry) {
+    return static_cast<uint8_t>(entry);
+}
+
+// Unpacks entry flags into Flags::value layout
+constexpr uint16_t alu_entry_flags(uint16_t entry) {
+    uint16_t packed = static_cast<uint16_t>(entry >> 8);
+    return static_cast<uint16_t>((packed & (ARITHMETIC_FLAGS_MASK & 0xFF)) | ((packed & ALU_ENTRY_OF) << 8));
+}
@@ -0,0 +1,224 @@
+#pragma once
+// Internal to BatchSimulator: lane kernels shared by the scalar, SSE2 and AVX2 builds.
+#include <cstddef>
+#include <cstdint>
+#include "alu.h"
+#include "register_id.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMULATOR_HAS_SSE2 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+enum class BatchOpKind : uint8_t {
+    Mov,
+    Add,
+    Sub,
+    Cmp,
+};
+
+// Instruction lowered for lane execution: slots and byte selects resolved up front
+struct BatchOp {
+    BatchOpKind kind;
+    uint8_t is_8bit;
+    uint8_t dest_slot;
+    uint8_t dest_high;          // Destination is AH..DH
+    uint8_t src_slot;
+    uint8_t src_high;           // Source is AH..DH
+    uint8_t src_is_byte;        // Source is an 8-bit register
+    uint8_t src_is_immediate;
+    uint8_t flags_live;         // A later reader can observe this op's flags
+    uint8_t reserved;
+    uint16_t immediate;         // Already truncated to the operand width
+};
+
+// One block of lanes: a pointer per word slot plus the flags array
+struct BatchBlock {
+    uint16_t* words[WORD_REGISTER_COUNT];
+    uint16_t* flags;
+    size_t count;               // Multiple of the kernel width
+};
+
+void run_batch_scalar(const BatchOp* ops, size_t op_count, const BatchBlock& block);
+#ifdef SIMULATOR_HAS_SSE2
+void run_batch_sse2(const BatchOp* ops, size_t op_count, const BatchBlock& block);
+#endif
+#ifdef SIMULATOR_HAS_AVX2_KERNEL
+void run_batch_avx2(const BatchOp* ops, size_t op_count, const BatchBlock& block);
+#endif
+
+// Kernel bodies have internal linkage: each translation unit instantiates them with
+// its own target flags, so an AVX2 copy can never be picked for the scalar path.
+namespace {
+
+struct ScalarLanes {
+    using Vec = uint16_t;
+    static constexpr size_t WIDTH = 1;
+
+    static Vec load(const uint16_t* p) { return *p; }
+    static void store(uint16_t* p, Vec v) { *p = v; }
+    static Vec set1(uint16_t v) { return v; }
+    static Vec add(Vec a, Vec b) { return static_cast<Vec>(a + b); }
+    static Vec sub(Vec a, Vec b) { return static_cast<Vec>(a - b); }
+    static Vec and_(Vec a, Vec b) { return static_cast<Vec>(a & b); }
+    static Vec or_(Vec a, Vec b) { return static_cast<Vec>(a | b); }
+    static Vec xor_(Vec a, Vec b) { return static_cast<Vec>(a ^ b); }
+    static Vec andnot(Vec a, Vec b) { return static_cast<Vec>(~a & b); }
+    static Vec cmpeq(Vec a, Vec b) { return a == b ? 0xFFFF : 0; }
+    template <int N> static Vec srli(Vec v) { return static_cast<Vec>(v >> N); }
+    template <int N> static Vec slli(Vec v) { return static_cast<Vec>(v << N); }
+};
+
+#ifdef SIMULATOR_HAS_SSE2
+struct Sse2Lanes {
+    using Vec = __m128i;
+    static constexpr size_t WIDTH = 8;
+
+    static Vec load(const uint16_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(uint16_t* p, Vec v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static Vec set1(uint16_t v) { return _mm_set1_epi16(static_cast<short>(v)); }
+    static Vec add(Vec a, Vec b) { return _mm_add_epi16(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_epi16(a, b); }
+    static Vec and_(Vec a, Vec b) { return _mm_and_si128(a, b); }
+    static Vec or_(Vec a, Vec b) { return _mm_or_si128(a, b); }
+    static Vec xor_(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+    static Vec andnot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_epi16(a, b); }
+    template <int N> static Vec srli(Vec v) { return _mm_srli_epi16(v, N); }
+    template <int N> static Vec slli(Vec v) { return _mm_slli_epi16(v, N); }
+};
+#endif
+
+#if defined(__AVX2__)
+struct Avx2Lanes {
+    using Vec = __m256i;
+    static constexpr size_t WIDTH = 16;
+
+    static Vec load(const uint16_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(uint16_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Vec set1(uint16_t v) { return _mm256_set1_epi16(static_cast<short>(v)); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi16(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_epi16(a, b); }
+    static Vec and_(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static Vec or_(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    static Vec xor_(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+    static Vec andnot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm256_cmpeq_epi16(a, b); }
+    template <int N> static Vec srli(Vec v) { return _mm256_srli_epi16(v, N); }
+    template <int N> static Vec slli(Vec v) { return _mm256_slli_epi16(v, N); }
+};
+#endif
+
+// Same flag semantics as alu_execute, evaluated on every lane at once
+template <typename V>
+typename V::Vec lane_arithmetic_flags(typename V::Vec old_flags, typename V::Vec a, typename V::Vec b,
+                                      typename V::Vec r, bool is_8bit, bool is_add) {
+    using Vec = typename V::Vec;
+    const Vec one = V::set1(1);
+
+    Vec low, cf, sf, of, zf;
+    if (is_8bit) {
+        low = V::and_(r, V::set1(0x00FF));
+        cf = V::and_(V::template srli<8>(r), one);
+        sf = V::template srli<7>(low);
+        Vec overflow = is_add ? V::and_(V::xor_(a, low), V::xor_(b, low))
+                              : V::and_(V::xor_(a, b), V::xor_(a, low));
+        of = V::and_(V::template srli<7>(overflow), one);
+        zf = V::and_(V::cmpeq(low, V::set1(0)), one);
+    } else {
+        low = r;
+        Vec carry;
+        if (is_add) {
+            carry = V::or_(V::and_(a, b), V::andnot(r, V::or_(a, b)));
+        } else {
+            Vec not_a = V::xor_(a, V::set1(0xFFFF));
+            carry = V::or_(V::and_(not_a, b), V::and_(V::or_(not_a, b), r));
+        }
+        cf = V::template srli<15>(carry);
+        sf = V::template srli<15>(r);
+        Vec overflow = is_add ? V::and_(V::xor_(a, r), V::xor_(b, r))
+                              : V::and_(V::xor_(a, b), V::xor_(a, r));
+        of = V::template srli<15>(overflow);
+        zf = V::and_(V::cmpeq(r, V::set1(0)), one);
+    }
+
+    Vec af = V::and_(V::template srli<4>(V::xor_(V::xor_(a, b), low)), one);
+
+    Vec parity = V::xor_(low, V::template srli<4>(low));
+    parity = V::xor_(parity, V::template srli<2>(parity));
+    parity = V::xor_(parity, V::template srli<1>(parity));
+    Vec pf = V::andnot(parity, one);
+
+    Vec flags = V::andnot(V::set1(ARITHMETIC_FLAGS_MASK), old_flags);
+    flags = V::or_(flags, cf);
+    flags = V::or_(flags, V::template slli<2>(pf));
+    flags = V::or_(flags, V::template slli<4>(af));
+    flags = V::or_(flags, V::template slli<6>(zf));
+    flags = V::or_(flags, V::template slli<7>(sf));
+    flags = V::or_(flags, V::template slli<11>(of));
+    return flags;
+}
+
+template <typename V>
+void run_batch_op(const BatchOp& op, const BatchBlock& block) {
+    using Vec = typename V::Vec;
+    const Vec byte_mask = V::set1(0x00FF);
+    const bool is_8bit = op.is_8bit != 0;
+    const bool writes_dest = op.kind != BatchOpKind::Cmp;
+    const bool computes_flags = op.flags_live && op.kind != BatchOpKind::Mov;
+
+    uint16_t* dest = block.words[op.dest_slot];
+    const uint16_t* src = block.words[op.src_slot];
+    uint16_t* flags = block.flags;
+
+    for (size_t i = 0; i < block.count; i += V::WIDTH) {
+        Vec d = V::load(dest + i);
+        Vec a = d;
+        if (is_8bit) {
+            a = V::and_(op.dest_high ? V::template srli<8>(d) : d, byte_mask);
+        }
+
+        Vec b;
+        if (op.src_is_immediate) {
+            b = V::set1(op.immediate);
+        } else {
+            b = V::load(src + i);
+            if (op.src_high) b = V::template srli<8>(b);
+            if (op.src_is_byte || is_8bit) b = V::and_(b, byte_mask);
+        }
+
+        Vec r;
+        switch (op.kind) {
+            case BatchOpKind::Mov: r = b; break;
+            case BatchOpKind::Add: r = V::add(a, b); break;
+            default: r = V::sub(a, b); break;
+        }
+
+        if (writes_dest) {
+            Vec out = r;
+            if (is_8bit) {
+                out = op.dest_high ? V::or_(V::and_(d, byte_mask), V::template slli<8>(r))
+                                   : V::or_(V::andnot(byte_mask, d), V::and_(r, byte_mask));
+            }
+            V::store(dest + i, out);
+        }
+
+        if (computes_flags) {
+            Vec f = V::load(flags + i);
+            V::store(flags + i, lane_arithmetic_flags<V>(f, a, b, r, is_8bit, op.kind == BatchOpKind::Add));
+        }
+    }
+}
+
+template <typename V>
+void run_batch_ops(const BatchOp* ops, size_t op_count, const BatchBlock& block) {
+    for (size_t k = 0; k < op_count; ++k) {
+        run_batch_op<V>(ops[k], block);
+    }
+}
+
+}  // namespace
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "program.h"
+#include "registers.h"
+
+enum class BatchKernel : uint8_t {
+    Auto,    // Widest kernel the CPU supports
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// Expected end state shared by every lane. Only slots in word_mask (bit per
+// word slot) and bits in flags_mask are compared.
+struct BatchExpectation {
+    uint16_t words[WORD_REGISTER_COUNT];
+    uint16_t word_mask;
+    uint16_t flags;
+    uint16_t flags_mask;
+
+    static BatchExpectation from_registers(const Registers& regs, uint16_t word_mask, uint16_t flags_mask);
+};
+
+// Runs one instruction stream across many register files at once. Registers are
+// kept in structure-of-arrays layout (one array per word slot plus flags) so the
+// mov/add/sub/cmp kernels and their flag logic process 8 (SSE2) or 16 (AVX2) lanes
+// per instruction. Only register and immediate operands are supported.
+class BatchSimulator {
+public:
+    explicit BatchSimulator(size_t lane_count);
+
+    size_t lane_count() const { return m_lane_count; }
+
+    void set_kernel(BatchKernel kernel) { m_kernel = kernel; }
+    // Kernel that run() will actually use on this CPU
+    BatchKernel resolved_kernel() const;
+
+    void set_lane(size_t lane, const Registers& regs);
+    Registers lane_registers(size_t lane) const;
+
+    // Executes the program on every lane. Throws std::invalid_argument if the
+    // program uses memory operands, jumps or invalid lines.
+    void run(const Program& program);
+
+    std::vector<size_t> diverging_lanes(const BatchExpectation& expected) const;
+
+private:
+    size_t m_lane_count;
+    size_t m_padded_count;      // Rounded up to a whole AVX2 vector
+    BatchKernel m_kernel;
+    std::vector<uint16_t> m_words[WORD_REGISTER_COUNT];
+    std::vector<uint16_t> m_flags;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "program.h"
+
+constexpr uint32_t NO_BLOCK = UINT32_MAX;          // Past the end of the program
+constexpr uint32_t UNLINKED_BLOCK = UINT32_MAX - 1; // Successor not followed yet
+
+// Straight-line run of instructions: entered at `start`, left after its last
+// instruction, which is either a jump or the last instruction of the program
+struct BasicBlock {
+    uint32_t start;          // Instruction index
+    uint32_t end;            // One past the last instruction
+    uint32_t taken;          // Block reached when the closing jump is taken
+    uint32_t fallthrough;    // Block reached otherwise
+    uint64_t executions;
+};
+
+// Basic blocks of one program, built the first time execution reaches their start
+// and cached by start instruction. A successor is resolved once and then stored in
+// the block, so hot loops go block to block without looking anything up.
+class BlockCache {
+public:
+    // Drops all blocks and counts; the program must outlive the cache's use of it
+    void reset(const Program& program);
+
+    // Block starting at the first instruction, or NO_BLOCK for an empty program
+    uint32_t entry();
+    // Block execution continues in, or NO_BLOCK when the program ends
+    uint32_t successor(uint32_t block, bool taken);
+
+    void count_execution(uint32_t block) { m_blocks[block].executions++; }
+
+    const BasicBlock& operator[](uint32_t block) const { return m_blocks[block]; }
+    size_t size() const { return m_blocks.size(); }
+    // In discovery order, with execution counts
+    const std::vector<BasicBlock>& blocks() const { return m_blocks; }
+
+private:
+    uint32_t block_at(uint32_t start);
+
+    const Program* m_program = nullptr;
+    std::vector<BasicBlock> m_blocks;
+    std::vector<uint32_t> m_block_by_start;   // NO_BLOCK where no block starts yet
+};
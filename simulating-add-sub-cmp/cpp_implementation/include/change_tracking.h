@@ -1,23 +1,49 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
-#include <string>
-#include <vector>
+#include <stdexcept>
+#include "register_id.h"
+
+// Inline, fixed-capacity list so change tracking never allocates
+template <typename T, size_t Capacity>
+struct FixedList {
+    T items[Capacity];
+    uint8_t count = 0;
+
+    void push_back(const T& item) {
+        if (count == Capacity) {
+            throw std::length_error("FixedList capacity exceeded");
+        }
+        items[count++] = item;
+    }
+
+    bool empty() const { return count == 0; }
+    bool full() const { return count == Capacity; }
+    size_t size() const { return count; }
+    void clear() { count = 0; }
+
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+};
 
 struct RegisterChange {
-    std::string name;
+    RegisterId id;
     uint16_t old_value;
     uint16_t new_value;
 };
 
 struct FlagsChange {
-    std::string flag_name;
+    uint16_t mask;  // Single Flags::value bit
     bool old_value;
     bool new_value;
 };
 
+constexpr size_t MAX_REGISTER_CHANGES = 4;
+constexpr size_t MAX_FLAGS_CHANGES = 9;
+
 struct ChangeSet {
-    std::vector<RegisterChange> register_changes;
-    std::vector<FlagsChange> flags_changes;
+    FixedList<RegisterChange, MAX_REGISTER_CHANGES> register_changes;
+    FixedList<FlagsChange, MAX_FLAGS_CHANGES> flags_changes;
 
     bool has_changes() const {
         return !register_changes.empty() || !flags_changes.empty();
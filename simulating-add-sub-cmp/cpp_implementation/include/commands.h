@@ -1,42 +1,74 @@
 #pragma once
-#include <string>
-#include <vector>
+#include <string_view>
 #include <cstdint>
-#include "registers.h"
-
-// Command handler type: takes registers and arguments, returns result string
-using CommandHandler = std::string(*)(Registers& regs, const std::vector<std::string>& args);
+#include "instruction.h"
+#include "sim_status.h"
 
 // Command table entry
 struct CommandEntry {
     uint32_t hash;
-    CommandHandler handler;
+    Opcode opcode;
+    std::string_view name;     // Compared on lookup, so colliding hashes cannot alias
 };
 
 // DJB2 hash algorithm initial value
 constexpr uint32_t DJB2_HASH_INIT = 5381;
 
 // Simple constexpr hash function for command names (DJB2 algorithm)
-constexpr uint32_t hash_command(const char* str) {
+constexpr uint32_t hash_command(std::string_view str) {
     uint32_t hash = DJB2_HASH_INIT;
-    while (*str) {
-        hash = ((hash << 5) + hash) + static_cast<unsigned char>(*str);
-        str++;
+    for (char c : str) {
+        hash = ((hash << 5) + hash) + static_cast<unsigned char>(c);
     }
     return hash;
 }
 
-// Forward declarations of command handlers
-std::string cmd_mov(Registers& regs, const std::vector<std::string>& args);
-std::string cmd_add(Registers& regs, const std::vector<std::string>& args);
-std::string cmd_sub(Registers& regs, const std::vector<std::string>& args);
-std::string cmd_cmp(Registers& regs, const std::vector<std::string>& args);
-
-// Command table
-constexpr size_t COMMANDS_TABLE_SIZE = 4;
-inline CommandEntry commands_table[COMMANDS_TABLE_SIZE] = {
-    {hash_command("mov"), cmd_mov},
-    {hash_command("add"), cmd_add},
-    {hash_command("sub"), cmd_sub},
-    {hash_command("cmp"), cmd_cmp},
+constexpr CommandEntry jump_entry(std::string_view name, Opcode opcode) {
+    return {hash_command(name), opcode, name};
+}
+
+// Command table. Jumps take every NASM spelling; the disassembler prints the first one.
+constexpr size_t COMMANDS_TABLE_SIZE = 40;
+inline constexpr CommandEntry commands_table[COMMANDS_TABLE_SIZE] = {
+    {hash_command("mov"), Opcode::Mov, "mov"},
+    {hash_command("add"), Opcode::Add, "add"},
+    {hash_command("sub"), Opcode::Sub, "sub"},
+    {hash_command("cmp"), Opcode::Cmp, "cmp"},
+
+    jump_entry("jo", Opcode::Jo),         jump_entry("jno", Opcode::Jno),
+    jump_entry("jb", Opcode::Jb),         jump_entry("jc", Opcode::Jb),        jump_entry("jnae", Opcode::Jb),
+    jump_entry("jnb", Opcode::Jnb),       jump_entry("jnc", Opcode::Jnb),      jump_entry("jae", Opcode::Jnb),
+    jump_entry("je", Opcode::Je),         jump_entry("jz", Opcode::Je),
+    jump_entry("jne", Opcode::Jne),       jump_entry("jnz", Opcode::Jne),
+    jump_entry("jbe", Opcode::Jbe),       jump_entry("jna", Opcode::Jbe),
+    jump_entry("ja", Opcode::Ja),         jump_entry("jnbe", Opcode::Ja),
+    jump_entry("js", Opcode::Js),         jump_entry("jns", Opcode::Jns),
+    jump_entry("jp", Opcode::Jp),         jump_entry("jpe", Opcode::Jp),
+    jump_entry("jnp", Opcode::Jnp),       jump_entry("jpo", Opcode::Jnp),
+    jump_entry("jl", Opcode::Jl),         jump_entry("jnge", Opcode::Jl),
+    jump_entry("jnl", Opcode::Jnl),       jump_entry("jge", Opcode::Jnl),
+    jump_entry("jle", Opcode::Jle),       jump_entry("jng", Opcode::Jle),
+    jump_entry("jg", Opcode::Jg),         jump_entry("jnle", Opcode::Jg),
+    jump_entry("loopnz", Opcode::Loopnz), jump_entry("loopne", Opcode::Loopnz),
+    jump_entry("loopz", Opcode::Loopz),   jump_entry("loope", Opcode::Loopz),
+    jump_entry("loop", Opcode::Loop),     jump_entry("jcxz", Opcode::Jcxz),
 };
+
+// Slots of the open-addressed hash index over commands_table. A power of two at
+// least twice the table size, so a lookup usually settles on its first probe.
+constexpr size_t COMMAND_SLOT_COUNT = 128;
+static_assert((COMMAND_SLOT_COUNT & (COMMAND_SLOT_COUNT - 1)) == 0, "Slot count must be a power of two");
+static_assert(COMMAND_SLOT_COUNT >= 2 * COMMANDS_TABLE_SIZE, "Grow COMMAND_SLOT_COUNT with the table");
+
+// Returns the table entry for a mnemonic, or nullptr if unknown. Hashes index the
+// table; the name is compared before an entry is returned.
+const CommandEntry* find_command(std::string_view mnemonic);
+
+// Compiles the operands of a textual command into a pre-decoded instruction.
+// Returns why it cannot for malformed or unknown operands, and for jumps, whose
+// label only a whole program can resolve (see Simulator::load_program); fault is
+// then the offending text, a view into args.
+SimStatus try_compile_command(Opcode opcode, const std::string_view* args, size_t arg_count, Instruction& instr,
+                              std::string_view& fault) noexcept;
+// Same, throwing std::runtime_error(status_message(...)) instead
+Instruction compile_command(Opcode opcode, const std::string_view* args, size_t arg_count);
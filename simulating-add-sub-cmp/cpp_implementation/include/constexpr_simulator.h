@@ -0,0 +1,238 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include "alu.h"
+#include "commands.h"
+#include "instruction.h"
+#include "register_id.h"
+
+// Compile-time simulation of register-only listings, for static_assert checks of
+// their final state. Registers is not a literal type (its bytes alias words through
+// unions and writes go through tracking proxies), so this keeps plain words in the
+// same slots and shares the rest with the runtime simulator: the reference ALU
+// kernel, the mnemonic table and the register names. Anything it cannot evaluate
+// (memory operands, jumps, labels, malformed lines) throws, which is not a
+// constant expression and so fails the build.
+
+struct ConstexprRegisters {
+    std::array<uint16_t, WORD_REGISTER_COUNT> words{};
+    uint16_t flags = 0;
+
+    constexpr uint16_t read(RegisterId id) const {
+        uint16_t word = words[word_slot(id)];
+        if (!is_8bit_register(id)) return word;
+        return is_high_byte(id) ? static_cast<uint16_t>(word >> 8) : static_cast<uint16_t>(word & 0xFF);
+    }
+
+    constexpr void write(RegisterId id, uint16_t value) {
+        uint16_t& word = words[word_slot(id)];
+        if (!is_8bit_register(id)) {
+            word = value;
+        } else if (is_high_byte(id)) {
+            word = static_cast<uint16_t>((word & 0x00FF) | ((value & 0xFF) << 8));
+        } else {
+            word = static_cast<uint16_t>((word & 0xFF00) | (value & 0xFF));
+        }
+    }
+};
+
+// mov/add/sub/cmp with a register destination and a register or immediate source
+constexpr void execute_constexpr(ConstexprRegisters& regs, const Instruction& instr) {
+    if (instr.dest_kind != OperandKind::Register ||
+        (instr.src_kind != OperandKind::Register && instr.src_kind != OperandKind::Immediate)) {
+        throw std::runtime_error("Compile-time simulation takes register and immediate operands only");
+    }
+
+    bool is_8bit = instr.width == OperandWidth::Byte;
+    uint16_t mask = is_8bit ? 0xFF : 0xFFFF;
+    uint16_t source = instr.src_kind == OperandKind::Immediate ? instr.immediate : regs.read(instr.src);
+    source = static_cast<uint16_t>(source & mask);
+
+    switch (instr.opcode) {
+        case Opcode::Mov:
+            regs.write(instr.dest, source);
+            return;
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Cmp: {
+            FlagsOp op = instr.opcode == Opcode::Add ? FlagsOp::Add : FlagsOp::Sub;
+            uint16_t old_val = static_cast<uint16_t>(regs.read(instr.dest) & mask);
+            AluResult result = alu_reference(op, old_val, source, is_8bit);
+            if (instr.opcode != Opcode::Cmp) {
+                regs.write(instr.dest, result.value);
+            }
+            regs.flags = static_cast<uint16_t>((regs.flags & ~ARITHMETIC_FLAGS_MASK) | result.flags);
+            return;
+        }
+        default:
+            break;
+    }
+    throw std::runtime_error("Compile-time simulation has no jumps");
+}
+
+template <size_t N>
+constexpr ConstexprRegisters simulate_constexpr(const std::array<Instruction, N>& program) {
+    ConstexprRegisters regs;
+    for (const Instruction& instr : program) {
+        execute_constexpr(regs, instr);
+    }
+    return regs;
+}
+
+namespace constexpr_listing {
+
+constexpr bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+constexpr std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_blank(text.front())) text.remove_prefix(1);
+    while (!text.empty() && is_blank(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+// Returns the line starting at pos and moves pos past its newline
+constexpr std::string_view next_line(std::string_view text, size_t& pos) {
+    size_t end = text.find('\n', pos);
+    if (end == std::string_view::npos) end = text.size();
+    std::string_view line = text.substr(pos, end - pos);
+    pos = end + 1;
+    return line;
+}
+
+constexpr Opcode find_opcode(std::string_view mnemonic) {
+    for (const CommandEntry& entry : commands_table) {
+        if (entry.name == mnemonic) return entry.opcode;
+    }
+    throw std::runtime_error("Unknown command");
+}
+
+// Signed decimal, wrapped to 16 bits like the runtime's parse_immediate
+constexpr uint16_t parse_decimal(std::string_view text) {
+    bool negative = !text.empty() && text.front() == '-';
+    if (negative || (!text.empty() && text.front() == '+')) text.remove_prefix(1);
+    if (text.empty()) throw std::runtime_error("Invalid immediate");
+
+    uint32_t value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') throw std::runtime_error("Invalid immediate");
+        value = value * 10 + static_cast<uint32_t>(c - '0');
+        if (value > 0x7FFFFFFF) throw std::runtime_error("Immediate out of range");
+    }
+    return static_cast<uint16_t>(negative ? 0u - value : value);
+}
+
+constexpr uint16_t parse_hex(std::string_view text) {
+    if (text.empty()) throw std::runtime_error("Invalid hex value");
+    uint32_t value = 0;
+    for (char c : text) {
+        uint32_t digit = c >= '0' && c <= '9'   ? static_cast<uint32_t>(c - '0')
+                         : c >= 'a' && c <= 'f' ? static_cast<uint32_t>(c - 'a' + 10)
+                         : c >= 'A' && c <= 'F' ? static_cast<uint32_t>(c - 'A' + 10)
+                                                : 16;
+        if (digit == 16) throw std::runtime_error("Invalid hex value");
+        value = (value << 4) | digit;
+        if (value > 0xFFFF) throw std::runtime_error("Hex value out of range");
+    }
+    return static_cast<uint16_t>(value);
+}
+
+constexpr RegisterId operand_register(std::string_view name) {
+    RegisterId id = register_id_from_name(name);
+    if (id == RegisterId::IP) throw std::runtime_error("IP is not an operand");
+    return id;
+}
+
+}  // namespace constexpr_listing
+
+// Compiles one "mnemonic dest, src" command, e.g. compile_constexpr("add bx, -90")
+constexpr Instruction compile_constexpr(std::string_view command) {
+    using namespace constexpr_listing;
+
+    command = trim(command.substr(0, command.find(';')));
+    size_t space = command.find(' ');
+    size_t comma = command.find(',');
+    if (space == std::string_view::npos || comma == std::string_view::npos || comma < space) {
+        throw std::runtime_error("Expected 'mnemonic dest, src'");
+    }
+
+    Instruction instr{};
+    instr.opcode = find_opcode(command.substr(0, space));
+    if (is_jump(instr.opcode)) throw std::runtime_error("Compile-time simulation has no jumps");
+    instr.ea = EffectiveAddress::None;
+    instr.segment = RegisterId::None;
+
+    instr.dest_kind = OperandKind::Register;
+    instr.dest = operand_register(trim(command.substr(space + 1, comma - space - 1)));
+    if (instr.dest == RegisterId::None) throw std::runtime_error("Destination must be a register");
+    instr.width = is_8bit_register(instr.dest) ? OperandWidth::Byte : OperandWidth::Word;
+
+    std::string_view source = trim(command.substr(comma + 1));
+    instr.src = operand_register(source);
+    if (instr.src != RegisterId::None) {
+        if (is_8bit_register(instr.src) != is_8bit_register(instr.dest)) {
+            throw std::runtime_error("Operand sizes differ");
+        }
+        instr.src_kind = OperandKind::Register;
+    } else {
+        instr.src_kind = OperandKind::Immediate;
+        instr.immediate = parse_decimal(source);
+    }
+    return instr;
+}
+
+// Runs a listing's commands, skipping its header, blank lines and comments, and
+// stopping at the "Final registers:" section
+constexpr ConstexprRegisters simulate_listing(std::string_view listing) {
+    ConstexprRegisters regs;
+    size_t pos = 0;
+    while (pos < listing.size()) {
+        std::string_view line = constexpr_listing::next_line(listing, pos);
+        if (line.substr(0, 5) == "Final") break;
+        if (line.empty() || line[0] == '-' || constexpr_listing::is_blank(line[0]) || line[0] == ';') continue;
+        execute_constexpr(regs, compile_constexpr(line));
+    }
+    return regs;
+}
+
+// True when the listing ends in the state its "Final registers:" section records:
+// every listed register holds its value and exactly the listed flags are set
+constexpr bool listing_final_state_matches(std::string_view listing) {
+    using namespace constexpr_listing;
+
+    ConstexprRegisters regs = simulate_listing(listing);
+    size_t final_pos = listing.find("\nFinal");
+    if (final_pos == std::string_view::npos) throw std::runtime_error("Listing has no final state");
+
+    uint16_t expected_flags = 0;
+    size_t pos = listing.find('\n', final_pos + 1) + 1;
+    while (pos < listing.size()) {
+        std::string_view line = trim(next_line(listing, pos));
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+
+        std::string_view name = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+        if (name == "flags") {
+            for (char letter : value) {
+                if (!flag_letter_bit(letter)) throw std::runtime_error("Unknown flag letter");
+                expected_flags |= flag_letter_bit(letter);
+            }
+            continue;
+        }
+
+        RegisterId id = operand_register(name);
+        if (id == RegisterId::None || value.substr(0, 2) != "0x") {
+            throw std::runtime_error("Malformed final register line");
+        }
+        value.remove_prefix(2);
+        if (regs.read(id) != parse_hex(value.substr(0, value.find(' ')))) return false;
+    }
+
+    uint16_t reported = 0;
+    for (uint16_t bit : FLAG_LETTER_BITS) reported |= bit;
+    return (regs.flags & reported) == expected_flags;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "instruction.h"
+
+enum class CycleModel : uint8_t {
+    Off,
+    I8086,   // 16-bit bus: word transfers at odd addresses take an extra bus cycle
+    I8088,   // 8-bit bus: every word transfer takes two bus cycles, and instruction
+             // bytes come through a 4-byte prefetch queue
+};
+
+// Clocks charged for one instruction, split the way the 8086 manuals list them
+struct CycleCost {
+    uint32_t base = 0;
+    uint32_t ea = 0;        // Effective-address calculation, segment override included
+    uint32_t penalty = 0;   // Extra bus cycles for word transfers
+    uint32_t fetch = 0;     // 8088: waiting for instruction bytes the queue did not hold
+
+    uint32_t total() const { return base + ea + penalty + fetch; }
+};
+
+// Clocks to compute the effective address of the instruction's memory operand
+uint32_t effective_address_cycles(const Instruction& instr);
+
+// Estimates clocks per instruction and keeps the running total. Timings are the
+// 8086 family manual's; the 8088 prefetch queue is an approximation that only
+// applies to decoded binaries, whose instructions have an encoded size.
+class CycleCounter {
+public:
+    explicit CycleCounter(CycleModel model = CycleModel::Off) : m_model(model) {}
+
+    bool enabled() const { return m_model != CycleModel::Off; }
+    CycleModel model() const { return m_model; }
+    uint64_t total() const { return m_total; }
+    void reset() { m_total = 0; m_queue_bytes = 0; }
+
+    // Charges one executed instruction. `address` is its memory operand's physical
+    // address (ignored without one); `taken` whether a jump went to its target.
+    CycleCost charge(const Instruction& instr, uint32_t address, bool taken);
+
+private:
+    CycleModel m_model;
+    uint64_t m_total = 0;
+    uint32_t m_queue_bytes = 0;
+};
+
+// "Clocks: +13 = 27 (8 + 5ea)": the step's clocks, the running total, and the
+// breakdown when there is more than a base cost
+std::string format_cycles(const CycleCost& cost, uint64_t total);
+
+// "8086", "8088" or "off"; false for anything else
+bool parse_cycle_model(const std::string& name, CycleModel& model);
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "alu.h"
+#include "cycles.h"
+#include "simulator.h"
+#include "simulator_output.h"
+
+// Messages between simulator_client and simulator_main --serve. Each one travels
+// as a frame: a 32-bit little-endian body size, then the body. Bodies start with
+// the protocol version, so a client and daemon from different builds refuse each
+// other instead of misreading fields, then hold little-endian integers and
+// strings prefixed with their 32-bit size.
+constexpr uint32_t DAEMON_PROTOCOL_VERSION = 2;
+constexpr size_t DAEMON_FRAME_HEADER_SIZE = 4;
+// Largest body either side accepts (inline listings included)
+constexpr uint32_t MAX_DAEMON_FRAME_SIZE = 256u << 20;
+
+enum class DaemonSource : uint8_t {
+    Path,   // `program` names a listing on the daemon's file system
+    Text,   // `program` is the listing itself
+};
+
+// One listing to run, with the options simulator_main takes for a traced run
+struct DaemonRequest {
+    DaemonSource source = DaemonSource::Path;
+    std::string program;
+    bool lazy_flags = false;
+    AluKernel alu_kernel = AluKernel::Reference;
+    CycleModel cycle_model = CycleModel::Off;
+    bool capture_debug = false;   // Return Debug trace lines too
+    uint64_t max_steps = 0;
+};
+
+struct DaemonOutputLine {
+    OutputLevel level;
+    std::string text;
+};
+
+// What a run produced: its counts, the registers it ended with, and the trace and
+// diagnostics (mismatches and the final-state comparison included) in order
+struct DaemonResponse {
+    bool ran = false;             // False when the listing could not be run at all
+    std::string error;            // Why, when it did not run
+    SimulationResult result;
+    std::string final_registers;  // Registers::dump() after the run
+    std::vector<DaemonOutputLine> output;
+};
+
+// Encoders return a whole frame; decoders take a body and throw
+// std::runtime_error when it is malformed or from another protocol version
+std::string encode_request(const DaemonRequest& request);
+DaemonRequest decode_request(std::string_view body);
+std::string encode_response(const DaemonResponse& response);
+DaemonResponse decode_response(std::string_view body);
+
+// Body size from a frame's header
+uint32_t frame_body_size(const char* header);
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "instruction.h"
+#include "program.h"
+
+// Decodes the instruction starting at data[offset] into out.
+// Throws std::runtime_error for unsupported opcodes or truncated input.
+void decode_instruction(const uint8_t* data, size_t size, size_t offset, Instruction& out);
+
+// Decodes a whole 8086 binary. Each program line carries the disassembly as its
+// display text and the byte offset as its line number. Decoding stops at the first
+// instruction that cannot be decoded, which is kept as an Opcode::Invalid entry.
+Program decode_program(const uint8_t* data, size_t size);
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include "instruction.h"
+#include "memory.h"
+#include "registers.h"
+
+// Registers an effective-address form adds up, and the segment it uses unless an
+// override prefix says otherwise (bp-based forms default to SS)
+struct AddressForm {
+    Register16 Registers::* base;     // nullptr when absent
+    Register16 Registers::* index;    // nullptr when absent
+    Register16 Registers::* segment;
+};
+
+// Indexed by EffectiveAddress, i.e. by the r/m field of the mod/rm byte
+inline constexpr AddressForm ADDRESS_FORMS[] = {
+    {&Registers::bx, &Registers::si, &Registers::ds},   // [bx + si]
+    {&Registers::bx, &Registers::di, &Registers::ds},   // [bx + di]
+    {&Registers::bp, &Registers::si, &Registers::ss},   // [bp + si]
+    {&Registers::bp, &Registers::di, &Registers::ss},   // [bp + di]
+    {&Registers::si, nullptr, &Registers::ds},          // [si]
+    {&Registers::di, nullptr, &Registers::ds},          // [di]
+    {&Registers::bp, nullptr, &Registers::ss},          // [bp]
+    {&Registers::bx, nullptr, &Registers::ds},          // [bx]
+    {nullptr, nullptr, &Registers::ds},                 // [disp16]
+};
+
+static_assert(sizeof(ADDRESS_FORMS) / sizeof(ADDRESS_FORMS[0]) == static_cast<size_t>(EffectiveAddress::None),
+              "One address form per EffectiveAddress");
+
+// Physical address of an instruction's memory operand. The 16-bit offset wraps
+// within the segment, as on the 8086.
+inline uint32_t effective_address(const Registers& regs, const Instruction& instr) {
+    const AddressForm& form = ADDRESS_FORMS[static_cast<size_t>(instr.ea)];
+
+    uint16_t offset = instr.displacement;
+    if (form.base) offset = static_cast<uint16_t>(offset + (regs.*form.base).value);
+    if (form.index) offset = static_cast<uint16_t>(offset + (regs.*form.index).value);
+
+    Register16 Registers::* segment = instr.segment == RegisterId::None
+                                          ? form.segment
+                                          : REGISTER_WORDS[static_cast<size_t>(instr.segment)];
+    return physical_address((regs.*segment).value, offset);
+}
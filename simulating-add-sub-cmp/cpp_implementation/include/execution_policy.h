@@ -0,0 +1,35 @@
+#pragma once
+
+// Compile-time choice of how much bookkeeping execution does. Code branches on
+// these with `if constexpr`, so a disabled feature leaves nothing behind in the
+// instantiated hot path.
+
+// Full trace: proxies record every register change, each step is diffed,
+// formatted and logged, and expectations are checked
+struct TracePolicy {
+    static constexpr bool TRACK_CHANGES = true;
+    static constexpr bool LOG_STEPS = true;
+    static constexpr bool VALIDATE = true;
+    static constexpr bool COUNT_CYCLES = true;    // When the simulator has a cycle model
+    static constexpr bool PROFILE_STAGES = true;  // When the simulator has a profiler
+};
+
+// Checks expectations and the final state without tracking or logging each step;
+// mismatches are still reported
+struct ValidatePolicy {
+    static constexpr bool TRACK_CHANGES = false;
+    static constexpr bool LOG_STEPS = false;
+    static constexpr bool VALIDATE = true;
+    static constexpr bool COUNT_CYCLES = false;
+    static constexpr bool PROFILE_STAGES = false;
+};
+
+// Raw throughput: no change tracking, no per-step output, no expectation or
+// final-state checks. Only execution and error counting remain.
+struct BenchPolicy {
+    static constexpr bool TRACK_CHANGES = false;
+    static constexpr bool LOG_STEPS = false;
+    static constexpr bool VALIDATE = false;
+    static constexpr bool COUNT_CYCLES = false;
+    static constexpr bool PROFILE_STAGES = false;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include "alu.h"
+#include "execution_policy.h"
+#include "instruction.h"
+#include "memory.h"
+#include "registers.h"
+
+// Executes one pre-decoded instruction. Register writes go through the proxies,
+// so under TracePolicy change tracking behaves exactly as for the textual
+// commands; under the other policies nothing is recorded. Instantiated for each
+// policy in execution_policy.h.
+template <typename Policy = TracePolicy>
+void execute_instruction(Registers& regs, const Instruction& instr);
+// Same, with memory operands read and written through `memory`. Without it they throw.
+// Memory writes are not recorded as changes.
+template <typename Policy = TracePolicy>
+void execute_instruction(Registers& regs, Memory& memory, const Instruction& instr);
+
+// Executes a conditional jump or loop instruction and returns whether it is taken.
+// The loop family decrements CX first; where execution goes next is up to the caller.
+template <typename Policy = TracePolicy>
+bool execute_branch(Registers& regs, const Instruction& instr);
+
+// Moves IP past an executed instruction, and on by the jump offset when a jump was
+// taken. Text listings have no encoding (size 0), so their IP stays put.
+template <typename Policy = TracePolicy>
+inline void advance_ip(Registers& regs, const Instruction& instr, bool taken) {
+    if (instr.size == 0) return;
+    uint16_t offset = taken ? instr.displacement : 0;
+    regs.get16<Policy>(RegisterId::IP) = static_cast<uint16_t>(regs.ip.value + instr.size + offset);
+}
+
+// Arithmetic core of add/sub/cmp on already masked operands: returns the result
+// and updates the flags, or defers them in lazy-flags mode
+inline uint16_t execute_alu(Registers& regs, FlagsOp op, uint16_t old_val, uint16_t operand, bool is_8bit) {
+    if (regs.lazy_flags_enabled()) {
+        uint16_t mask = is_8bit ? 0xFF : 0xFFFF;
+        uint16_t result = static_cast<uint16_t>((op == FlagsOp::Sub ? old_val - operand : old_val + operand) & mask);
+        regs.defer_flags({result, old_val, operand, op, static_cast<uint8_t>(is_8bit)});
+        return result;
+    }
+    AluResult alu = alu_execute(regs.alu_kernel(), op, old_val, operand, is_8bit);
+    regs.flags.value = static_cast<uint16_t>((regs.flags.value & ~ARITHMETIC_FLAGS_MASK) | alu.flags);
+    return alu.value;
+}
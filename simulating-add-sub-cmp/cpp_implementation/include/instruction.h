@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "register_id.h"
+
+enum class Opcode : uint8_t {
+    Mov,
+    Add,
+    Sub,
+    Cmp,
+
+    // Conditional jumps, in 8086 encoding order (0x70 - 0x7F)
+    Jo, Jno, Jb, Jnb, Je, Jne, Jbe, Ja,
+    Js, Jns, Jp, Jnp, Jl, Jnl, Jle, Jg,
+
+    // Loop family (0xE0 - 0xE3)
+    Loopnz, Loopz, Loop, Jcxz,
+
+    Invalid,  // Line failed to compile; the error is kept in the program line info
+};
+
+constexpr size_t OPCODE_COUNT = static_cast<size_t>(Opcode::Invalid) + 1;
+
+constexpr bool is_jump(Opcode opcode) {
+    return opcode >= Opcode::Jo && opcode <= Opcode::Jcxz;
+}
+
+enum class OperandWidth : uint8_t {
+    Byte = 1,
+    Word = 2,
+};
+
+enum class OperandKind : uint8_t {
+    None,
+    Register,
+    Immediate,
+    Memory,
+};
+
+// Effective address forms, in mod/rm r/m order
+enum class EffectiveAddress : uint8_t {
+    BxSi, BxDi, BpSi, BpDi, Si, Di, Bp, Bx,
+    Direct,   // [disp16]
+    None,
+};
+
+// Pre-decoded instruction. Compiled once from text or machine code,
+// executed without any string work.
+struct Instruction {
+    Opcode opcode;
+    OperandWidth width;
+    OperandKind dest_kind;
+    OperandKind src_kind;
+    RegisterId dest;            // Valid when dest_kind == Register
+    RegisterId src;             // Valid when src_kind == Register
+    EffectiveAddress ea;        // Valid when either operand is Memory
+    RegisterId segment;         // Segment override prefix, RegisterId::None if absent
+    uint16_t immediate;
+    uint16_t displacement;      // Memory displacement, or jump offset relative to the next instruction
+    uint8_t size;               // Encoded length in bytes, 0 for text listings
+    uint8_t reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<Instruction>, "Instruction must stay trivially copyable");
+static_assert(sizeof(Instruction) == 14, "Instruction layout grew unexpectedly");
+
+const char* opcode_name(Opcode opcode);
+
+// Renders an instruction in listing syntax ("add bx, [bp + si + 4]")
+std::string format_instruction(const Instruction& instr);
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "program.h"
+#include "registers.h"
+
+// Native code generation needs an x86-64 host with the System V calling
+// convention and mmap; elsewhere jit_compile() always returns nullptr
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define SIMULATOR_JIT 1
+#else
+#define SIMULATOR_JIT 0
+#endif
+
+// Translated straight-line run of instructions. Takes the register file, keeps the
+// general registers it touches in host registers, and writes them, the
+// arithmetic flags (in 8086 layout, which x86-64 shares) and IP back on exit.
+using JitFunction = void (*)(Registers* regs);
+
+struct JitEntry {
+    JitFunction function;   // nullptr when no run starts at this instruction
+    uint32_t end;           // Instruction after the run
+};
+
+// Native code for every run of mov/add/sub/cmp on general registers and
+// immediates. Runs break at jump targets, after jumps and at anything else, so
+// each one is entered only at its first instruction. The code lives in an mmap'd
+// buffer that is writable while it is generated and executable afterwards.
+class JitProgram {
+public:
+    JitProgram(uint8_t* code, size_t capacity, size_t code_size, std::vector<JitEntry> entries, size_t run_count);
+    ~JitProgram();
+    JitProgram(const JitProgram&) = delete;
+    JitProgram& operator=(const JitProgram&) = delete;
+
+    const JitEntry* entry(uint32_t index) const {
+        return m_entries[index].function ? &m_entries[index] : nullptr;
+    }
+    // Bytes of native code emitted; the mapping is rounded up to whole pages
+    size_t code_size() const { return m_code_size; }
+    // Runs translated, not how often they execute
+    size_t run_count() const { return m_run_count; }
+
+private:
+    uint8_t* m_code;
+    size_t m_capacity;
+    size_t m_code_size;
+    std::vector<JitEntry> m_entries;   // Parallel to the program's instructions
+    size_t m_run_count;
+};
+
+constexpr bool jit_available() {
+    return SIMULATOR_JIT != 0;
+}
+
+// Translates a loaded program. Returns nullptr when the host has no JIT, nothing
+// can be translated, or executable memory cannot be allocated.
+std::shared_ptr<const JitProgram> jit_compile(const Program& program);
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "alu.h"
+#include "simulator.h"
+#include "work_stealing_pool.h"
+
+enum class ListingStatus : uint8_t {
+    Pass,
+    Mismatch,   // Ran cleanly but a register, flag or final value differed
+    Fail,       // Could not be opened, or a line failed to compile or execute
+};
+
+struct ListingReport {
+    std::string path;
+    ListingStatus status = ListingStatus::Fail;
+    SimulationResult result;
+    double milliseconds = 0.0;  // Load and run, excluding log output
+    std::string error;          // Why the listing could not be run at all
+};
+
+struct RunnerOptions {
+    bool lazy_flags = false;
+    AluKernel alu_kernel = AluKernel::Reference;
+    bool capture_debug = false; // Keep Debug trace lines (only useful at debug verbosity)
+    uint64_t max_steps = 0;     // See Simulator::set_max_steps
+    CycleModel cycle_model = CycleModel::Off;
+    Profiler* profiler = nullptr;   // Each listing profiles on its own and is merged in when done
+    const ProgramCache* program_cache = nullptr;
+};
+
+// True when the --input value names a directory or contains '*' / '?'
+bool is_listing_pattern(const std::string& input);
+
+// A directory expands to the *.txt files directly inside it. Otherwise each path
+// component may use '*' and '?' wildcards. Results are sorted.
+std::vector<std::string> expand_listings(const std::string& input);
+
+// Runs every listing on its own Simulator across the pool. A listing's
+// trace is buffered and flushed as one block when it finishes, so output from
+// different files never interleaves. Reports are returned in input order.
+std::vector<ListingReport> run_listings(WorkStealingPool& pool, const std::vector<std::string>& paths,
+                                        const RunnerOptions& options);
+
+// Logs one line per listing plus pass/mismatch/fail totals
+void log_listing_report(const std::vector<ListingReport>& reports, double wall_milliseconds);
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a whole file. Regular files are memory-mapped (mmap, or
+// MapViewOfFile on Windows), so parsing reads straight from the page cache.
+// Empty files, pipes and anything that cannot be mapped are read into memory.
+class MappedFile {
+public:
+    // Throws std::runtime_error("Cannot open file: ...") if the file cannot be read
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return {m_data, m_size}; }
+    const uint8_t* bytes() const { return reinterpret_cast<const uint8_t*>(m_data); }
+    size_t size() const { return m_size; }
+    bool is_mapped() const { return m_mapped; }
+
+private:
+    void read_fallback(const std::string& path);
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    std::vector<char> m_fallback;
+    bool m_mapped = false;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// The 8086 addresses 1 MiB through 20-bit physical addresses
+constexpr size_t MEMORY_SIZE = size_t(1) << 20;
+constexpr uint32_t MEMORY_MASK = MEMORY_SIZE - 1;
+
+// Physical address of segment:offset. Addresses past 1 MiB wrap to the bottom,
+// as on the 8086, so every address maps into the arena.
+constexpr uint32_t physical_address(uint16_t segment, uint16_t offset) {
+    return ((uint32_t(segment) << 4) + offset) & MEMORY_MASK;
+}
+
+// Flat memory arena, allocated and zeroed once. Accesses mask the address instead
+// of checking it, so they never allocate or throw. Writes widen a dirty range that
+// clear() zeroes, so clearing after a register-only program costs nothing.
+class Memory {
+public:
+    Memory();
+    Memory(const Memory&) = delete;
+    Memory& operator=(const Memory&) = delete;
+
+    uint8_t read8(uint32_t address) const { return m_bytes[address & MEMORY_MASK]; }
+    void write8(uint32_t address, uint8_t value) {
+        address &= MEMORY_MASK;
+        m_bytes[address] = value;
+        if (address < m_dirty_begin) m_dirty_begin = address;
+        if (address >= m_dirty_end) m_dirty_end = address + 1;
+    }
+
+    // Little-endian; a word at the top of memory wraps its high byte to address 0
+    uint16_t read16(uint32_t address) const {
+        return static_cast<uint16_t>(read8(address) | (read8(address + 1) << 8));
+    }
+    void write16(uint32_t address, uint16_t value) {
+        write8(address, static_cast<uint8_t>(value));
+        write8(address + 1, static_cast<uint8_t>(value >> 8));
+    }
+
+    // Writes through the pointer are not tracked, so the whole arena counts as dirty
+    uint8_t* data() {
+        m_dirty_begin = 0;
+        m_dirty_end = MEMORY_SIZE;
+        return m_bytes.get();
+    }
+    const uint8_t* data() const { return m_bytes.get(); }
+    void clear();
+
+private:
+    std::unique_ptr<uint8_t[]> m_bytes;
+    uint32_t m_dirty_begin = MEMORY_SIZE;   // Every byte outside [begin, end) is zero
+    uint32_t m_dirty_end = 0;
+};
@@ -0,0 +1,124 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "instruction.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMULATOR_HAS_RDTSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define SIMULATOR_HAS_RDTSC 0
+#include <chrono>
+#endif
+
+// Time-stamp counter ticks where available, steady-clock nanoseconds elsewhere
+inline uint64_t read_timestamp() {
+#if SIMULATOR_HAS_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+constexpr const char* TIMESTAMP_UNIT = SIMULATOR_HAS_RDTSC ? "cycles" : "ns";
+
+// Stages of a step, in the order a listing line goes through them
+enum class ProfileStage : uint8_t {
+    Parse,      // Splitting a listing line into command and expectations
+    Tokenize,   // Splitting the command into mnemonic and operands
+    Lookup,     // Finding the mnemonic's table entry
+    Compile,    // Turning the operands into an Instruction
+    Execute,
+    FlagDiff,   // Diffing the flags against the previous step
+    Trace,      // Formatting and logging the step
+    Validate,   // Comparing against the listing's expectations
+};
+
+constexpr size_t PROFILE_STAGE_COUNT = static_cast<size_t>(ProfileStage::Validate) + 1;
+
+const char* profile_stage_name(ProfileStage stage);
+
+// Latency histogram with fixed buckets: exact below 8, then four buckets per
+// power of two, so recording never allocates and percentiles are within 25%
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKET_COUNT = 8 + 61 * 4;
+
+    void record(uint64_t value);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return m_count; }
+    uint64_t max() const { return m_max; }
+    double mean() const { return m_count ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.0; }
+    // Upper bound of the bucket holding the q-quantile, capped at the maximum
+    uint64_t percentile(double q) const;
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> m_buckets{};
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_max = 0;
+};
+
+struct ProfileRow {
+    std::string kind;   // "stage" or "mnemonic"
+    std::string name;
+    uint64_t count;
+    double mean;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+};
+
+// Per-stage and per-mnemonic latency histograms. Simulators record into one
+// through set_profiler(); each runs on one thread, and parallel runs merge
+// their profiles afterwards.
+class Profiler {
+public:
+    void record(ProfileStage stage, uint64_t ticks) { m_stages[static_cast<size_t>(stage)].record(ticks); }
+    void record(Opcode opcode, uint64_t ticks) { m_opcodes[static_cast<size_t>(opcode)].record(ticks); }
+    void merge(const Profiler& other);
+
+    const LatencyHistogram& stage(ProfileStage stage) const { return m_stages[static_cast<size_t>(stage)]; }
+    const LatencyHistogram& opcode(Opcode opcode) const { return m_opcodes[static_cast<size_t>(opcode)]; }
+
+    // Stages, then mnemonics that executed at least once
+    std::vector<ProfileRow> rows() const;
+    // The format follows the extension: .json, otherwise CSV. False if the file cannot be written.
+    bool write(const std::string& path) const;
+
+private:
+    std::array<LatencyHistogram, PROFILE_STAGE_COUNT> m_stages;
+    std::array<LatencyHistogram, OPCODE_COUNT> m_opcodes;
+};
+
+// Times the enclosing scope into a stage, and into a mnemonic when one is given.
+// Does nothing, not even read the clock, without a profiler.
+class ProfileScope {
+public:
+    ProfileScope(Profiler* profiler, ProfileStage stage, Opcode opcode = Opcode::Invalid)
+        : m_profiler(profiler), m_stage(stage), m_opcode(opcode), m_start(profiler ? read_timestamp() : 0) {}
+    ~ProfileScope() {
+        if (!m_profiler) return;
+        uint64_t ticks = read_timestamp() - m_start;
+        m_profiler->record(m_stage, ticks);
+        if (m_opcode != Opcode::Invalid) m_profiler->record(m_opcode, ticks);
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* m_profiler;
+    ProfileStage m_stage;
+    Opcode m_opcode;
+    uint64_t m_start;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "change_tracking.h"
+#include "instruction.h"
+#include "mapped_file.h"
+#include "sim_status.h"
+#include "threaded_code.h"
+
+constexpr size_t MAX_EXPECTED_REGISTERS = 4;
+constexpr size_t MAX_EXPECTED_FLAGS = 9;
+
+class JitProgram;
+
+// Jump whose target is not the start of an instruction (or the end of the program)
+constexpr uint32_t INVALID_JUMP_TARGET = UINT32_MAX;
+
+struct ExpectedRegister {
+    RegisterId id;
+    uint16_t value;
+};
+
+// Expected state changes of a command, resolved when the listing loads so that
+// validating a step touches no names: the registers to compare, and one masked
+// compare for all flags. Names the simulator does not know point into the
+// program's source text and are reported as mismatches.
+struct ExpectedState {
+    FixedList<ExpectedRegister, MAX_EXPECTED_REGISTERS> registers;   // In listing order
+    uint16_t flags_mask = 0;    // Flags::value bits the listing says change
+    uint16_t flags_value = 0;   // Their values afterwards, within flags_mask
+    FixedList<std::string_view, MAX_EXPECTED_REGISTERS> unknown_registers;
+    FixedList<char, MAX_EXPECTED_FLAGS> unknown_flags;
+};
+
+// Source-level information kept alongside each compiled instruction
+struct ProgramLine {
+    int line_number;
+    std::string_view display; // Command text without comment, used for the trace
+    std::string error;        // Compile error for Opcode::Invalid instructions
+    LineStatus status;        // The same error as a status code, column and length
+    ExpectedState expected;
+    bool has_expected;
+    uint32_t jump_target = INVALID_JUMP_TARGET;  // Jumps: instruction index taken to; the
+                                                 // instruction count means "end of program"
+};
+
+// A listing compiled once into instructions; can be executed any number of times.
+// Views in lines and final_section point into `source` (the mapped listing) or
+// into `owned_text`, so a Program is move-only.
+struct Program {
+    std::vector<Instruction> instructions;
+    std::vector<ProgramLine> lines;           // Parallel to instructions
+    std::vector<std::string_view> final_section;
+    std::vector<ThreadedOp> threaded;         // thread_instructions(instructions), once loading is done
+    std::shared_ptr<const JitProgram> jit;    // jit_compile(*this) when the simulator's JIT is on
+
+    std::shared_ptr<const MappedFile> source;
+    std::deque<std::string> owned_text;       // Generated text, e.g. decoded disassembly
+
+    Program() = default;
+    Program(Program&&) = default;
+    Program& operator=(Program&&) = default;
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    // True when `threaded` matches the current instructions
+    bool is_threaded() const { return threaded.size() == instructions.size() + 1; }
+
+    // Stores generated text for the program's lifetime and returns a view of it
+    std::string_view keep(std::string text) {
+        owned_text.push_back(std::move(text));
+        return owned_text.back();
+    }
+};
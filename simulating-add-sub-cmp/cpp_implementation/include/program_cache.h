@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "program.h"
+
+// 64-bit hash of a listing's bytes, eight at a time. Detects edits, not tampering.
+uint64_t content_hash(std::string_view bytes);
+
+// On-disk cache of compiled text listings, one file per listing content hash.
+// An entry holds the instructions, the line records (with their expectations,
+// resolved jumps and compile errors) and the final section as fixed-layout
+// arrays; views into the listing are stored as offsets and pointed back at the
+// listing's text (its mapping, or a copy the program keeps). Loading an entry maps
+// it and copies the arrays out, so nothing is parsed.
+//
+// Entries from another format version or host layout, for other bytes than the
+// listing's, or whose checksum fails are misses; the caller compiles the listing
+// again and store() replaces the entry. Other bytes are told apart by a second,
+// independently built 64-bit hash kept in the entry, so a listing that collides
+// with another under content_hash alone is still a miss. Writes go through a
+// temporary file and a rename, so concurrent runs never see half an entry.
+// Both methods are const and safe to call from several threads.
+class ProgramCache {
+public:
+    explicit ProgramCache(std::string directory);
+
+    // Fills `program` from the entry for `listing`, the text its views will point
+    // into. False on a miss, leaving `program` as it was.
+    bool load(Program& program, std::string_view listing, uint64_t hash) const;
+    // Writes the entry for a program compiled from `listing`. False when it cannot
+    // be cached (views outside the listing, a listing over 4 GiB) or the file
+    // cannot be written.
+    bool store(const Program& program, std::string_view listing, uint64_t hash) const;
+
+    const std::string& directory() const { return m_directory; }
+    std::string entry_path(uint64_t hash) const;
+
+private:
+    std::string m_directory;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Register identifiers, resolved once at load time so execution never touches names
+enum class RegisterId : uint8_t {
+    AX, BX, CX, DX, SI, DI, BP, SP,
+    AL, AH, BL, BH, CL, CH, DL, DH,
+    ES, CS, SS, DS,
+    IP,       // Not an instruction operand; advanced by execution
+    None,
+};
+
+constexpr size_t REGISTER16_COUNT = 8;
+constexpr size_t REGISTER_ID_COUNT = static_cast<size_t>(RegisterId::None);
+
+// Word storage slots: AX..SP (0-7) followed by ES..DS (8-11) and IP (12)
+constexpr size_t WORD_REGISTER_COUNT = 13;
+
+constexpr bool is_8bit_register(RegisterId id) {
+    return id >= RegisterId::AL && id <= RegisterId::DH;
+}
+
+constexpr bool is_segment_register(RegisterId id) {
+    return id >= RegisterId::ES && id <= RegisterId::DS;
+}
+
+constexpr bool is_16bit_register(RegisterId id) {
+    return id <= RegisterId::SP || is_segment_register(id) || id == RegisterId::IP;
+}
+
+constexpr bool is_high_byte(RegisterId id) {
+    return id == RegisterId::AH || id == RegisterId::BH || id == RegisterId::CH || id == RegisterId::DH;
+}
+
+// Word slot holding a register; 8-bit registers map onto AX..DX
+constexpr size_t word_slot(RegisterId id) {
+    if (is_8bit_register(id)) {
+        return (static_cast<size_t>(id) - static_cast<size_t>(RegisterId::AL)) / 2;
+    }
+    if (is_segment_register(id) || id == RegisterId::IP) {
+        return REGISTER16_COUNT + static_cast<size_t>(id) - static_cast<size_t>(RegisterId::ES);
+    }
+    return static_cast<size_t>(id);
+}
+
+constexpr RegisterId word_register_id(size_t slot) {
+    if (slot >= REGISTER16_COUNT) {
+        return static_cast<RegisterId>(static_cast<size_t>(RegisterId::ES) + slot - REGISTER16_COUNT);
+    }
+    return static_cast<RegisterId>(slot);
+}
+
+// Lowercase register names as used in listings ("ax", "al", ...), by RegisterId
+inline constexpr std::string_view REGISTER_NAMES[REGISTER_ID_COUNT] = {
+    "ax", "bx", "cx", "dx", "si", "di", "bp", "sp",
+    "al", "ah", "bl", "bh", "cl", "ch", "dl", "dh",
+    "es", "cs", "ss", "ds",
+    "ip",
+};
+
+const char* register_name(RegisterId id);
+
+// Returns RegisterId::None for unknown names
+constexpr RegisterId register_id_from_name(std::string_view name) {
+    for (size_t i = 0; i < REGISTER_ID_COUNT; ++i) {
+        if (name == REGISTER_NAMES[i]) {
+            return static_cast<RegisterId>(i);
+        }
+    }
+    return RegisterId::None;
+}
@@ -1,33 +1,62 @@
 #pragma once
 #include <cstdint>
-#include <string>
+#include "execution_policy.h"
+#include "register_id.h"
 
 struct Registers;
 
-struct Register16Proxy {
-    std::string name;
+// Out of line so this header does not need the full Registers definition
+void record_register_change(Registers& regs, RegisterId id, uint16_t old_value, uint16_t new_value);
+
+template <typename Policy>
+struct BasicRegister16Proxy {
     Registers& regs;
     uint16_t* ptr;
+    RegisterId id;
 
-    Register16Proxy(Registers& r, const std::string& n, uint16_t* p);
+    BasicRegister16Proxy(Registers& r, RegisterId i, uint16_t* p) : regs(r), ptr(p), id(i) {}
 
-    Register16Proxy& operator=(uint16_t value);
-    Register16Proxy& operator+=(uint16_t value);
-    Register16Proxy& operator-=(uint16_t value);
+    BasicRegister16Proxy& operator=(uint16_t value) { return store(value); }
+    BasicRegister16Proxy& operator+=(uint16_t value) { return store(static_cast<uint16_t>(*ptr + value)); }
+    BasicRegister16Proxy& operator-=(uint16_t value) { return store(static_cast<uint16_t>(*ptr - value)); }
 
     operator uint16_t() const { return *ptr; }
+
+private:
+    BasicRegister16Proxy& store(uint16_t value) {
+        uint16_t old_value = *ptr;
+        *ptr = value;
+        if constexpr (Policy::TRACK_CHANGES) {
+            record_register_change(regs, id, old_value, value);
+        }
+        return *this;
+    }
 };
 
-struct Register8Proxy {
-    std::string name;
+template <typename Policy>
+struct BasicRegister8Proxy {
     Registers& regs;
     uint8_t* ptr;
+    RegisterId id;
 
-    Register8Proxy(Registers& r, const std::string& n, uint8_t* p);
+    BasicRegister8Proxy(Registers& r, RegisterId i, uint8_t* p) : regs(r), ptr(p), id(i) {}
 
-    Register8Proxy& operator=(uint8_t value);
-    Register8Proxy& operator+=(uint8_t value);
-    Register8Proxy& operator-=(uint8_t value);
+    BasicRegister8Proxy& operator=(uint8_t value) { return store(value); }
+    BasicRegister8Proxy& operator+=(uint8_t value) { return store(static_cast<uint8_t>(*ptr + value)); }
+    BasicRegister8Proxy& operator-=(uint8_t value) { return store(static_cast<uint8_t>(*ptr - value)); }
 
     operator uint8_t() const { return *ptr; }
+
+private:
+    BasicRegister8Proxy& store(uint8_t value) {
+        uint8_t old_value = *ptr;
+        *ptr = value;
+        if constexpr (Policy::TRACK_CHANGES) {
+            record_register_change(regs, id, old_value, value);
+        }
+        return *this;
+    }
 };
+
+using Register16Proxy = BasicRegister16Proxy<TracePolicy>;
+using Register8Proxy = BasicRegister8Proxy<TracePolicy>;
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -16,6 +17,34 @@ struct Register16 {
     uint8_t& get8(const std::string& name);
 };
 
+// Flags::value bit masks
+constexpr uint16_t FLAG_CF = 0x0001;
+constexpr uint16_t FLAG_PF = 0x0004;
+constexpr uint16_t FLAG_AF = 0x0010;
+constexpr uint16_t FLAG_ZF = 0x0040;
+constexpr uint16_t FLAG_SF = 0x0080;
+constexpr uint16_t FLAG_TF = 0x0100;
+constexpr uint16_t FLAG_IF = 0x0200;
+constexpr uint16_t FLAG_DF = 0x0400;
+constexpr uint16_t FLAG_OF = 0x0800;
+
+// Flags reported in change traces, in the order they are printed
+constexpr uint16_t TRACED_FLAGS[] = {
+    FLAG_CF, FLAG_PF, FLAG_AF, FLAG_ZF, FLAG_SF, FLAG_TF, FLAG_IF, FLAG_DF, FLAG_OF,
+};
+
+// Flag letters as listings write them ("flags:->CZ"), in the order final states print them
+constexpr char FLAG_LETTERS[] = {'C', 'P', 'A', 'Z', 'S', 'O', 'D', 'I'};
+constexpr uint16_t FLAG_LETTER_BITS[] = {FLAG_CF, FLAG_PF, FLAG_AF, FLAG_ZF, FLAG_SF, FLAG_OF, FLAG_DF, FLAG_IF};
+
+// Flags::value bit of a listing's flag letter, 0 if the letter is not a flag
+constexpr uint16_t flag_letter_bit(char letter) {
+    for (size_t i = 0; i < sizeof(FLAG_LETTERS); ++i) {
+        if (FLAG_LETTERS[i] == letter) return FLAG_LETTER_BITS[i];
+    }
+    return 0;
+}
+
 struct Flags {
     union {
         uint16_t value;
@@ -39,4 +68,22 @@ struct Flags {
     Flags();
     void reset();
     std::string dump() const;
+
+    // Trace name of a single flag bit ("CF", "ZF", ...)
+    static const char* name(uint16_t mask);
+};
+
+enum class FlagsOp : uint8_t {
+    None,
+    Add,
+    Sub,
+};
+
+// Last flag-producing operation, kept unevaluated in lazy-flags mode
+struct PendingFlags {
+    uint16_t result;
+    uint16_t old_value;
+    uint16_t operand;
+    FlagsOp op;
+    uint8_t is_8bit;
 };
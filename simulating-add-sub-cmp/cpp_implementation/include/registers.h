@@ -1,15 +1,16 @@
 #pragma once
 #include <string>
-#include <unordered_map>
+#include <type_traits>
+#include "alu.h"
 #include "change_tracking.h"
+#include "register_id.h"
 #include "register_proxy.h"
 #include "register_types.h"
 
 struct Registers {
-    std::unordered_map<std::string, Register16*> reg16_map;
-    std::unordered_map<std::string, uint8_t*> reg8_map;
-
     Register16 ax, bx, cx, dx, si, di, bp, sp;
+    Register16 es, cs, ss, ds;
+    Register16 ip;
     Flags flags;
 
     Registers();
@@ -17,19 +18,86 @@ struct Registers {
     Register16Proxy get16(const std::string& name);
     Register8Proxy get8(const std::string& name);
 
+    // Name-free access for pre-decoded instructions. The policy decides whether
+    // writes through the proxy are recorded as changes.
+    template <typename Policy = TracePolicy>
+    BasicRegister16Proxy<Policy> get16(RegisterId id);
+    template <typename Policy = TracePolicy>
+    BasicRegister8Proxy<Policy> get8(RegisterId id);
+    uint16_t read(RegisterId id) const;
+    // Sets a register without recording a change (initial states, restores)
+    void write(RegisterId id, uint16_t value);
+
     bool is8(const std::string& name) const;
     bool is16(const std::string& name) const;
 
     std::string dump() const;
 
-    void mark_register_change(const std::string& name, uint16_t old_value, uint16_t new_value);
-    void mark_flag_change(const std::string& flag_name, bool old_value, bool new_value);
+    void mark_register_change(RegisterId id, uint16_t old_value, uint16_t new_value);
+    void mark_flag_change(uint16_t flag_mask, bool old_value, bool new_value);
     ChangeSet get_last_changes();
+    void discard_changes();
 
     void capture_flags();
     void check_flag_changes();
 
+    // Lazy-flags mode: add/sub/cmp only record their operands, and the flags are
+    // computed when something reads them (flag dumps, expectation checks, branches).
+    // Readers of `flags` must call materialize_flags() first.
+    void set_lazy_flags(bool enabled);
+    bool lazy_flags_enabled() const { return m_lazy_flags; }
+    void defer_flags(const PendingFlags& pending) { m_pending_flags = pending; }
+    void materialize_flags();
+    Flags resolved_flags() const;
+
+    void set_alu_kernel(AluKernel kernel);
+    AluKernel alu_kernel() const { return m_alu_kernel; }
+
 private:
+    Register16& word_register(RegisterId id);
+    const Register16& word_register(RegisterId id) const;
+    uint8_t* byte_register(RegisterId id);
+
     ChangeSet m_change_set;
     uint16_t m_captured_flags_value;
+    PendingFlags m_pending_flags;
+    bool m_lazy_flags;
+    AluKernel m_alu_kernel;
+};
+
+// Word slots by RegisterId; 8-bit ids map onto the word they live in
+inline constexpr Register16 Registers::* REGISTER_WORDS[REGISTER_ID_COUNT] = {
+    &Registers::ax, &Registers::bx, &Registers::cx, &Registers::dx,
+    &Registers::si, &Registers::di, &Registers::bp, &Registers::sp,
+    &Registers::ax, &Registers::ax, &Registers::bx, &Registers::bx,
+    &Registers::cx, &Registers::cx, &Registers::dx, &Registers::dx,
+    &Registers::es, &Registers::cs, &Registers::ss, &Registers::ds,
+    &Registers::ip,
 };
+
+inline Register16& Registers::word_register(RegisterId id) {
+    return this->*REGISTER_WORDS[static_cast<size_t>(id)];
+}
+
+inline const Register16& Registers::word_register(RegisterId id) const {
+    return this->*REGISTER_WORDS[static_cast<size_t>(id)];
+}
+
+inline uint8_t* Registers::byte_register(RegisterId id) {
+    Register16& reg = word_register(id);
+    return is_high_byte(id) ? &reg.high : &reg.low;
+}
+
+template <typename Policy>
+BasicRegister16Proxy<Policy> Registers::get16(RegisterId id) {
+    return BasicRegister16Proxy<Policy>(*this, id, &word_register(id).value);
+}
+
+template <typename Policy>
+BasicRegister8Proxy<Policy> Registers::get8(RegisterId id) {
+    return BasicRegister8Proxy<Policy>(*this, id, byte_register(id));
+}
+
+// Copying a register file (e.g. for snapshots) must stay a plain memcpy
+static_assert(std::is_trivially_copyable_v<Registers>, "Registers must stay trivially copyable");
+static_assert(sizeof(Registers) <= 128, "Registers should fit in two cache lines");
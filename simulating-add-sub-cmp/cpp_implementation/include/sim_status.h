@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "instruction.h"
+
+// Why a listing, or one of its lines, failed to load or run. The exception-free
+// API (Simulator::try_load_program / try_run_simulation) reports these instead of
+// throwing; the exception-based API throws status_message() of the same status.
+enum class SimStatus : uint8_t {
+    Ok,
+    CannotOpenFile,
+    OutOfMemory,
+    // Compiling a command
+    EmptyCommand,
+    UnknownCommand,
+    JumpNeedsProgram,           // A jump given to run_command, outside any program
+    MissingLabel,
+    WrongOperandCount,
+    TwoMemoryOperands,
+    EmptyOperand,
+    UnknownOperand,
+    UnknownDestination,
+    InvalidImmediate,
+    ImmediateOutOfRange,
+    MalformedMemoryOperand,
+    InvalidSegmentOverride,
+    InvalidAddressRegister,
+    InvalidAddressRegisters,
+    OperandSizeMismatch,
+    AmbiguousOperandSize,
+    // The expectation comment
+    InvalidHexValue,
+    TooManyExpectations,
+    // Resolving and running the program
+    UnknownLabel,
+    PipelinedJump,              // Jumps cannot run while the listing is still being parsed
+    JumpTargetOutsideProgram,
+    StepLimit,
+    DecodeError,                // Binary input; ProgramLine::error has the details
+    // Not about the listing: a failure inside the simulator itself, reported for the
+    // whole call rather than any one line
+    InternalError,
+};
+
+// A status and where it applies: the line, and the offending text as a column and
+// length counted from where ProgramLine::display starts (after any "label:"); for
+// expectation errors that is past the display, in the comment. Zero length means
+// the whole line.
+struct LineStatus {
+    SimStatus status = SimStatus::Ok;
+    Opcode opcode = Opcode::Invalid;   // The line's command, for messages that name it
+    uint16_t column = 0;
+    uint16_t length = 0;
+    int32_t line = 0;                  // Listing line number; byte offset for binaries
+
+    bool ok() const { return status == SimStatus::Ok; }
+};
+
+static_assert(sizeof(LineStatus) == 12, "LineStatus is meant to stay compact");
+
+// Stable identifier, e.g. "unknown_command"
+const char* status_name(SimStatus status);
+
+// The message the exception-based API reports, e.g. "Unknown command: foo".
+// `text` is the offending text; opcode names the command where the message needs it.
+std::string status_message(SimStatus status, Opcode opcode, std::string_view text);
@@ -1,35 +1,135 @@
 #pragma once
+#include <memory>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 #include <vector>
+#include "block_cache.h"
+#include "cycles.h"
+#include "execution_policy.h"
+#include "memory.h"
+#include "profiler.h"
+#include "program.h"
 #include "registers.h"
+#include "simulator_output.h"
+#include "timeline.h"
 
-// Represents expected state changes for a command
-struct ExpectedState {
-    std::unordered_map<std::string, uint16_t> register_changes;  // reg_name -> new_value
-    std::unordered_set<std::string> flags_set;                   // Flags that should be set
-    std::unordered_set<std::string> flags_cleared;               // Flags that should be cleared
-};
+class ProgramCache;
+class TraceBuffer;
 
 // Represents a parsed command line with expected output
 struct CommandLine {
-    std::string command;
+    std::string_view command;
     ExpectedState expected;
     bool has_expected;
 };
 
+// Outcome of a traced run
+struct SimulationResult {
+    size_t instructions = 0;    // Lines executed without error
+    size_t errors = 0;          // Lines that failed to compile or execute
+    size_t mismatches = 0;      // Expected register/flag changes that did not match
+    bool final_checked = false; // Listing had a "Final registers" section
+    bool final_match = false;
+    uint64_t cycles = 0;        // Estimated clocks, when a cycle model is set
+    LineStatus first_error;     // Where the first error happened, when there were any
+
+    bool passed() const {
+        return errors == 0 && mismatches == 0 && (!final_checked || final_match);
+    }
+};
+
 class Simulator {
     Registers m_regs;
+    Memory m_memory;
+    SimulatorOutput m_output;
+    TraceBuffer* m_trace = nullptr;
+    BlockCache m_blocks;
+    uint64_t m_max_steps = 0;
+    CycleCounter m_cycles;
+    Profiler* m_profiler = nullptr;
+    bool m_jit = false;
+    const ProgramCache* m_program_cache = nullptr;
 
 public:
     Simulator();
-    void run_simulation(const std::string& filepath);
+    // Zeroes registers and memory and drops buffered output, keeping every setting,
+    // so one Simulator can run many programs as if each had a new one
+    void reset();
+    // Throws std::runtime_error if the listing cannot be opened
+    SimulationResult run_simulation(const std::string& filepath);
+    // run_simulation without exceptions: Ok, or why the listing could not be loaded or
+    // run (OutOfMemory, or InternalError for any other failure inside the simulator).
+    // Bad lines never fail the call; they are counted in `result` as errors, the
+    // first one with its status in result.first_error.
+    SimStatus try_run_simulation(const std::string& filepath, SimulationResult& result) noexcept;
     std::string run_command(const std::string& line);
+
+    // Load phase: maps the listing and compiles it once so it can be replayed without
+    // re-parsing. The Program keeps the mapping alive for its line views. Jumps name
+    // a "label:" given on its own line or in front of an instruction.
+    Program load_program(const std::string& filepath);
+    // load_program without exceptions; each ProgramLine::status says why its line failed
+    SimStatus try_load_program(const std::string& filepath, Program& program) noexcept;
+    // Load phase for listing text held in memory; the Program keeps the text
+    Program load_text(std::string text);
+    // Load phase for assembled 8086 machine code
+    Program load_binary(const std::string& filepath);
+    // Runs a compiled program. TracePolicy gives the full trace, expectation checks and
+    // final comparison; ValidatePolicy keeps only the checks; BenchPolicy only executes
+    // and counts errors, through the program's threaded code when it has any.
+    // Execution follows jumps from basic block to basic block.
+    template <typename Policy = TracePolicy>
+    SimulationResult run_program(const Program& program);
+    // Runs a text listing while it is still being parsed: a second thread compiles
+    // lines into a bounded lock-free ring and this one executes them in batches, so
+    // memory stays flat however long the listing is. Errors, expectation checks and
+    // the final comparison behave as in run_program. Lines run in listing order, so
+    // jumps are reported as errors; labels are ignored.
+    template <typename Policy = TracePolicy>
+    SimulationResult run_pipelined(const std::string& filepath);
+    // Steps `program` forward and backward from the current registers and memory,
+    // starting at its first instruction. The timeline drives this simulator's state.
+    Timeline timeline(const Program& program, uint32_t checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL);
+    // Blocks of the last run_program, with how often each one ran
+    const BlockCache& blocks() const { return m_blocks; }
+
     const Registers& get_registers() const { return m_regs; }
+    // Brings lazily computed flags up to date, for callers reading get_registers().flags
+    void materialize_flags() { m_regs.materialize_flags(); }
+    // The flat 1 MiB address space memory operands read and write
+    Memory& memory() { return m_memory; }
+    const Memory& memory() const { return m_memory; }
+    void set_lazy_flags(bool enabled) { m_regs.set_lazy_flags(enabled); }
+    void set_alu_kernel(AluKernel kernel) { m_regs.set_alu_kernel(kernel); }
+    SimulatorOutput& output() { return m_output; }
+    // Records each step's changes into the buffer instead of logging them as text
+    void set_trace(TraceBuffer* trace) { m_trace = trace; }
+    // Stops a run (as an error) once about this many instructions have been attempted,
+    // checked between basic blocks; 0 means no limit
+    void set_max_steps(uint64_t max_steps) { m_max_steps = max_steps; }
+    // Estimates clocks per traced step ("Clocks: +N = total") and per run. Only
+    // TracePolicy counts them; the other policies compile the estimate out.
+    void set_cycle_model(CycleModel model) { m_cycles = CycleCounter(model); }
+    // Loads also translate programs to native code, which BenchPolicy runs in
+    // place of threaded code where it can. Ignored without jit_available().
+    void set_jit(bool enabled) { m_jit = enabled; }
+    // Times loading, run_command and TracePolicy steps stage by stage into the profiler
+    void set_profiler(Profiler* profiler) { m_profiler = profiler; }
+    // load_program and load_text reuse the cached compile of an unchanged listing,
+    // and cache what they compile otherwise
+    void set_program_cache(const ProgramCache* cache) { m_program_cache = cache; }
 
 private:
-    CommandLine parse_command_line(const std::string& line);
-    void compare_with_expected(const ExpectedState& expected);
-    void compare_final_state(const std::vector<std::string>& final_section);
+    std::shared_ptr<const MappedFile> open_file(const std::string& filepath) noexcept;
+    std::shared_ptr<const MappedFile> map_file(const std::string& filepath);
+    void compile_listing(Program& program, std::string_view text);
+    SimStatus parse_command_line(std::string_view line, CommandLine& result, std::string_view& fault);
+    Instruction compile_line(std::string_view line, int line_num, ProgramLine& info, Profiler* profiler);
+    template <typename Policy>
+    bool run_block(const Program& program, const BasicBlock& block, SimulationResult& result, uint32_t& step);
+    template <typename Policy>
+    void finish_run(const std::vector<std::string_view>& final_section, SimulationResult& result);
+    void trace_step(const ProgramLine& info, const CycleCost& cost);
+    size_t compare_with_expected(const ExpectedState& expected);
+    bool compare_final_state(const std::vector<std::string_view>& final_section);
 };
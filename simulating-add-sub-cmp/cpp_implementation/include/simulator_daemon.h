@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "daemon_protocol.h"
+#include "simulator.h"
+#include "work_stealing_pool.h"
+
+class ProgramCache;
+
+// A client that stops reading a response is disconnected after this long, so it
+// cannot keep a pool thread
+constexpr int CONNECTION_WRITE_TIMEOUT_SECONDS = 10;
+
+// Resident simulator behind a Unix domain socket (simulator_main --serve), so
+// scripts that run many small listings skip process start-up and a new 1 MiB
+// address space per run. The accept loop polls every connection and reads
+// requests as their bytes arrive; each whole request is one pool task, and its
+// connection goes back to the loop once the response is written. Idle or slow
+// clients therefore never hold a pool thread, and connections are served
+// concurrently. A connection's requests are answered in order.
+// Runs borrow a Simulator from a pool that grows to the thread count and reset()
+// it, so every request sees a fresh machine. Paths are opened as the daemon sees
+// them; simulator_client sends absolute ones.
+class SimulatorDaemon {
+public:
+    // thread_count 0 uses every core. program_cache may be null.
+    SimulatorDaemon(std::string socket_path, size_t thread_count, const ProgramCache* program_cache);
+
+    SimulatorDaemon(const SimulatorDaemon&) = delete;
+    SimulatorDaemon& operator=(const SimulatorDaemon&) = delete;
+
+    // Binds the socket, replacing one a dead daemon left behind, and serves until
+    // `stop` is set (checked a few times a second). Then it stops accepting,
+    // finishes the requests in flight, closes every connection and removes the
+    // socket. Throws std::runtime_error if the socket cannot be bound or another
+    // daemon is serving on it.
+    void serve(const std::atomic<bool>& stop);
+
+    // Runs one request on a pooled Simulator; what each connection calls
+    DaemonResponse run(DaemonRequest request);
+
+    size_t thread_count() const { return m_pool.thread_count(); }
+
+private:
+    // Answers one request; false once the connection should be closed
+    bool serve_request(int fd, const std::string& body);
+    // Hands a connection back to the accept loop, with the bytes it had received
+    // past the request just served
+    void return_connection(int fd, std::string received);
+    std::unique_ptr<Simulator> acquire_simulator();
+    void release_simulator(std::unique_ptr<Simulator> sim);
+
+    std::string m_socket_path;
+    const ProgramCache* m_program_cache;
+    WorkStealingPool m_pool;
+
+    std::mutex m_simulators_mutex;
+    std::vector<std::unique_ptr<Simulator>> m_idle_simulators;
+
+    std::mutex m_returned_mutex;
+    std::vector<std::pair<int, std::string>> m_returned_connections;   // Served, not yet back in the poll set
+    int m_wake_fd = -1;                        // Pipe that wakes the accept loop for them
+};
+
+// One connection to a daemon, for any number of requests in turn
+class DaemonClient {
+public:
+    // Throws std::runtime_error when nothing is serving on the socket
+    explicit DaemonClient(const std::string& socket_path);
+    ~DaemonClient();
+
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    // Throws std::runtime_error if the daemon goes away or answers garbage
+    DaemonResponse run(const DaemonRequest& request);
+
+private:
+    int m_fd = -1;
+};
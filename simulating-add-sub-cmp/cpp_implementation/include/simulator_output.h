@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "logger.h"
+
+enum class OutputLevel : uint8_t {
+    Debug,
+    Info,
+    Warn,
+    Error,
+};
+
+namespace detail {
+
+// Copies literal text up to the next "{...}" placeholder and returns its spec ("" or ":x")
+inline bool next_placeholder(std::ostringstream& out, const char*& fmt, std::string& spec) {
+    while (*fmt) {
+        if (*fmt == '{') {
+            const char* end = fmt;
+            while (*end && *end != '}') ++end;
+            spec.assign(fmt + 1, end);
+            fmt = *end ? end + 1 : end;
+            return true;
+        }
+        out << *fmt++;
+    }
+    return false;
+}
+
+template <typename T>
+void append_argument(std::ostringstream& out, const char*& fmt, const T& value) {
+    std::string spec;
+    if (!next_placeholder(out, fmt, spec)) return;
+    if (spec == ":x") {
+        out << std::hex << value << std::dec;
+    } else {
+        out << value;
+    }
+}
+
+}  // namespace detail
+
+// Formats with the same "{}" / "{:x}" placeholders the logger accepts
+template <typename... Args>
+std::string format_message(const char* fmt, const Args&... args) {
+    std::ostringstream out;
+    (detail::append_argument(out, fmt, args), ...);
+    out << fmt;
+    return out.str();
+}
+
+// Destination for a simulator's trace and diagnostics. By default every line goes
+// straight to LOGGER. In buffered mode lines are kept in order until flush(), so
+// runs on different threads can each emit their output as one uninterrupted block.
+class SimulatorOutput {
+public:
+    // capture_debug keeps Debug lines too; skipping them avoids formatting text
+    // the logger would drop anyway
+    void set_buffered(bool buffered, bool capture_debug = false) {
+        m_buffered = buffered;
+        m_capture_debug = capture_debug;
+    }
+    bool buffered() const { return m_buffered; }
+
+    template <typename... Args>
+    void debug(const char* fmt, const Args&... args) {
+        if (!m_buffered) {
+            LOGGER.Debug(fmt, args...);
+        } else if (m_capture_debug) {
+            m_lines.push_back({OutputLevel::Debug, format_message(fmt, args...)});
+        }
+    }
+
+    template <typename... Args>
+    void info(const char* fmt, const Args&... args) {
+        if (!m_buffered) {
+            LOGGER.Info(fmt, args...);
+        } else {
+            m_lines.push_back({OutputLevel::Info, format_message(fmt, args...)});
+        }
+    }
+
+    template <typename... Args>
+    void warn(const char* fmt, const Args&... args) {
+        if (!m_buffered) {
+            LOGGER.Warn(fmt, args...);
+        } else {
+            m_lines.push_back({OutputLevel::Warn, format_message(fmt, args...)});
+        }
+    }
+
+    template <typename... Args>
+    void error(const char* fmt, const Args&... args) {
+        if (!m_buffered) {
+            LOGGER.Error(fmt, args...);
+        } else {
+            m_lines.push_back({OutputLevel::Error, format_message(fmt, args...)});
+        }
+    }
+
+    // Replays buffered lines through LOGGER and clears the buffer. Callers that
+    // flush from several threads serialize the calls themselves.
+    void flush() {
+        for (const auto& line : m_lines) {
+            switch (line.level) {
+                case OutputLevel::Debug: LOGGER.Debug("{}", line.text); break;
+                case OutputLevel::Info:  LOGGER.Info("{}", line.text); break;
+                case OutputLevel::Warn:  LOGGER.Warn("{}", line.text); break;
+                case OutputLevel::Error: LOGGER.Error("{}", line.text); break;
+            }
+        }
+        m_lines.clear();
+    }
+
+    // Hands buffered lines to sink(level, text) in order and clears the buffer
+    template <typename Sink>
+    void drain(Sink&& sink) {
+        for (auto& line : m_lines) {
+            sink(line.level, std::move(line.text));
+        }
+        m_lines.clear();
+    }
+
+    // Drops buffered lines without logging them
+    void clear() { m_lines.clear(); }
+
+private:
+    struct Line {
+        OutputLevel level;
+        std::string text;
+    };
+
+    std::vector<Line> m_lines;
+    bool m_buffered = false;
+    bool m_capture_debug = false;
+};
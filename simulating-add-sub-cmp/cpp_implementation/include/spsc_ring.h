@@ -0,0 +1,79 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Keeps the producer's and consumer's indices on separate cache lines
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Bounded single-producer/single-consumer queue. Each side writes only its own
+// index and reads the other's with acquire/release ordering, so neither side
+// ever locks. Indices count up forever and are masked on access, which needs a
+// power-of-two capacity; each side also caches the other's index and reloads it
+// only when the ring looks full (or empty).
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : m_slots(round_up_to_power_of_two(capacity)), m_mask(m_slots.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer. Leaves item untouched and returns false when the ring is full.
+    bool try_push(T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache == m_slots.size()) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache == m_slots.size()) return false;
+        }
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: nothing follows the items pushed so far
+    void close() { m_closed.store(true, std::memory_order_release); }
+
+    // Consumer. Hands up to max_items queued items to consume(T&) in order, then
+    // frees all their slots at once. Returns how many it took, 0 when empty.
+    template <typename Consume>
+    size_t pop_batch(size_t max_items, Consume&& consume) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tail_cache == head) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+        }
+        size_t count = std::min(m_tail_cache - head, max_items);
+        for (size_t i = 0; i < count; ++i) {
+            consume(m_slots[(head + i) & m_mask]);
+        }
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: the producer has closed the ring and every item has been popped
+    bool drained() const {
+        return m_closed.load(std::memory_order_acquire) &&
+               m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return m_slots.size(); }
+
+private:
+    static size_t round_up_to_power_of_two(size_t value) {
+        size_t capacity = 1;
+        while (capacity < value) capacity <<= 1;
+        return capacity;
+    }
+
+    std::vector<T> m_slots;
+    size_t m_mask;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};   // Written by the consumer
+    size_t m_tail_cache = 0;                                   // Consumer's last view of m_tail
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};   // Written by the producer
+    size_t m_head_cache = 0;                                   // Producer's last view of m_head
+    std::atomic<bool> m_closed{false};
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "instruction.h"
+#include "register_id.h"
+
+struct Registers;
+
+// Handler selected once per instruction when the program is threaded. Opcode,
+// width and source kind are folded into the handler, so executing it needs no
+// further decisions: mov/add/sub/cmp x {16-bit reg, 16-bit imm, 8-bit reg, 8-bit imm}.
+enum class ThreadedKind : uint8_t {
+    MovReg16, MovImm16, MovReg8, MovImm8,
+    AddReg16, AddImm16, AddReg8, AddImm8,
+    SubReg16, SubImm16, SubReg8, SubImm8,
+    CmpReg16, CmpImm16, CmpReg8, CmpImm8,
+
+    Exit,  // Anything else (jumps, invalid lines, memory operands): leave for the generic path
+    End,   // Sentinel after the last instruction
+};
+
+constexpr size_t THREADED_KIND_COUNT = static_cast<size_t>(ThreadedKind::End) + 1;
+
+struct ThreadedOp {
+    ThreadedKind kind;
+    RegisterId dest;
+    RegisterId src;         // Valid for the *Reg* kinds
+    uint8_t size;           // Encoded length IP advances by, 0 for text listings
+    uint16_t immediate;     // Valid for the *Imm* kinds
+};
+
+static_assert(std::is_trivially_copyable_v<ThreadedOp>, "ThreadedOp must stay trivially copyable");
+static_assert(sizeof(ThreadedOp) == 6, "ThreadedOp layout grew unexpectedly");
+
+// Translates instructions into threaded code: one op per instruction plus an End
+// sentinel, so the dispatch loop needs no bounds check.
+std::vector<ThreadedOp> thread_instructions(const std::vector<Instruction>& instructions);
+
+// Runs threaded code from `start` without change tracking (BenchPolicy semantics)
+// until an Exit or End op, and returns its index. Dispatch uses computed goto
+// with a jump at the end of every handler where the compiler supports it, and a
+// loop over a handler table elsewhere.
+size_t run_threaded(Registers& regs, const ThreadedOp* code, size_t start);
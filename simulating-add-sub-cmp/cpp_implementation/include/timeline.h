@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "memory.h"
+#include "program.h"
+#include "registers.h"
+
+constexpr uint32_t DEFAULT_CHECKPOINT_INTERVAL = 1024;
+
+// Full register state at a step. Registers is trivially copyable, so taking and
+// restoring one is a fixed-size copy; memory is moved through the write journal.
+struct Checkpoint {
+    Registers regs;
+    uint64_t step;
+    uint32_t next;                  // Instruction the run continues from
+    uint32_t memory_journal_size;
+};
+
+static_assert(std::is_trivially_copyable_v<Checkpoint>, "Checkpoint must stay a plain copy");
+
+// Old value of one register, or of the whole flags word when id is RegisterId::None
+struct RegisterUndo {
+    RegisterId id;
+    uint16_t old_value;
+};
+
+// Memory writes keep both values, so the journal can move memory either way
+struct MemoryWrite {
+    uint32_t address;
+    uint16_t old_value;
+    uint16_t new_value;
+    OperandWidth width;
+};
+
+// Where a step starts in the journals, so stepping back undoes exactly its entries
+struct StepRecord {
+    uint32_t instruction;
+    uint32_t register_journal_start;
+    uint32_t memory_journal_start;
+};
+
+// Steps a program forward and backward with full trace semantics. Every new step
+// journals the old values of what it changed (taken from the register changes
+// Registers already records, plus the memory under a destination), so
+// step_back() undoes one step without re-executing anything. A checkpoint every
+// `checkpoint_interval` steps lets seek() reach any step it has recorded with at
+// most that many re-executed instructions.
+//
+// Stepping back keeps the recorded history: execution is deterministic, so
+// stepping forward again replays it. Nothing else may change the registers or
+// memory while a timeline drives them; see Simulator::timeline().
+class Timeline {
+public:
+    Timeline(Registers& regs, Memory& memory, const Program& program,
+             uint32_t checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL);
+
+    // Executes the next instruction; false once the program has run off its end.
+    // A line that failed to compile is stepped over without changing anything. If
+    // executing throws, the step is undone and the exception propagates.
+    bool step();
+    // Undoes the last step; false at step 0
+    bool step_back();
+    // Moves to the state after `target` steps, or to the end if the program finishes first
+    void seek(uint64_t target);
+
+    uint64_t current_step() const { return m_cursor; }
+    uint64_t recorded_steps() const { return m_steps.size(); }
+    uint32_t next_instruction() const { return m_next; }
+    bool finished() const { return m_next >= m_program.instructions.size(); }
+    size_t checkpoint_count() const { return m_checkpoints.size(); }
+
+private:
+    uint32_t execute_next(bool record);
+    void record_step();
+    void restore_checkpoint(const Checkpoint& checkpoint);
+    uint32_t memory_position(uint64_t step) const;
+    void move_memory(uint32_t from, uint32_t to);
+
+    Registers& m_regs;
+    Memory& m_memory;
+    const Program& m_program;
+    uint32_t m_interval;
+    uint32_t m_next = 0;
+    uint64_t m_cursor = 0;
+
+    std::vector<StepRecord> m_steps;
+    std::vector<RegisterUndo> m_register_journal;
+    std::vector<MemoryWrite> m_memory_journal;
+    std::vector<Checkpoint> m_checkpoints;   // At every multiple of m_interval recorded so far
+};
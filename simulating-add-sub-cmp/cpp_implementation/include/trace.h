@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "change_tracking.h"
+#include "register_id.h"
+
+// One register write of a traced step, or a flags-only update when reg is None.
+// Flag changes ride on the last record of their step.
+struct TraceRecord {
+    uint32_t step;
+    uint16_t old_value;
+    uint16_t new_value;
+    uint16_t flags_toggled;     // Flags::value bits that changed
+    uint16_t flags_set;         // Subset of flags_toggled that went 0->1
+    RegisterId reg;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord should stay one 16-byte slot");
+
+// "ax:0x0->0x1 " / "ZF:0->1 ", the format of the text trace
+void append_register_change(std::string& out, RegisterId id, uint16_t old_value, uint16_t new_value);
+void append_flag_change(std::string& out, uint16_t mask, bool old_value, bool new_value);
+std::string format_changes(const ChangeSet& changes);
+// Same text rebuilt from the records of one step
+std::string format_trace_step(const TraceRecord* records, size_t count);
+
+class TraceWriter;
+
+// Fixed-capacity ring of trace records, allocated once up front. Recording a step
+// never allocates. With a writer attached, a full ring is drained to it; without
+// one the oldest records are overwritten and counted as dropped.
+class TraceBuffer {
+public:
+    // Capacity is rounded up to a power of two
+    explicit TraceBuffer(size_t capacity);
+
+    void set_writer(TraceWriter* writer) { m_writer = writer; }
+
+    void record_step(uint32_t step, const ChangeSet& changes);
+
+    // Hands any buffered records to the writer
+    void flush();
+
+    size_t size() const { return static_cast<size_t>(m_head - m_tail); }
+    size_t capacity() const { return m_records.size(); }
+    uint64_t dropped() const { return m_dropped; }
+
+    // Retained records, oldest first
+    const TraceRecord& operator[](size_t index) const {
+        return m_records[static_cast<size_t>(m_tail + index) & m_mask];
+    }
+
+private:
+    void push(const TraceRecord& record);
+
+    std::vector<TraceRecord> m_records;
+    size_t m_mask;
+    uint64_t m_head = 0;    // Records ever pushed
+    uint64_t m_tail = 0;    // First record still held
+    uint64_t m_dropped = 0;
+    TraceWriter* m_writer = nullptr;
+};
+
+// Per-stream state shared by the encoder and decoder: values are stored as XOR
+// deltas against what the stream last saw, so steady traces shrink to a few bytes
+struct TraceCodecState {
+    uint32_t last_step = 0;
+    uint16_t last_value[REGISTER_ID_COUNT] = {};
+};
+
+// Trace file: an 8-byte magic and a version byte, then one varint-encoded record
+// after another:
+//   step delta, tag (register id in bits 0-4, 0x20 = flags present),
+//   [old ^ last value of that register, new ^ old], [flags_toggled, flags_set]
+class TraceWriter {
+public:
+    // Throws std::runtime_error if the file cannot be created
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+
+    void write(const TraceRecord* records, size_t count);
+    // Writes what is buffered and closes the file. False if any write or the close
+    // failed (a full disk, for one), in which case the trace is incomplete.
+    bool finish();
+
+    uint64_t bytes_written() const { return m_bytes_written; }
+    uint64_t records_written() const { return m_records_written; }
+
+private:
+    void flush_bytes();
+
+    std::ofstream m_file;
+    std::vector<uint8_t> m_bytes;
+    TraceCodecState m_state;
+    uint64_t m_bytes_written = 0;
+    uint64_t m_records_written = 0;
+};
+
+class TraceReader {
+public:
+    // Reads the whole file. Throws std::runtime_error if it is missing or not a trace.
+    explicit TraceReader(const std::string& path);
+
+    // Returns false at end of stream; throws std::runtime_error on a truncated record
+    bool next(TraceRecord& record);
+
+private:
+    uint64_t read_varint();
+
+    std::vector<uint8_t> m_bytes;
+    size_t m_pos;
+    TraceCodecState m_state;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task deque. Submitted tasks are
+// spread round-robin over the deques; a worker takes from the back of its own deque
+// and, once that is empty, steals from the front of the others. Listings vary a lot
+// in length, so stealing keeps every core busy until the last task is taken.
+class WorkStealingPool {
+public:
+    // thread_count 0 uses std::thread::hardware_concurrency()
+    explicit WorkStealingPool(size_t thread_count = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t thread_count() const { return m_threads.size(); }
+
+    // Tasks must not throw; wrap anything that can
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished
+    void wait_idle();
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void worker_loop(size_t index);
+    bool try_take(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_next_queue{0};
+
+    std::mutex m_state_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_idle;
+    size_t m_queued = 0;     // Submitted, not yet taken by a worker
+    size_t m_unfinished = 0; // Submitted, not yet completed
+    bool m_stopping = false;
+};
@@ -0,0 +1,636 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "simulator.h"
+#include "timeline.h"
+#include "work_stealing_pool.h"
+
+// simulator_cpp: simulator_lib as a CPython extension (built with
+// -DSIMULATOR_BUILD_PYTHON=ON), for the notebooks the Python simulators drive:
+//
+//     import simulator_cpp
+//     sim = simulator_cpp.Simulator(lazy_flags=False, alu="reference")
+//     sim.load("listing_0046_add_sub_cmp.txt")
+//     while sim.step():
+//         print(sim.registers.tolist())   # read-only view, REGISTER_NAMES order
+//     result = sim.run()                  # whole program on a fresh machine, GIL released
+//     results = simulator_cpp.run_batch(paths, threads=0)
+//
+// Loads, runs and batches release the GIL, so Python threads fan out at C++ speed.
+// A Simulator serves one call at a time; a second thread using it meanwhile gets
+// RuntimeError instead of a data race.
+
+namespace {
+
+// Registers::ax through Registers::ip, then Registers::flags, read as one array
+constexpr const char* BUFFER_REGISTER_NAMES[] = {
+    "ax", "bx", "cx", "dx", "si", "di", "bp", "sp", "es", "cs", "ss", "ds", "ip", "flags",
+};
+constexpr Py_ssize_t REGISTER_WORD_COUNT = static_cast<Py_ssize_t>(std::size(BUFFER_REGISTER_NAMES));
+
+static_assert(sizeof(Register16) == sizeof(uint16_t) && sizeof(Flags) == sizeof(uint16_t),
+              "The register buffer reads each register as one word");
+
+// Shape and stride of the register buffer; CPython wants non-const pointers
+Py_ssize_t g_register_shape = REGISTER_WORD_COUNT;
+Py_ssize_t g_register_stride = sizeof(uint16_t);
+
+constexpr uint64_t DEFAULT_MAX_STEPS = 1000000;   // simulator_main's --max-steps default
+
+// The buffer hands out &ax as the start of the array, so the words must follow it in order
+bool registers_are_contiguous() {
+    Registers regs;
+    const char* base = reinterpret_cast<const char*>(&regs.ax);
+    const Register16* words[] = {
+        &regs.ax, &regs.bx, &regs.cx, &regs.dx, &regs.si, &regs.di, &regs.bp,
+        &regs.sp, &regs.es, &regs.cs, &regs.ss, &regs.ds, &regs.ip,
+    };
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+        if (reinterpret_cast<const char*>(words[i]) - base != static_cast<ptrdiff_t>(i * sizeof(uint16_t))) {
+            return false;
+        }
+    }
+    return reinterpret_cast<const char*>(&regs.flags) - base ==
+           static_cast<ptrdiff_t>((REGISTER_WORD_COUNT - 1) * sizeof(uint16_t));
+}
+
+struct RunOptions {
+    bool lazy_flags = false;
+    AluKernel alu_kernel = AluKernel::Reference;
+    uint64_t max_steps = DEFAULT_MAX_STEPS;
+};
+
+void apply_options(Simulator& sim, const RunOptions& options) {
+    sim.set_lazy_flags(options.lazy_flags);
+    sim.set_alu_kernel(options.alu_kernel);
+    sim.set_max_steps(options.max_steps);
+}
+
+// Fills `options` from the keyword values every entry point takes; false with a Python error set
+bool parse_options(int lazy_flags, const char* alu, long long max_steps, RunOptions& options) {
+    options.lazy_flags = lazy_flags != 0;
+    std::string kernel(alu);
+    if (kernel == "table") {
+        options.alu_kernel = AluKernel::Table;
+    } else if (kernel == "reference") {
+        options.alu_kernel = AluKernel::Reference;
+    } else {
+        PyErr_Format(PyExc_ValueError, "Unknown ALU kernel: %s", alu);
+        return false;
+    }
+    if (max_steps < 0) {
+        PyErr_Format(PyExc_ValueError, "Invalid step limit: %lld", max_steps);
+        return false;
+    }
+    options.max_steps = static_cast<uint64_t>(max_steps);
+    return true;
+}
+
+// Sets the Python error for a listing that could not be loaded or run
+void set_status_error(SimStatus status, const std::string& path) {
+    if (status == SimStatus::OutOfMemory) {
+        PyErr_NoMemory();
+    } else if (status == SimStatus::CannotOpenFile) {
+        PyErr_SetString(PyExc_OSError, status_message(status, Opcode::Invalid, path).c_str());
+    } else {
+        PyErr_SetString(PyExc_RuntimeError, status_message(status, Opcode::Invalid, path).c_str());
+    }
+}
+
+PyObject* line_status_dict(const LineStatus& status) {
+    return Py_BuildValue("{s:i,s:I,s:I,s:s}", "line", static_cast<int>(status.line), "column",
+                         static_cast<unsigned>(status.column), "length", static_cast<unsigned>(status.length),
+                         "status", status_name(status.status));
+}
+
+PyObject* result_dict(const SimulationResult& result) {
+    PyObject* first_error = result.first_error.ok() ? Py_NewRef(Py_None) : line_status_dict(result.first_error);
+    if (!first_error) return nullptr;
+    return Py_BuildValue("{s:n,s:n,s:n,s:O,s:O,s:O,s:N}",
+                         "instructions", static_cast<Py_ssize_t>(result.instructions),
+                         "errors", static_cast<Py_ssize_t>(result.errors),
+                         "mismatches", static_cast<Py_ssize_t>(result.mismatches),
+                         "final_checked", result.final_checked ? Py_True : Py_False,
+                         "final_match", result.final_match ? Py_True : Py_False,
+                         "passed", result.passed() ? Py_True : Py_False,
+                         "first_error", first_error);
+}
+
+// Everything behind one Python Simulator. The timeline, when there is one, has
+// stepped the loaded program from a fresh machine; run() discards it.
+struct SimulatorState {
+    Simulator sim;
+    Program program;
+    bool loaded = false;
+    std::unique_ptr<Timeline> timeline;
+    std::atomic<bool> busy{false};
+};
+
+struct SimulatorObject {
+    PyObject_HEAD
+    SimulatorState* state;
+};
+
+SimulatorState& state_of(PyObject* self) {
+    return *reinterpret_cast<SimulatorObject*>(self)->state;
+}
+
+// Claims a Simulator for one call
+class Claim {
+public:
+    explicit Claim(SimulatorState& state) : m_state(state), m_claimed(!state.busy.exchange(true)) {
+        if (!m_claimed) PyErr_SetString(PyExc_RuntimeError, "Simulator is in use by another thread");
+    }
+    ~Claim() {
+        if (m_claimed) m_state.busy.store(false);
+    }
+    Claim(const Claim&) = delete;
+    Claim& operator=(const Claim&) = delete;
+
+    explicit operator bool() const { return m_claimed; }
+
+private:
+    SimulatorState& m_state;
+    bool m_claimed;
+};
+
+PyObject* simulator_new(PyTypeObject* type, PyObject*, PyObject*) {
+    auto* self = reinterpret_cast<SimulatorObject*>(type->tp_alloc(type, 0));
+    if (!self) return nullptr;
+    self->state = new (std::nothrow) SimulatorState();
+    if (!self->state) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    self->state->sim.output().set_buffered(true);
+    apply_options(self->state->sim, RunOptions());
+    return reinterpret_cast<PyObject*>(self);
+}
+
+int simulator_init(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"lazy_flags", "alu", "max_steps", nullptr};
+    int lazy_flags = 0;
+    const char* alu = "reference";
+    long long max_steps = static_cast<long long>(DEFAULT_MAX_STEPS);
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|$psL:Simulator", const_cast<char**>(keywords), &lazy_flags,
+                                     &alu, &max_steps)) {
+        return -1;
+    }
+    RunOptions options;
+    if (!parse_options(lazy_flags, alu, max_steps, options)) return -1;
+
+    Claim claim(state_of(self));
+    if (!claim) return -1;
+    apply_options(state_of(self).sim, options);
+    return 0;
+}
+
+void simulator_dealloc(PyObject* self) {
+    PyTypeObject* type = Py_TYPE(self);
+    delete reinterpret_cast<SimulatorObject*>(self)->state;
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+// Makes `state` hold the newly loaded program, with a timeline ready at its first step
+void finish_load(SimulatorState& state, Program program) {
+    state.program = std::move(program);
+    state.loaded = true;
+    state.timeline = std::make_unique<Timeline>(state.sim.timeline(state.program));
+}
+
+PyObject* simulator_load(PyObject* self, PyObject* args) {
+    PyObject* path_bytes = nullptr;
+    if (!PyArg_ParseTuple(args, "O&:load", PyUnicode_FSConverter, &path_bytes)) return nullptr;
+    std::string path(PyBytes_AS_STRING(path_bytes), static_cast<size_t>(PyBytes_GET_SIZE(path_bytes)));
+    Py_DECREF(path_bytes);
+
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim) return nullptr;
+
+    SimStatus status = SimStatus::Ok;
+    Py_BEGIN_ALLOW_THREADS
+    state.timeline.reset();
+    state.loaded = false;
+    state.sim.reset();
+    Program program;
+    status = state.sim.try_load_program(path, program);
+    if (status == SimStatus::Ok) {
+        try {
+            finish_load(state, std::move(program));
+        } catch (const std::bad_alloc&) {
+            status = SimStatus::OutOfMemory;
+        } catch (const std::exception&) {
+            status = SimStatus::InternalError;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (status != SimStatus::Ok) {
+        set_status_error(status, path);
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* simulator_load_text(PyObject* self, PyObject* args) {
+    const char* text = nullptr;
+    Py_ssize_t size = 0;
+    if (!PyArg_ParseTuple(args, "s#:load_text", &text, &size)) return nullptr;
+
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim) return nullptr;
+
+    bool loaded = false;
+    std::string error;   // Empty when the failure was running out of memory
+    Py_BEGIN_ALLOW_THREADS
+    state.timeline.reset();
+    state.loaded = false;
+    state.sim.reset();
+    try {
+        finish_load(state, state.sim.load_text(std::string(text, static_cast<size_t>(size))));
+        loaded = true;
+    } catch (const std::bad_alloc&) {
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    if (!loaded) return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+// The loaded program, or null with a Python error set
+const Program* loaded_program(SimulatorState& state) {
+    if (state.loaded) return &state.program;
+    PyErr_SetString(PyExc_RuntimeError, "No program loaded; call load() or load_text() first");
+    return nullptr;
+}
+
+PyObject* simulator_step(PyObject* self, PyObject*) {
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim || !loaded_program(state)) return nullptr;
+
+    try {
+        if (!state.timeline) {
+            state.sim.reset();
+            state.timeline = std::make_unique<Timeline>(state.sim.timeline(state.program));
+        }
+        bool stepped = state.timeline->step();
+        state.sim.materialize_flags();
+        return PyBool_FromLong(stepped);
+    } catch (const std::bad_alloc&) {
+        return PyErr_NoMemory();
+    } catch (const std::exception& e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+}
+
+PyObject* simulator_step_back(PyObject* self, PyObject*) {
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim || !loaded_program(state)) return nullptr;
+
+    bool stepped = state.timeline && state.timeline->step_back();
+    state.sim.materialize_flags();
+    return PyBool_FromLong(stepped);
+}
+
+PyObject* simulator_run(PyObject* self, PyObject*) {
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim || !loaded_program(state)) return nullptr;
+
+    SimulationResult result;
+    bool ran = false;
+    std::string error;   // Empty when the failure was running out of memory
+    Py_BEGIN_ALLOW_THREADS
+    state.timeline.reset();
+    state.sim.reset();
+    try {
+        result = state.sim.run_program<ValidatePolicy>(state.program);
+        state.sim.materialize_flags();
+        ran = true;
+    } catch (const std::bad_alloc&) {
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    if (!ran) return PyErr_NoMemory();
+    return result_dict(result);
+}
+
+PyObject* simulator_get_registers(PyObject* self, PyObject*) {
+    const Registers& regs = state_of(self).sim.get_registers();
+    const uint16_t* words = &regs.ax.value;
+    PyObject* values = PyDict_New();
+    if (!values) return nullptr;
+    for (Py_ssize_t i = 0; i < REGISTER_WORD_COUNT; ++i) {
+        PyObject* value = PyLong_FromUnsignedLong(words[i]);
+        if (!value || PyDict_SetItemString(values, BUFFER_REGISTER_NAMES[i], value) < 0) {
+            Py_XDECREF(value);
+            Py_DECREF(values);
+            return nullptr;
+        }
+        Py_DECREF(value);
+    }
+    return values;
+}
+
+PyObject* simulator_line_errors(PyObject* self, PyObject*) {
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim) return nullptr;
+
+    PyObject* errors = PyList_New(0);
+    if (!errors || !state.loaded) return errors;
+    for (const ProgramLine& line : state.program.lines) {
+        if (line.status.ok()) continue;
+        PyObject* entry = line_status_dict(line.status);
+        PyObject* message = entry ? PyUnicode_DecodeUTF8(line.error.data(), line.error.size(), "replace") : nullptr;
+        bool added = message && PyDict_SetItemString(entry, "message", message) == 0 &&
+                     PyList_Append(errors, entry) == 0;
+        Py_XDECREF(message);
+        Py_XDECREF(entry);
+        if (!added) {
+            Py_DECREF(errors);
+            return nullptr;
+        }
+    }
+    return errors;
+}
+
+PyObject* simulator_drain_output(PyObject* self, PyObject*) {
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim) return nullptr;
+
+    static const char* LEVEL_NAMES[] = {"debug", "info", "warn", "error"};
+    PyObject* lines = PyList_New(0);
+    if (!lines) return nullptr;
+    bool failed = false;
+    state.sim.output().drain([&](OutputLevel level, std::string text) {
+        if (failed) return;
+        PyObject* line = Py_BuildValue("(ss#)", LEVEL_NAMES[static_cast<size_t>(level)], text.data(),
+                                       static_cast<Py_ssize_t>(text.size()));
+        failed = !line || PyList_Append(lines, line) < 0;
+        Py_XDECREF(line);
+    });
+    if (failed) {
+        Py_DECREF(lines);
+        return nullptr;
+    }
+    return lines;
+}
+
+PyObject* simulator_registers(PyObject* self, void*) {
+    return PyMemoryView_FromObject(self);
+}
+
+PyObject* simulator_current_step(PyObject* self, void*) {
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim) return nullptr;
+    return PyLong_FromUnsignedLongLong(state.timeline ? state.timeline->current_step() : 0);
+}
+
+PyObject* simulator_finished(PyObject* self, void*) {
+    SimulatorState& state = state_of(self);
+    Claim claim(state);
+    if (!claim) return nullptr;
+    return PyBool_FromLong(state.loaded && state.timeline && state.timeline->finished());
+}
+
+// The register words in place, read-only: ax..ip then flags, native-endian uint16
+int simulator_getbuffer(PyObject* self, Py_buffer* view, int flags) {
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "Simulator registers are read-only");
+        view->obj = nullptr;
+        return -1;
+    }
+    const Registers& regs = state_of(self).sim.get_registers();
+    view->buf = const_cast<uint16_t*>(&regs.ax.value);
+    view->obj = Py_NewRef(self);
+    view->len = REGISTER_WORD_COUNT * static_cast<Py_ssize_t>(sizeof(uint16_t));
+    view->readonly = 1;
+    view->itemsize = sizeof(uint16_t);
+    view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? const_cast<char*>("H") : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &g_register_shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &g_register_stride : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+PyMethodDef SIMULATOR_METHODS[] = {
+    {"load", static_cast<PyCFunction>(simulator_load), METH_VARARGS,
+     "load(path)\n--\n\nCompiles a listing file on a fresh machine, ready to step or run. "
+     "Lines that fail to compile do not fail the load; see line_errors()."},
+    {"load_text", static_cast<PyCFunction>(simulator_load_text), METH_VARARGS,
+     "load_text(text)\n--\n\nload() for a listing held in a string."},
+    {"step", static_cast<PyCFunction>(simulator_step), METH_NOARGS,
+     "step()\n--\n\nExecutes the next instruction; False once the program has finished. "
+     "After run(), stepping starts over on a fresh machine."},
+    {"step_back", static_cast<PyCFunction>(simulator_step_back), METH_NOARGS,
+     "step_back()\n--\n\nUndoes the last step; False at the first instruction."},
+    {"run", static_cast<PyCFunction>(simulator_run), METH_NOARGS,
+     "run()\n--\n\nRuns the loaded program on a fresh machine with expectation and final-state "
+     "checks, releasing the GIL, and returns its counts as a dict."},
+    {"get_registers", static_cast<PyCFunction>(simulator_get_registers), METH_NOARGS,
+     "get_registers()\n--\n\nA copy of the registers as a dict of name to value."},
+    {"line_errors", static_cast<PyCFunction>(simulator_line_errors), METH_NOARGS,
+     "line_errors()\n--\n\nLines of the loaded program that failed to compile: line, column, "
+     "length, status and message."},
+    {"drain_output", static_cast<PyCFunction>(simulator_drain_output), METH_NOARGS,
+     "drain_output()\n--\n\nDiagnostics since the machine was last reset, as (level, text) pairs, "
+     "and clears them."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyGetSetDef SIMULATOR_GETSET[] = {
+    {"registers", simulator_registers, nullptr,
+     "Read-only memoryview of the registers in place (uint16, REGISTER_NAMES order)", nullptr},
+    {"current_step", simulator_current_step, nullptr,
+     "Steps taken since the program started", nullptr},
+    {"finished", simulator_finished, nullptr,
+     "True once stepping has run off the end of the program", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyType_Slot SIMULATOR_SLOTS[] = {
+    {Py_tp_doc, const_cast<char*>("Simulator(*, lazy_flags=False, alu='reference', max_steps=1000000)\n--\n\n"
+                                  "One 8086 machine: registers, 1 MiB of memory and a loaded program.")},
+    {Py_tp_new, reinterpret_cast<void*>(simulator_new)},
+    {Py_tp_init, reinterpret_cast<void*>(simulator_init)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(simulator_dealloc)},
+    {Py_tp_methods, SIMULATOR_METHODS},
+    {Py_tp_getset, SIMULATOR_GETSET},
+    {Py_bf_getbuffer, reinterpret_cast<void*>(simulator_getbuffer)},
+    {0, nullptr},
+};
+
+PyType_Spec SIMULATOR_SPEC = {
+    "simulator_cpp.Simulator",
+    sizeof(SimulatorObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    SIMULATOR_SLOTS,
+};
+
+// Outcome of one listing in a batch
+struct BatchEntry {
+    SimStatus status = SimStatus::Ok;
+    SimulationResult result;
+};
+
+PyObject* run_batch(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"paths", "threads", "lazy_flags", "alu", "max_steps", nullptr};
+    PyObject* path_objects = nullptr;
+    Py_ssize_t threads = 0;
+    int lazy_flags = 0;
+    const char* alu = "reference";
+    long long max_steps = static_cast<long long>(DEFAULT_MAX_STEPS);
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|n$psL:run_batch", const_cast<char**>(keywords), &path_objects,
+                                     &threads, &lazy_flags, &alu, &max_steps)) {
+        return nullptr;
+    }
+    RunOptions options;
+    if (!parse_options(lazy_flags, alu, max_steps, options)) return nullptr;
+    if (threads < 0) {
+        PyErr_Format(PyExc_ValueError, "Invalid thread count: %zd", threads);
+        return nullptr;
+    }
+
+    PyObject* sequence = PySequence_Fast(path_objects, "paths must be a sequence of file paths");
+    if (!sequence) return nullptr;
+    std::vector<std::string> paths;
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(sequence); ++i) {
+        PyObject* path_bytes = nullptr;
+        if (!PyUnicode_FSConverter(PySequence_Fast_GET_ITEM(sequence, i), &path_bytes)) {
+            Py_DECREF(sequence);
+            return nullptr;
+        }
+        paths.emplace_back(PyBytes_AS_STRING(path_bytes), static_cast<size_t>(PyBytes_GET_SIZE(path_bytes)));
+        Py_DECREF(path_bytes);
+    }
+    Py_DECREF(sequence);
+
+    // Each listing runs on its own Simulator, as run_listings does, without logging its output
+    std::vector<BatchEntry> entries(paths.size());
+    Py_BEGIN_ALLOW_THREADS
+    WorkStealingPool pool(static_cast<size_t>(threads));
+    for (size_t i = 0; i < paths.size(); ++i) {
+        pool.submit([&, i] {
+            BatchEntry& entry = entries[i];
+            try {
+                Simulator sim;
+                apply_options(sim, options);
+                sim.output().set_buffered(true);
+                Program program;
+                entry.status = sim.try_load_program(paths[i], program);
+                if (entry.status == SimStatus::Ok) entry.result = sim.run_program<ValidatePolicy>(program);
+            } catch (const std::bad_alloc&) {
+                entry.status = SimStatus::OutOfMemory;
+            } catch (const std::exception&) {
+                entry.status = SimStatus::InternalError;
+            }
+        });
+    }
+    pool.wait_idle();
+    Py_END_ALLOW_THREADS
+
+    PyObject* reports = PyList_New(static_cast<Py_ssize_t>(entries.size()));
+    if (!reports) return nullptr;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        PyObject* report = result_dict(entries[i].result);
+        PyObject* path = report ? PyUnicode_DecodeFSDefaultAndSize(paths[i].data(), paths[i].size()) : nullptr;
+        PyObject* status = path ? PyUnicode_FromString(status_name(entries[i].status)) : nullptr;
+        bool filled = status && PyDict_SetItemString(report, "path", path) == 0 &&
+                      PyDict_SetItemString(report, "status", status) == 0;
+        if (filled && entries[i].status != SimStatus::Ok) {
+            filled = PyDict_SetItemString(report, "passed", Py_False) == 0;
+        }
+        Py_XDECREF(path);
+        Py_XDECREF(status);
+        if (!filled) {
+            Py_XDECREF(report);
+            Py_DECREF(reports);
+            return nullptr;
+        }
+        PyList_SET_ITEM(reports, static_cast<Py_ssize_t>(i), report);
+    }
+    return reports;
+}
+
+PyMethodDef MODULE_METHODS[] = {
+    {"run_batch", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(run_batch)),
+     METH_VARARGS | METH_KEYWORDS,
+     "run_batch(paths, threads=0, *, lazy_flags=False, alu='reference', max_steps=1000000)\n--\n\n"
+     "Runs every listing on its own machine across a thread pool (0 = all cores) with the GIL "
+     "released. Returns a dict per path, in order, with its status ('ok' or why it could not "
+     "be loaded) and run() counts."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef SIMULATOR_MODULE = {
+    PyModuleDef_HEAD_INIT,
+    "simulator_cpp",
+    "The C++ 8086 simulator core (simulator_lib).",
+    -1,
+    MODULE_METHODS,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+};
+
+}  // namespace
+
+PyMODINIT_FUNC PyInit_simulator_cpp() {
+    if (!registers_are_contiguous()) {
+        PyErr_SetString(PyExc_ImportError, "simulator_cpp: Registers layout does not allow a register buffer");
+        return nullptr;
+    }
+
+    PyObject* module = PyModule_Create(&SIMULATOR_MODULE);
+    if (!module) return nullptr;
+
+    PyObject* simulator_type = PyType_FromSpec(&SIMULATOR_SPEC);
+    PyObject* names = PyTuple_New(REGISTER_WORD_COUNT);
+    bool filled = simulator_type && names;
+    for (Py_ssize_t i = 0; filled && i < REGISTER_WORD_COUNT; ++i) {
+        PyObject* name = PyUnicode_FromString(BUFFER_REGISTER_NAMES[i]);
+        filled = name != nullptr;
+        if (filled) PyTuple_SET_ITEM(names, i, name);
+    }
+    if (!filled || PyModule_AddObjectRef(module, "Simulator", simulator_type) < 0 ||
+        PyModule_AddObjectRef(module, "REGISTER_NAMES", names) < 0) {
+        Py_XDECREF(simulator_type);
+        Py_XDECREF(names);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    Py_DECREF(simulator_type);
+    Py_DECREF(names);
+    return module;
+}
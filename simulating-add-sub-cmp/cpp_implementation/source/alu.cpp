@@ -0,0 +1,69 @@
+#include <array>
+#include "alu.h"
+
+// Tables indexed by [carry_in][a][b]; the carry-in half lets 16-bit ops chain two bytes
+constexpr size_t ALU_TABLE_SIZE = 2 * 256 * 256;
+using AluTable = std::array<uint16_t, ALU_TABLE_SIZE>;
+
+static constexpr AluTable make_alu_table(bool is_sub) {
+    AluTable table{};
+    for (unsigned carry = 0; carry < 2; ++carry) {
+        for (unsigned a = 0; a < 256; ++a) {
+            for (unsigned b = 0; b < 256; ++b) {
+                table[(carry << 16) | (a << 8) | b] =
+                    alu8_entry(static_cast<uint8_t>(a), static_cast<uint8_t>(b), carry != 0, is_sub);
+            }
+        }
+    }
+    return table;
+}
+
+static constexpr AluTable ADD_TABLE = make_alu_table(false);
+static constexpr AluTable SUB_TABLE = make_alu_table(true);
+
+static_assert(alu_entry_flags(ADD_TABLE[0]) == (FLAG_ZF | FLAG_PF), "0 + 0 sets ZF and PF");
+static_assert(alu_entry_flags(SUB_TABLE[1]) == (FLAG_CF | FLAG_PF | FLAG_AF | FLAG_SF), "0 - 1 borrows");
+static_assert(alu_entry_flags(ADD_TABLE[(0x7F << 8) | 1]) == (FLAG_AF | FLAG_SF | FLAG_OF), "0x7F + 1 overflows");
+static_assert(alu_reference(FlagsOp::Sub, 0, 1, true).flags == alu_entry_flags(SUB_TABLE[1]),
+              "Reference and table kernels agree");
+
+static uint16_t table_entry(const AluTable& table, bool carry, uint8_t a, uint8_t b) {
+    return table[(static_cast<size_t>(carry) << 16) | (static_cast<size_t>(a) << 8) | b];
+}
+
+static AluResult alu_table(FlagsOp op, uint16_t a, uint16_t b, bool is_8bit) {
+    const AluTable& table = (op == FlagsOp::Sub) ? SUB_TABLE : ADD_TABLE;
+
+    uint16_t low = table_entry(table, false, static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+    if (is_8bit) {
+        return {alu_entry_value(low), alu_entry_flags(low)};
+    }
+
+    // 16-bit: the high byte consumes the low byte's carry/borrow. CF, SF and OF come
+    // from the high byte, AF and PF from the low byte, ZF needs both bytes zero.
+    bool carry = (alu_entry_flags(low) & FLAG_CF) != 0;
+    uint16_t high = table_entry(table, carry, static_cast<uint8_t>(a >> 8), static_cast<uint8_t>(b >> 8));
+
+    uint16_t low_flags = alu_entry_flags(low);
+    uint16_t high_flags = alu_entry_flags(high);
+    uint16_t flags = static_cast<uint16_t>((high_flags & (FLAG_CF | FLAG_SF | FLAG_OF)) |
+                                           (low_flags & (FLAG_PF | FLAG_AF)) |
+                                           (low_flags & high_flags & FLAG_ZF));
+    uint16_t value = static_cast<uint16_t>(alu_entry_value(low) | (alu_entry_value(high) << 8));
+    return {value, flags};
+}
+
+AluResult alu_execute(AluKernel kernel, FlagsOp op, uint16_t a, uint16_t b, bool is_8bit) {
+    if (kernel == AluKernel::Table) {
+        return alu_table(op, a, b, is_8bit);
+    }
+    return alu_reference(op, a, b, is_8bit);
+}
+
+uint16_t arithmetic_flags(AluKernel kernel, const PendingFlags& pending) {
+    if (kernel == AluKernel::Table) {
+        return alu_table(pending.op, pending.old_value, pending.operand, pending.is_8bit != 0).flags;
+    }
+    return arithmetic_flags(pending.result, pending.old_value, pending.operand,
+                            pending.is_8bit != 0, pending.op == FlagsOp::Sub);
+}
@@ -0,0 +1,6 @@
+// Built with AVX2 code generation enabled; only called after a runtime CPU check.
+#include "batch_kernel.h"
+
+void run_batch_avx2(const BatchOp* ops, size_t op_count, const BatchBlock& block) {
+    run_batch_ops<Avx2Lanes>(ops, op_count, block);
+}
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "batch_kernel.h"
+#include "batch_simulator.h"
+
+#if defined(_MSC_VER) && defined(SIMULATOR_HAS_AVX2_KERNEL)
+#include <intrin.h>
+#endif
+
+// Lanes processed per pass over the instruction stream; keeps a block's registers in L1
+static constexpr size_t BLOCK_LANES = 512;
+static constexpr size_t LANE_ALIGNMENT = 16;
+
+void run_batch_scalar(const BatchOp* ops, size_t op_count, const BatchBlock& block) {
+    run_batch_ops<ScalarLanes>(ops, op_count, block);
+}
+
+#ifdef SIMULATOR_HAS_SSE2
+void run_batch_sse2(const BatchOp* ops, size_t op_count, const BatchBlock& block) {
+    run_batch_ops<Sse2Lanes>(ops, op_count, block);
+}
+#endif
+
+static bool cpu_supports_avx2() {
+#if !defined(SIMULATOR_HAS_AVX2_KERNEL)
+    return false;
+#elif defined(__GNUC__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+BatchExpectation BatchExpectation::from_registers(const Registers& regs, uint16_t word_mask, uint16_t flags_mask) {
+    BatchExpectation expected{};
+    for (size_t slot = 0; slot < WORD_REGISTER_COUNT; ++slot) {
+        expected.words[slot] = regs.read(word_register_id(slot));
+    }
+    expected.word_mask = word_mask;
+    expected.flags = regs.resolved_flags().value;
+    expected.flags_mask = flags_mask;
+    return expected;
+}
+
+BatchSimulator::BatchSimulator(size_t lane_count)
+    : m_lane_count(lane_count),
+      m_padded_count((lane_count + LANE_ALIGNMENT - 1) / LANE_ALIGNMENT * LANE_ALIGNMENT),
+      m_kernel(BatchKernel::Auto) {
+    for (auto& words : m_words) {
+        words.assign(m_padded_count, 0);
+    }
+    m_flags.assign(m_padded_count, 0);
+}
+
+BatchKernel BatchSimulator::resolved_kernel() const {
+    BatchKernel kernel = m_kernel;
+    if (kernel == BatchKernel::Auto) {
+        kernel = cpu_supports_avx2() ? BatchKernel::Avx2 : BatchKernel::Sse2;
+    }
+    if (kernel == BatchKernel::Avx2 && !cpu_supports_avx2()) {
+        kernel = BatchKernel::Sse2;
+    }
+#ifndef SIMULATOR_HAS_SSE2
+    if (kernel == BatchKernel::Sse2) {
+        kernel = BatchKernel::Scalar;
+    }
+#endif
+    return kernel;
+}
+
+void BatchSimulator::set_lane(size_t lane, const Registers& regs) {
+    for (size_t slot = 0; slot < WORD_REGISTER_COUNT; ++slot) {
+        m_words[slot][lane] = regs.read(word_register_id(slot));
+    }
+    m_flags[lane] = regs.resolved_flags().value;
+}
+
+Registers BatchSimulator::lane_registers(size_t lane) const {
+    Registers regs;
+    for (size_t slot = 0; slot < WORD_REGISTER_COUNT; ++slot) {
+        regs.write(word_register_id(slot), m_words[slot][lane]);
+    }
+    regs.flags.value = m_flags[lane];
+    return regs;
+}
+
+static BatchOp lower_instruction(const Instruction& instr, const ProgramLine& info) {
+    bool supported = !is_jump(instr.opcode) && instr.opcode != Opcode::Invalid &&
+                     instr.dest_kind == OperandKind::Register &&
+                     (instr.src_kind == OperandKind::Register || instr.src_kind == OperandKind::Immediate);
+    if (!supported) {
+        throw std::invalid_argument("Batch simulation does not support line " +
+                                    std::to_string(info.line_number) + ": " + std::string(info.display));
+    }
+
+    BatchOp op{};
+    switch (instr.opcode) {
+        case Opcode::Mov: op.kind = BatchOpKind::Mov; break;
+        case Opcode::Add: op.kind = BatchOpKind::Add; break;
+        case Opcode::Sub: op.kind = BatchOpKind::Sub; break;
+        default: op.kind = BatchOpKind::Cmp; break;
+    }
+    op.is_8bit = instr.width == OperandWidth::Byte;
+    op.dest_slot = static_cast<uint8_t>(word_slot(instr.dest));
+    op.dest_high = is_high_byte(instr.dest);
+
+    if (instr.src_kind == OperandKind::Immediate) {
+        op.src_is_immediate = 1;
+        op.immediate = op.is_8bit ? static_cast<uint16_t>(instr.immediate & 0xFF) : instr.immediate;
+    } else {
+        op.src_slot = static_cast<uint8_t>(word_slot(instr.src));
+        op.src_high = is_high_byte(instr.src);
+        op.src_is_byte = is_8bit_register(instr.src);
+    }
+    return op;
+}
+
+void BatchSimulator::run(const Program& program) {
+    std::vector<BatchOp> ops;
+    ops.reserve(program.instructions.size());
+    for (size_t i = 0; i < program.instructions.size(); ++i) {
+        ops.push_back(lower_instruction(program.instructions[i], program.lines[i]));
+    }
+
+    // Straight-line code: every arithmetic op overwrites all arithmetic flags, so only
+    // the last one's flags can be observed and the rest skip flag computation.
+    for (size_t i = ops.size(); i-- > 0;) {
+        if (ops[i].kind != BatchOpKind::Mov) {
+            ops[i].flags_live = 1;
+            break;
+        }
+    }
+
+    BatchKernel kernel = resolved_kernel();
+    for (size_t start = 0; start < m_padded_count; start += BLOCK_LANES) {
+        BatchBlock block;
+        for (size_t slot = 0; slot < WORD_REGISTER_COUNT; ++slot) {
+            block.words[slot] = m_words[slot].data() + start;
+        }
+        block.flags = m_flags.data() + start;
+        block.count = std::min(BLOCK_LANES, m_padded_count - start);
+
+        switch (kernel) {
+#ifdef SIMULATOR_HAS_AVX2_KERNEL
+            case BatchKernel::Avx2: run_batch_avx2(ops.data(), ops.size(), block); break;
+#endif
+#ifdef SIMULATOR_HAS_SSE2
+            case BatchKernel::Sse2: run_batch_sse2(ops.data(), ops.size(), block); break;
+#endif
+            default: run_batch_scalar(ops.data(), ops.size(), block); break;
+        }
+    }
+}
+
+std::vector<size_t> BatchSimulator::diverging_lanes(const BatchExpectation& expected) const {
+    std::vector<uint8_t> diverged(m_lane_count, 0);
+
+    for (size_t slot = 0; slot < WORD_REGISTER_COUNT; ++slot) {
+        if (!(expected.word_mask & (1u << slot))) continue;
+        const uint16_t* words = m_words[slot].data();
+        for (size_t lane = 0; lane < m_lane_count; ++lane) {
+            diverged[lane] |= words[lane] != expected.words[slot];
+        }
+    }
+
+    if (expected.flags_mask) {
+        uint16_t want = expected.flags & expected.flags_mask;
+        for (size_t lane = 0; lane < m_lane_count; ++lane) {
+            diverged[lane] |= (m_flags[lane] & expected.flags_mask) != want;
+        }
+    }
+
+    std::vector<size_t> lanes;
+    for (size_t lane = 0; lane < m_lane_count; ++lane) {
+        if (diverged[lane]) lanes.push_back(lane);
+    }
+    return lanes;
+}
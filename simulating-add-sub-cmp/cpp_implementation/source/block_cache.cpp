@@ -0,0 +1,43 @@
+#include "block_cache.h"
+
+void BlockCache::reset(const Program& program) {
+    m_program = &program;
+    m_blocks.clear();
+    m_block_by_start.assign(program.instructions.size(), NO_BLOCK);
+}
+
+uint32_t BlockCache::entry() {
+    return m_block_by_start.empty() ? NO_BLOCK : block_at(0);
+}
+
+uint32_t BlockCache::block_at(uint32_t start) {
+    uint32_t& slot = m_block_by_start[start];
+    if (slot != NO_BLOCK) return slot;
+
+    // A block runs up to and including the next jump. Jumping into the middle of an
+    // existing block starts a new, overlapping one rather than splitting it.
+    const std::vector<Instruction>& instructions = m_program->instructions;
+    uint32_t end = start;
+    while (end < instructions.size()) {
+        bool is_block_end = is_jump(instructions[end].opcode);
+        end++;
+        if (is_block_end) break;
+    }
+
+    slot = static_cast<uint32_t>(m_blocks.size());
+    m_blocks.push_back({start, end, UNLINKED_BLOCK, UNLINKED_BLOCK, 0});
+    return slot;
+}
+
+uint32_t BlockCache::successor(uint32_t block, bool taken) {
+    uint32_t link = taken ? m_blocks[block].taken : m_blocks[block].fallthrough;
+    if (link != UNLINKED_BLOCK) return link;
+
+    uint32_t end = m_blocks[block].end;
+    uint32_t target = taken ? m_program->lines[end - 1].jump_target : end;
+    uint32_t next = target < m_block_by_start.size() ? block_at(target) : NO_BLOCK;
+
+    // block_at may have grown m_blocks, so the block is looked up again
+    (taken ? m_blocks[block].taken : m_blocks[block].fallthrough) = next;
+    return next;
+}
@@ -1,209 +1,254 @@
-#include <sstream>
+#include <array>
+#include <charconv>
 #include <stdexcept>
 #include "commands.h"
-#include "logger.h"
 
-static std::string clean_operand(const std::string& operand) {
-    std::string cleaned = operand;
-    if (!cleaned.empty() && cleaned.back() == ',') {
-        cleaned.pop_back();
+static std::string_view clean_operand(std::string_view operand) {
+    if (!operand.empty() && operand.back() == ',') {
+        operand.remove_suffix(1);
     }
-    return cleaned;
+    return operand;
 }
 
-static bool is_immediate_value(const std::string& operand) {
-    return std::isdigit(operand[0]) || operand[0] == '-';
+static bool is_immediate_value(std::string_view operand) {
+    return std::isdigit(static_cast<unsigned char>(operand[0])) || operand[0] == '-';
 }
 
-static int parse_operand(Registers& regs, const std::string& operand) {
-    std::string cleaned = clean_operand(operand);
-
-    if (cleaned.empty()) throw std::runtime_error("Empty operand");
-
-    if (is_immediate_value(cleaned)) {
-        return std::stoi(cleaned);
-    }
-
-    if (regs.is8(cleaned)) {
-        return regs.get8(cleaned);
-    } else if (regs.is16(cleaned)) {
-        return regs.get16(cleaned);
-    }
-
-    throw std::runtime_error("Unknown operand: " + cleaned);
+static SimStatus parse_immediate(std::string_view operand, uint16_t& immediate) {
+    int value = 0;
+    auto [end, ec] = std::from_chars(operand.data(), operand.data() + operand.size(), value);
+    if (ec == std::errc::result_out_of_range) return SimStatus::ImmediateOutOfRange;
+    if (ec != std::errc() || end == operand.data()) return SimStatus::InvalidImmediate;
+    immediate = static_cast<uint16_t>(value);
+    return SimStatus::Ok;
 }
 
-static constexpr uint8_t BITS_IN_BYTE = 8;
+static OperandWidth register_width(RegisterId id) {
+    return is_8bit_register(id) ? OperandWidth::Byte : OperandWidth::Word;
+}
 
-static bool calculate_parity(uint8_t value) {
-    uint8_t count = 0;
-    for (uint8_t i = 0; i < BITS_IN_BYTE; i++) {
-        if (value & (1 << i)) count++;
-    }
-    return (count % 2) == 0;
+static bool is_memory_operand(std::string_view operand) {
+    return operand.find('[') != std::string_view::npos;
 }
 
-static bool has_signed_overflow_sub(int16_t old_val, int16_t operand, int16_t result) {
-    return (old_val >= 0 && operand < 0 && result < 0) ||
-           (old_val < 0 && operand >= 0 && result >= 0);
+static std::string_view trim_operand(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+    return text;
 }
 
-static bool has_signed_overflow_add(int16_t old_val, int16_t operand, int16_t result) {
-    return (old_val >= 0 && operand >= 0 && result < 0) ||
-           (old_val < 0 && operand < 0 && result >= 0);
+// Effective-address form for the registers named inside the brackets
+static EffectiveAddress address_form(bool bx, bool bp, bool si, bool di) {
+    if (bx && bp) return EffectiveAddress::None;
+    if (si && di) return EffectiveAddress::None;
+    if (bx) return si ? EffectiveAddress::BxSi : di ? EffectiveAddress::BxDi : EffectiveAddress::Bx;
+    if (bp) return si ? EffectiveAddress::BpSi : di ? EffectiveAddress::BpDi : EffectiveAddress::Bp;
+    if (si) return EffectiveAddress::Si;
+    if (di) return EffectiveAddress::Di;
+    return EffectiveAddress::Direct;
 }
 
-static void update_flags_arithmetic(Registers& regs, uint16_t result, uint16_t old_val, uint16_t operand, bool is_8bit, bool is_sub) {
-    regs.flags.ZF = (result == 0) ? 1 : 0;
+// Parses a memory operand in listing syntax: an optional "byte"/"word" size, an
+// optional segment override ("es:") and a bracketed sum of bx/bp/si/di and
+// displacements, e.g. "word es:[bp + si - 4]". Sets width to the explicit size, if
+// any. On failure, fault is the offending part of the operand.
+static SimStatus compile_memory(Instruction& instr, std::string_view operand, OperandWidth& width, bool& sized,
+                                std::string_view& fault) {
+    sized = false;
+    width = OperandWidth::Word;
+    if (operand.substr(0, 5) == "byte " || operand.substr(0, 5) == "word ") {
+        sized = true;
+        width = operand[0] == 'b' ? OperandWidth::Byte : OperandWidth::Word;
+        operand = trim_operand(operand.substr(5));
+    }
 
-    if (is_8bit) {
-        regs.flags.SF = ((result & 0x80) != 0) ? 1 : 0;
-        regs.flags.PF = calculate_parity(static_cast<uint8_t>(result)) ? 1 : 0;
-    } else {
-        regs.flags.SF = ((result & 0x8000) != 0) ? 1 : 0;
-        regs.flags.PF = calculate_parity(static_cast<uint8_t>(result & 0xFF)) ? 1 : 0;
+    fault = operand;
+    size_t open = operand.find('[');
+    size_t close = operand.rfind(']');
+    if (close == std::string_view::npos || close < open || close + 1 != operand.size()) {
+        return SimStatus::MalformedMemoryOperand;
     }
 
-    if (is_sub) {
-        regs.flags.CF = (old_val < operand) ? 1 : 0;
-        if (is_8bit) {
-            regs.flags.OF = has_signed_overflow_sub(
-                static_cast<int8_t>(old_val),
-                static_cast<int8_t>(operand),
-                static_cast<int8_t>(result)) ? 1 : 0;
-        } else {
-            regs.flags.OF = has_signed_overflow_sub(
-                static_cast<int16_t>(old_val),
-                static_cast<int16_t>(operand),
-                static_cast<int16_t>(result)) ? 1 : 0;
+    instr.segment = RegisterId::None;
+    std::string_view prefix = trim_operand(operand.substr(0, open));
+    if (!prefix.empty()) {
+        RegisterId segment = prefix.back() == ':' ? register_id_from_name(trim_operand(prefix.substr(0, prefix.size() - 1)))
+                                                  : RegisterId::None;
+        if (!is_segment_register(segment)) {
+            fault = prefix;
+            return SimStatus::InvalidSegmentOverride;
         }
-    } else {
-        if (is_8bit) {
-            regs.flags.CF = (result < (old_val & 0xFF)) ? 1 : 0;
-            regs.flags.OF = has_signed_overflow_add(
-                static_cast<int8_t>(old_val),
-                static_cast<int8_t>(operand),
-                static_cast<int8_t>(result)) ? 1 : 0;
+        instr.segment = segment;
+    }
+
+    bool bx = false, bp = false, si = false, di = false;
+    int displacement = 0;
+    std::string_view terms = operand.substr(open + 1, close - open - 1);
+    bool negative = false;
+    size_t pos = 0;
+    while (true) {
+        size_t next = terms.find_first_of("+-", pos);
+        std::string_view term = trim_operand(terms.substr(pos, next == std::string_view::npos ? next : next - pos));
+
+        if (term.empty()) {
+            // Only a leading minus stands without a term before it ("[-4]")
+            if (pos != 0 || next == std::string_view::npos || terms[next] != '-') {
+                return SimStatus::MalformedMemoryOperand;
+            }
+        } else if (std::isdigit(static_cast<unsigned char>(term[0]))) {
+            uint16_t value = 0;
+            SimStatus status = parse_immediate(term, value);
+            if (status != SimStatus::Ok) {
+                fault = term;
+                return status;
+            }
+            displacement += negative ? -static_cast<int>(value) : static_cast<int>(value);
         } else {
-            regs.flags.CF = (result < old_val) ? 1 : 0;
-            regs.flags.OF = has_signed_overflow_add(
-                static_cast<int16_t>(old_val),
-                static_cast<int16_t>(operand),
-                static_cast<int16_t>(result)) ? 1 : 0;
+            bool* used = term == "bx" ? &bx : term == "bp" ? &bp : term == "si" ? &si : term == "di" ? &di : nullptr;
+            if (!used || *used || negative) {
+                fault = term;
+                return SimStatus::InvalidAddressRegister;
+            }
+            *used = true;
         }
-    }
-}
 
-std::string cmd_mov(Registers& regs, const std::vector<std::string>& args) {
-    if (args.size() != 2) {
-        throw std::runtime_error("mov requires 2 arguments");
+        if (next == std::string_view::npos) break;
+        negative = terms[next] == '-';
+        pos = next + 1;
     }
 
-    std::string dest = clean_operand(args[0]);
-    std::string src = clean_operand(args[1]);
+    instr.ea = address_form(bx, bp, si, di);
+    if (instr.ea == EffectiveAddress::None) return SimStatus::InvalidAddressRegisters;
+    instr.displacement = static_cast<uint16_t>(displacement);
+    return SimStatus::Ok;
+}
 
-    int src_value = parse_operand(regs, src);
+// Resolves a source operand into either a register id or an immediate
+static SimStatus compile_source(Instruction& instr, std::string_view operand) {
+    if (operand.empty()) return SimStatus::EmptyOperand;
 
-    if (regs.is8(dest)) {
-        regs.get8(dest) = static_cast<uint8_t>(src_value);  // Proxy tracks change automatically
-        LOGGER.Debug("mov {}, {} -> {}[8] = {}", dest, src, dest, static_cast<int>(static_cast<uint8_t>(regs.get8(dest))));
-    } else if (regs.is16(dest)) {
-        regs.get16(dest) = static_cast<uint16_t>(src_value);  // Proxy tracks change automatically
-        LOGGER.Debug("mov {}, {} -> {}[16] = {}", dest, src, dest, static_cast<uint16_t>(regs.get16(dest)));
-    } else {
-        throw std::runtime_error("Unknown destination register: " + dest);
+    if (is_immediate_value(operand)) {
+        instr.src_kind = OperandKind::Immediate;
+        instr.src = RegisterId::None;
+        return parse_immediate(operand, instr.immediate);
     }
 
-    return "OK";
+    instr.src_kind = OperandKind::Register;
+    instr.src = register_id_from_name(operand);
+    if (instr.src == RegisterId::None || instr.src == RegisterId::IP) return SimStatus::UnknownOperand;
+    return SimStatus::Ok;
 }
 
-std::string cmd_add(Registers& regs, const std::vector<std::string>& args) {
-    if (args.size() != 2) {
-        throw std::runtime_error("add requires 2 arguments");
-    }
-
-    std::string dest = clean_operand(args[0]);
-    std::string src = clean_operand(args[1]);
-
-    int src_value = parse_operand(regs, src);
-
-    if (regs.is8(dest)) {
-        uint8_t old_val = regs.get8(dest);
-        regs.get8(dest) += static_cast<uint8_t>(src_value);
-        uint8_t new_val = regs.get8(dest);
-        update_flags_arithmetic(regs, new_val, old_val, static_cast<uint8_t>(src_value), true, false);
-        LOGGER.Debug("add {}, {} -> {}[8] = {} (was {})", dest, src, dest,
-                    static_cast<int>(new_val), static_cast<int>(old_val));
-    } else if (regs.is16(dest)) {
-        uint16_t old_val = regs.get16(dest);
-        regs.get16(dest) += static_cast<uint16_t>(src_value);
-        uint16_t new_val = regs.get16(dest);
-        update_flags_arithmetic(regs, new_val, old_val, static_cast<uint16_t>(src_value), false, false);
-        LOGGER.Debug("add {}, {} -> {}[16] = {} (was {})", dest, src, dest, new_val, old_val);
-    } else {
-        throw std::runtime_error("Unknown destination register: " + dest);
-    }
+constexpr uint8_t EMPTY_COMMAND_SLOT = 0xFF;
+constexpr size_t COMMAND_SLOT_MASK = COMMAND_SLOT_COUNT - 1;
 
-    return "OK";
-}
+// Linear probing; entries whose hashes collide simply take the next free slot
+constexpr std::array<uint8_t, COMMAND_SLOT_COUNT> build_command_slots() {
+    std::array<uint8_t, COMMAND_SLOT_COUNT> slots{};
+    for (auto& slot : slots) slot = EMPTY_COMMAND_SLOT;
 
-std::string cmd_sub(Registers& regs, const std::vector<std::string>& args) {
-    if (args.size() != 2) {
-        throw std::runtime_error("sub requires 2 arguments");
+    for (size_t i = 0; i < COMMANDS_TABLE_SIZE; ++i) {
+        size_t slot = commands_table[i].hash & COMMAND_SLOT_MASK;
+        while (slots[slot] != EMPTY_COMMAND_SLOT) slot = (slot + 1) & COMMAND_SLOT_MASK;
+        slots[slot] = static_cast<uint8_t>(i);
     }
+    return slots;
+}
 
-    std::string dest = clean_operand(args[0]);
-    std::string src = clean_operand(args[1]);
-
-    int src_value = parse_operand(regs, src);
-
-    if (regs.is8(dest)) {
-        uint8_t old_val = regs.get8(dest);
-        regs.get8(dest) -= static_cast<uint8_t>(src_value);
-        uint8_t new_val = regs.get8(dest);
-        update_flags_arithmetic(regs, new_val, old_val, static_cast<uint8_t>(src_value), true, true);
-        LOGGER.Debug("sub {}, {} -> {}[8] = {} (was {})", dest, src, dest,
-                    static_cast<int>(new_val), static_cast<int>(old_val));
-    } else if (regs.is16(dest)) {
-        uint16_t old_val = regs.get16(dest);
-        regs.get16(dest) -= static_cast<uint16_t>(src_value);
-        uint16_t new_val = regs.get16(dest);
-        update_flags_arithmetic(regs, new_val, old_val, static_cast<uint16_t>(src_value), false, true);
-        LOGGER.Debug("sub {}, {} -> {}[16] = {} (was {})", dest, src, dest, new_val, old_val);
-    } else {
-        throw std::runtime_error("Unknown destination register: " + dest);
-    }
+constexpr std::array<uint8_t, COMMAND_SLOT_COUNT> COMMAND_SLOTS = build_command_slots();
 
-    return "OK";
-}
+const CommandEntry* find_command(std::string_view mnemonic) {
+    uint32_t cmd_hash = hash_command(mnemonic);
+    for (size_t slot = cmd_hash & COMMAND_SLOT_MASK;; slot = (slot + 1) & COMMAND_SLOT_MASK) {
+        uint8_t index = COMMAND_SLOTS[slot];
+        if (index == EMPTY_COMMAND_SLOT) return nullptr;
 
-static bool is_8bit_comparison(const Registers& regs, const std::string& dest, int dest_value) {
-    return regs.is8(dest) || (dest_value >= -128 && dest_value <= 255);
+        const CommandEntry& entry = commands_table[index];
+        if (entry.hash == cmd_hash && entry.name == mnemonic) {
+            return &entry;
+        }
+    }
 }
 
-std::string cmd_cmp(Registers& regs, const std::vector<std::string>& args) {
-    if (args.size() != 2) {
-        throw std::runtime_error("cmp requires 2 arguments");
+SimStatus try_compile_command(Opcode opcode, const std::string_view* args, size_t arg_count, Instruction& instr,
+                              std::string_view& fault) noexcept {
+    fault = {};
+    if (is_jump(opcode)) return SimStatus::JumpNeedsProgram;
+    if (arg_count != 2) return SimStatus::WrongOperandCount;
+
+    std::string_view dest = clean_operand(args[0]);
+    std::string_view src = clean_operand(args[1]);
+
+    instr = Instruction{};
+    instr.opcode = opcode;
+    instr.ea = EffectiveAddress::None;
+    instr.segment = RegisterId::None;
+
+    bool memory_dest = is_memory_operand(dest);
+    bool memory_src = is_memory_operand(src);
+    if (memory_dest && memory_src) {
+        fault = src;
+        return SimStatus::TwoMemoryOperands;
     }
 
-    std::string dest = clean_operand(args[0]);
-    std::string src = clean_operand(args[1]);
-
-    int dest_value = parse_operand(regs, dest);
-    int src_value = parse_operand(regs, src);
-
-    bool is_8bit = is_8bit_comparison(regs, dest, dest_value);
+    bool sized = false;
+    OperandWidth memory_width = OperandWidth::Word;
+    SimStatus status;
+    if (memory_src) {
+        status = compile_memory(instr, src, memory_width, sized, fault);
+        instr.src_kind = OperandKind::Memory;
+        instr.src = RegisterId::None;
+    } else {
+        fault = src;
+        status = compile_source(instr, src);
+    }
+    if (status != SimStatus::Ok) return status;
 
-    uint16_t result;
-    if (is_8bit) {
-        result = static_cast<uint8_t>(dest_value) - static_cast<uint8_t>(src_value);
+    if (memory_dest) {
+        status = compile_memory(instr, dest, memory_width, sized, fault);
+        if (status != SimStatus::Ok) return status;
+        instr.dest_kind = OperandKind::Memory;
+        instr.dest = RegisterId::None;
     } else {
-        result = static_cast<uint16_t>(dest_value) - static_cast<uint16_t>(src_value);
+        instr.dest_kind = OperandKind::Register;
+        instr.dest = register_id_from_name(dest);
+        if (instr.dest == RegisterId::None || instr.dest == RegisterId::IP) {
+            fault = dest;
+            return dest.empty() ? SimStatus::EmptyOperand : SimStatus::UnknownDestination;
+        }
     }
 
-    LOGGER.Debug("cmp {}, {} -> {} - {} = {}", dest, src, dest_value, src_value, static_cast<int16_t>(result));
+    // Operand size comes from the register operand, as on the 8086; memory with an
+    // immediate needs an explicit "byte"/"word"
+    bool sized_by_source = memory_dest;
+    RegisterId sizing = sized_by_source ? instr.src : instr.dest;
+    if (sizing != RegisterId::None) {
+        instr.width = register_width(sizing);
+        if (sized && memory_width != instr.width) {
+            fault = sized_by_source ? src : dest;
+            return SimStatus::OperandSizeMismatch;
+        }
+    } else if (sized) {
+        instr.width = memory_width;
+    } else {
+        fault = dest;
+        return SimStatus::AmbiguousOperandSize;
+    }
 
-    update_flags_arithmetic(regs, result, static_cast<uint16_t>(dest_value), static_cast<uint16_t>(src_value), is_8bit, true);
+    // Two registers must be the same width; the 8086 has no "mov ax, bl" or "mov al, ds"
+    if (!memory_dest && instr.src_kind == OperandKind::Register && register_width(instr.src) != instr.width) {
+        fault = src;
+        return SimStatus::OperandSizeMismatch;
+    }
+    return SimStatus::Ok;
+}
 
-    return "OK";
+Instruction compile_command(Opcode opcode, const std::string_view* args, size_t arg_count) {
+    Instruction instr;
+    std::string_view fault;
+    SimStatus status = try_compile_command(opcode, args, arg_count, instr, fault);
+    if (status != SimStatus::Ok) {
+        throw std::runtime_error(status_message(status, opcode, fault));
+    }
+    return instr;
 }
@@ -0,0 +1,23 @@
+#include "constexpr_simulator.h"
+#include "golden_listings.h"
+
+// The golden listings are simulated while this file compiles; a flag or register
+// regression fails the build instead of a test run
+
+static_assert(listing_final_state_matches(LISTING_0046), "listing 0046 final state");
+static_assert(listing_final_state_matches(LISTING_0047), "listing 0047 final state");
+
+// Byte registers alias their word's halves, as in Registers
+static_assert(simulate_constexpr(std::array<Instruction, 3>{
+                  compile_constexpr("mov ax, 4660"),
+                  compile_constexpr("add ah, 1"),
+                  compile_constexpr("sub al, 53"),
+              }).read(RegisterId::AX) == 0x13FF,
+              "byte registers write into their word");
+
+// The adjust and overflow flags on both widths
+static_assert(simulate_listing("mov al, 127\nadd al, 1\n").flags == (FLAG_AF | FLAG_SF | FLAG_OF),
+              "0x7F + 1 overflows into the sign bit");
+static_assert(simulate_listing("mov cx, 0\nsub cx, 1\n").flags == (FLAG_CF | FLAG_PF | FLAG_AF | FLAG_SF),
+              "0 - 1 borrows");
+static_assert(simulate_listing("mov dx, 5\ncmp dx, 5\n").read(RegisterId::DX) == 5, "cmp discards its result");
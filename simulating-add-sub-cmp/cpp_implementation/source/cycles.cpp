@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <sstream>
+#include "cycles.h"
+
+namespace {
+
+constexpr uint32_t BUS_CYCLE = 4;           // Clocks per bus transfer
+constexpr uint32_t PREFETCH_QUEUE_BYTES = 4;
+constexpr uint32_t SEGMENT_OVERRIDE_CYCLES = 2;
+
+// Base clocks by operand form; memory forms add the effective-address time
+struct FormCycles {
+    uint32_t reg_reg;
+    uint32_t reg_imm;
+    uint32_t reg_mem;
+    uint32_t mem_reg;
+    uint32_t mem_imm;
+};
+
+constexpr FormCycles MOV_CYCLES{2, 4, 8, 9, 10};
+constexpr FormCycles ADD_SUB_CYCLES{3, 4, 9, 16, 17};
+constexpr FormCycles CMP_CYCLES{3, 4, 9, 9, 10};
+
+// mov between the accumulator and a direct address has its own encoding (A0-A3)
+// that needs no effective-address calculation
+constexpr uint32_t MOV_ACCUMULATOR_DIRECT_CYCLES = 10;
+
+struct JumpCycles {
+    uint32_t taken;
+    uint32_t not_taken;
+};
+
+JumpCycles jump_cycles(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Loop: return {17, 5};
+        case Opcode::Loopz: return {18, 6};
+        case Opcode::Loopnz: return {19, 5};
+        case Opcode::Jcxz: return {18, 6};
+        default: return {16, 4};
+    }
+}
+
+bool is_accumulator(RegisterId id) {
+    return id == RegisterId::AX || id == RegisterId::AL;
+}
+
+// Base clocks and memory transfers (each a byte or a word) of a mov/add/sub/cmp
+uint32_t base_cycles(const Instruction& instr, uint32_t& transfers) {
+    const FormCycles& form = instr.opcode == Opcode::Mov   ? MOV_CYCLES
+                             : instr.opcode == Opcode::Cmp ? CMP_CYCLES
+                                                           : ADD_SUB_CYCLES;
+    transfers = 0;
+
+    if (instr.dest_kind == OperandKind::Memory) {
+        // Read-modify-write for add/sub, one write for mov, one read for cmp
+        transfers = instr.opcode == Opcode::Add || instr.opcode == Opcode::Sub ? 2 : 1;
+        return instr.src_kind == OperandKind::Immediate ? form.mem_imm : form.mem_reg;
+    }
+    if (instr.src_kind == OperandKind::Memory) {
+        transfers = 1;
+        return form.reg_mem;
+    }
+    return instr.src_kind == OperandKind::Immediate ? form.reg_imm : form.reg_reg;
+}
+
+}  // namespace
+
+uint32_t effective_address_cycles(const Instruction& instr) {
+    bool has_displacement = instr.displacement != 0;
+    uint32_t cycles = 0;
+    switch (instr.ea) {
+        case EffectiveAddress::Direct: cycles = 6; break;
+        case EffectiveAddress::Si:
+        case EffectiveAddress::Di:
+        case EffectiveAddress::Bx: cycles = has_displacement ? 9 : 5; break;
+        case EffectiveAddress::Bp: cycles = 9; break;   // [bp] is always encoded with a displacement
+        case EffectiveAddress::BpDi:
+        case EffectiveAddress::BxSi: cycles = has_displacement ? 11 : 7; break;
+        case EffectiveAddress::BpSi:
+        case EffectiveAddress::BxDi: cycles = has_displacement ? 12 : 8; break;
+        case EffectiveAddress::None: return 0;
+    }
+    if (instr.segment != RegisterId::None) {
+        cycles += SEGMENT_OVERRIDE_CYCLES;
+    }
+    return cycles;
+}
+
+CycleCost CycleCounter::charge(const Instruction& instr, uint32_t address, bool taken) {
+    CycleCost cost;
+    if (m_model == CycleModel::Off || instr.opcode == Opcode::Invalid) return cost;
+
+    uint32_t transfers = 0;
+    if (is_jump(instr.opcode)) {
+        JumpCycles jump = jump_cycles(instr.opcode);
+        cost.base = taken ? jump.taken : jump.not_taken;
+    } else if (instr.opcode == Opcode::Mov && instr.ea == EffectiveAddress::Direct && instr.segment == RegisterId::None &&
+               (is_accumulator(instr.dest) || is_accumulator(instr.src))) {
+        cost.base = MOV_ACCUMULATOR_DIRECT_CYCLES;
+        transfers = 1;
+    } else {
+        cost.base = base_cycles(instr, transfers);
+        if (transfers > 0) cost.ea = effective_address_cycles(instr);
+    }
+
+    bool word = instr.width == OperandWidth::Word;
+    if (word && transfers > 0) {
+        // The 8088 moves every word as two bytes; the 8086 only splits odd-addressed words
+        if (m_model == CycleModel::I8088 || (address & 1) != 0) {
+            cost.penalty = transfers * BUS_CYCLE;
+        }
+    }
+
+    if (m_model == CycleModel::I8088 && instr.size > 0) {
+        // The instruction's bytes come out of the queue; missing ones are fetched now
+        if (m_queue_bytes < instr.size) {
+            cost.fetch = (instr.size - m_queue_bytes) * BUS_CYCLE;
+            m_queue_bytes = 0;
+        } else {
+            m_queue_bytes -= instr.size;
+        }
+
+        // While executing, the bus prefetches whenever no operand transfer needs it
+        uint32_t bus_busy = transfers * (word ? 2 : 1) * BUS_CYCLE;
+        uint32_t execute = cost.base + cost.ea + cost.penalty;
+        uint32_t idle = execute > bus_busy ? execute - bus_busy : 0;
+        m_queue_bytes = std::min(PREFETCH_QUEUE_BYTES, m_queue_bytes + idle / BUS_CYCLE);
+
+        if (is_jump(instr.opcode) && taken) {
+            m_queue_bytes = 0;   // A taken jump flushes the queue
+        }
+    }
+
+    m_total += cost.total();
+    return cost;
+}
+
+std::string format_cycles(const CycleCost& cost, uint64_t total) {
+    std::ostringstream out;
+    out << "Clocks: +" << cost.total() << " = " << total;
+    if (cost.ea || cost.penalty || cost.fetch) {
+        out << " (" << cost.base;
+        if (cost.ea) out << " + " << cost.ea << "ea";
+        if (cost.penalty) out << " + " << cost.penalty << "p";
+        if (cost.fetch) out << " + " << cost.fetch << "f";
+        out << ")";
+    }
+    return out.str();
+}
+
+bool parse_cycle_model(const std::string& name, CycleModel& model) {
+    if (name == "off") {
+        model = CycleModel::Off;
+    } else if (name == "8086") {
+        model = CycleModel::I8086;
+    } else if (name == "8088") {
+        model = CycleModel::I8088;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,203 @@
+#include <stdexcept>
+#include "daemon_protocol.h"
+
+namespace {
+
+// Appends little-endian fields behind a placeholder frame header
+class MessageWriter {
+public:
+    MessageWriter() : m_bytes(DAEMON_FRAME_HEADER_SIZE, '\0') { u32(DAEMON_PROTOCOL_VERSION); }
+
+    void u8(uint8_t value) { m_bytes.push_back(static_cast<char>(value)); }
+
+    void u16(uint16_t value) {
+        u8(static_cast<uint8_t>(value));
+        u8(static_cast<uint8_t>(value >> 8));
+    }
+
+    void u32(uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) u8(static_cast<uint8_t>(value >> shift));
+    }
+
+    void u64(uint64_t value) {
+        for (int shift = 0; shift < 64; shift += 8) u8(static_cast<uint8_t>(value >> shift));
+    }
+
+    void text(std::string_view value) {
+        if (value.size() > MAX_DAEMON_FRAME_SIZE) throw std::runtime_error("Daemon message too large");
+        u32(static_cast<uint32_t>(value.size()));
+        m_bytes.append(value.data(), value.size());
+    }
+
+    // The frame, with its header filled in
+    std::string finish() {
+        size_t body_size = m_bytes.size() - DAEMON_FRAME_HEADER_SIZE;
+        if (body_size > MAX_DAEMON_FRAME_SIZE) throw std::runtime_error("Daemon message too large");
+        for (size_t i = 0; i < DAEMON_FRAME_HEADER_SIZE; ++i) {
+            m_bytes[i] = static_cast<char>(body_size >> (8 * i));
+        }
+        return std::move(m_bytes);
+    }
+
+private:
+    std::string m_bytes;
+};
+
+// Reads the fields MessageWriter wrote, checking every size against the body
+class MessageReader {
+public:
+    explicit MessageReader(std::string_view body) : m_body(body) {
+        if (u32() != DAEMON_PROTOCOL_VERSION) {
+            throw std::runtime_error("Daemon protocol version differs; rebuild the client and daemon together");
+        }
+    }
+
+    uint8_t u8() { return static_cast<uint8_t>(take(1)[0]); }
+
+    uint16_t u16() {
+        std::string_view bytes = take(2);
+        return static_cast<uint16_t>(static_cast<uint8_t>(bytes[0]) | static_cast<uint8_t>(bytes[1]) << 8);
+    }
+
+    uint32_t u32() {
+        std::string_view bytes = take(4);
+        uint32_t value = 0;
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t u64() {
+        std::string_view bytes = take(8);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    bool flag() { return u8() != 0; }
+
+    std::string text() {
+        uint32_t size = u32();
+        return std::string(take(size));
+    }
+
+    // Enum stored as a byte, rejecting values past `last`
+    template <typename Enum>
+    Enum choice(Enum last) {
+        uint8_t value = u8();
+        if (value > static_cast<uint8_t>(last)) throw std::runtime_error("Malformed daemon message");
+        return static_cast<Enum>(value);
+    }
+
+    void finish() const {
+        if (m_pos != m_body.size()) throw std::runtime_error("Malformed daemon message");
+    }
+
+private:
+    std::string_view take(size_t size) {
+        if (size > m_body.size() - m_pos) throw std::runtime_error("Malformed daemon message");
+        std::string_view bytes = m_body.substr(m_pos, size);
+        m_pos += size;
+        return bytes;
+    }
+
+    std::string_view m_body;
+    size_t m_pos = 0;
+};
+
+}  // namespace
+
+std::string encode_request(const DaemonRequest& request) {
+    MessageWriter out;
+    out.u8(static_cast<uint8_t>(request.source));
+    out.u8(request.lazy_flags ? 1 : 0);
+    out.u8(static_cast<uint8_t>(request.alu_kernel));
+    out.u8(static_cast<uint8_t>(request.cycle_model));
+    out.u8(request.capture_debug ? 1 : 0);
+    out.u64(request.max_steps);
+    out.text(request.program);
+    return out.finish();
+}
+
+DaemonRequest decode_request(std::string_view body) {
+    MessageReader in(body);
+    DaemonRequest request;
+    request.source = in.choice(DaemonSource::Text);
+    request.lazy_flags = in.flag();
+    request.alu_kernel = in.choice(AluKernel::Table);
+    request.cycle_model = in.choice(CycleModel::I8088);
+    request.capture_debug = in.flag();
+    request.max_steps = in.u64();
+    request.program = in.text();
+    in.finish();
+    return request;
+}
+
+std::string encode_response(const DaemonResponse& response) {
+    const SimulationResult& result = response.result;
+    MessageWriter out;
+    out.u8(response.ran ? 1 : 0);
+    out.text(response.error);
+    out.u64(result.instructions);
+    out.u64(result.errors);
+    out.u64(result.mismatches);
+    out.u8(result.final_checked ? 1 : 0);
+    out.u8(result.final_match ? 1 : 0);
+    out.u64(result.cycles);
+    out.u8(static_cast<uint8_t>(result.first_error.status));
+    out.u8(static_cast<uint8_t>(result.first_error.opcode));
+    out.u16(result.first_error.column);
+    out.u16(result.first_error.length);
+    out.u32(static_cast<uint32_t>(result.first_error.line));
+    out.text(response.final_registers);
+    out.u32(static_cast<uint32_t>(response.output.size()));
+    for (const DaemonOutputLine& line : response.output) {
+        out.u8(static_cast<uint8_t>(line.level));
+        out.text(line.text);
+    }
+    return out.finish();
+}
+
+DaemonResponse decode_response(std::string_view body) {
+    MessageReader in(body);
+    DaemonResponse response;
+    SimulationResult& result = response.result;
+    response.ran = in.flag();
+    response.error = in.text();
+    result.instructions = in.u64();
+    result.errors = in.u64();
+    result.mismatches = in.u64();
+    result.final_checked = in.flag();
+    result.final_match = in.flag();
+    result.cycles = in.u64();
+    result.first_error.status = in.choice(SimStatus::DecodeError);
+    result.first_error.opcode = in.choice(Opcode::Invalid);
+    result.first_error.column = in.u16();
+    result.first_error.length = in.u16();
+    result.first_error.line = static_cast<int32_t>(in.u32());
+    response.final_registers = in.text();
+
+    // Each line takes at least five bytes, so a bogus count fails before it allocates
+    uint32_t count = in.u32();
+    if (count > body.size() / 5) throw std::runtime_error("Malformed daemon message");
+    response.output.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        DaemonOutputLine line;
+        line.level = in.choice(OutputLevel::Error);
+        line.text = in.text();
+        response.output.push_back(std::move(line));
+    }
+    in.finish();
+    return response;
+}
+
+uint32_t frame_body_size(const char* header) {
+    uint32_t size = 0;
+    for (size_t i = 0; i < DAEMON_FRAME_HEADER_SIZE; ++i) {
+        size |= static_cast<uint32_t>(static_cast<uint8_t>(header[i])) << (8 * i);
+    }
+    return size;
+}
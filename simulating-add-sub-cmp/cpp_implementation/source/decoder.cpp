@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include "decoder.h"
+
+namespace {
+
+struct ByteReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+
+    uint8_t next8() {
+        if (pos >= size) throw std::runtime_error("Truncated instruction");
+        return data[pos++];
+    }
+
+    uint16_t next16() {
+        uint8_t low = next8();
+        uint8_t high = next8();
+        return static_cast<uint16_t>(low | (high << 8));
+    }
+
+    uint16_t next8_sign_extended() {
+        return static_cast<uint16_t>(static_cast<int16_t>(static_cast<int8_t>(next8())));
+    }
+};
+
+using DecodeHandler = void (*)(ByteReader& in, uint8_t op, Instruction& instr);
+
+constexpr RegisterId WORD_REGISTERS[8] = {
+    RegisterId::AX, RegisterId::CX, RegisterId::DX, RegisterId::BX,
+    RegisterId::SP, RegisterId::BP, RegisterId::SI, RegisterId::DI,
+};
+
+constexpr RegisterId BYTE_REGISTERS[8] = {
+    RegisterId::AL, RegisterId::CL, RegisterId::DL, RegisterId::BL,
+    RegisterId::AH, RegisterId::CH, RegisterId::DH, RegisterId::BH,
+};
+
+constexpr RegisterId SEGMENT_REGISTERS[4] = {
+    RegisterId::ES, RegisterId::CS, RegisterId::SS, RegisterId::DS,
+};
+
+constexpr uint8_t MOD_REGISTER = 0b11;
+constexpr uint8_t RM_DIRECT_ADDRESS = 0b110;
+
+RegisterId general_register(uint8_t index, bool wide) {
+    return wide ? WORD_REGISTERS[index & 7] : BYTE_REGISTERS[index & 7];
+}
+
+OperandWidth width_of(bool wide) {
+    return wide ? OperandWidth::Word : OperandWidth::Byte;
+}
+
+// Arithmetic family selected by bits 3-5 of the opcode or the reg field of group 0x80
+Opcode arithmetic_opcode(uint8_t field) {
+    switch (field & 7) {
+        case 0b000: return Opcode::Add;
+        case 0b101: return Opcode::Sub;
+        case 0b111: return Opcode::Cmp;
+        default: break;
+    }
+    throw std::runtime_error("Unsupported arithmetic operation " + std::to_string(field & 7));
+}
+
+// Decodes the r/m half of a mod/rm byte into an operand
+void decode_rm(ByteReader& in, uint8_t modrm, bool wide, Instruction& instr, OperandKind& kind, RegisterId& reg) {
+    uint8_t mod = modrm >> 6;
+    uint8_t rm = modrm & 7;
+
+    if (mod == MOD_REGISTER) {
+        kind = OperandKind::Register;
+        reg = general_register(rm, wide);
+        return;
+    }
+
+    kind = OperandKind::Memory;
+    reg = RegisterId::None;
+    if (mod == 0b00 && rm == RM_DIRECT_ADDRESS) {
+        instr.ea = EffectiveAddress::Direct;
+        instr.displacement = in.next16();
+        return;
+    }
+
+    instr.ea = static_cast<EffectiveAddress>(rm);
+    if (mod == 0b01) {
+        instr.displacement = in.next8_sign_extended();
+    } else if (mod == 0b10) {
+        instr.displacement = in.next16();
+    }
+}
+
+// mod/rm form where the d bit selects which side the reg field is on
+void decode_rm_reg(ByteReader& in, Instruction& instr, bool reg_is_dest, bool wide) {
+    uint8_t modrm = in.next8();
+    instr.width = width_of(wide);
+
+    RegisterId reg = general_register(modrm >> 3, wide);
+    if (reg_is_dest) {
+        instr.dest_kind = OperandKind::Register;
+        instr.dest = reg;
+        decode_rm(in, modrm, wide, instr, instr.src_kind, instr.src);
+    } else {
+        instr.src_kind = OperandKind::Register;
+        instr.src = reg;
+        decode_rm(in, modrm, wide, instr, instr.dest_kind, instr.dest);
+    }
+}
+
+void set_immediate_source(Instruction& instr, uint16_t value) {
+    instr.src_kind = OperandKind::Immediate;
+    instr.immediate = value;
+}
+
+// 0x00-0x03, 0x28-0x2B, 0x38-0x3B: add/sub/cmp r/m, reg
+void decode_arithmetic_rm_reg(ByteReader& in, uint8_t op, Instruction& instr) {
+    instr.opcode = arithmetic_opcode(op >> 3);
+    decode_rm_reg(in, instr, (op & 0b10) != 0, (op & 1) != 0);
+}
+
+// 0x04/0x05, 0x2C/0x2D, 0x3C/0x3D: add/sub/cmp accumulator, immediate
+void decode_arithmetic_accumulator(ByteReader& in, uint8_t op, Instruction& instr) {
+    bool wide = (op & 1) != 0;
+    instr.opcode = arithmetic_opcode(op >> 3);
+    instr.width = width_of(wide);
+    instr.dest_kind = OperandKind::Register;
+    instr.dest = wide ? RegisterId::AX : RegisterId::AL;
+    set_immediate_source(instr, wide ? in.next16() : in.next8());
+}
+
+// 0x80-0x83: add/sub/cmp r/m, immediate (s bit sign-extends an 8-bit immediate)
+void decode_arithmetic_immediate(ByteReader& in, uint8_t op, Instruction& instr) {
+    bool wide = (op & 1) != 0;
+    bool sign_extend = (op & 0b10) != 0;
+    uint8_t modrm = in.next8();
+
+    instr.opcode = arithmetic_opcode(modrm >> 3);
+    instr.width = width_of(wide);
+    decode_rm(in, modrm, wide, instr, instr.dest_kind, instr.dest);
+    set_immediate_source(instr, (wide && !sign_extend) ? in.next16() : in.next8_sign_extended());
+}
+
+// 0x88-0x8B: mov r/m, reg
+void decode_mov_rm_reg(ByteReader& in, uint8_t op, Instruction& instr) {
+    instr.opcode = Opcode::Mov;
+    decode_rm_reg(in, instr, (op & 0b10) != 0, (op & 1) != 0);
+}
+
+// 0x8C / 0x8E: mov r/m16, sreg and mov sreg, r/m16
+void decode_mov_segment(ByteReader& in, uint8_t op, Instruction& instr) {
+    uint8_t modrm = in.next8();
+    RegisterId segment = SEGMENT_REGISTERS[(modrm >> 3) & 0b11];
+
+    instr.opcode = Opcode::Mov;
+    instr.width = OperandWidth::Word;
+    if (op == 0x8E) {
+        instr.dest_kind = OperandKind::Register;
+        instr.dest = segment;
+        decode_rm(in, modrm, true, instr, instr.src_kind, instr.src);
+    } else {
+        instr.src_kind = OperandKind::Register;
+        instr.src = segment;
+        decode_rm(in, modrm, true, instr, instr.dest_kind, instr.dest);
+    }
+}
+
+// 0xA0-0xA3: mov accumulator to/from direct address
+void decode_mov_accumulator_memory(ByteReader& in, uint8_t op, Instruction& instr) {
+    bool wide = (op & 1) != 0;
+    RegisterId accumulator = wide ? RegisterId::AX : RegisterId::AL;
+
+    instr.opcode = Opcode::Mov;
+    instr.width = width_of(wide);
+    instr.ea = EffectiveAddress::Direct;
+    instr.displacement = in.next16();
+    if ((op & 0b10) == 0) {
+        instr.dest_kind = OperandKind::Register;
+        instr.dest = accumulator;
+        instr.src_kind = OperandKind::Memory;
+    } else {
+        instr.dest_kind = OperandKind::Memory;
+        instr.src_kind = OperandKind::Register;
+        instr.src = accumulator;
+    }
+}
+
+// 0xB0-0xBF: mov reg, immediate
+void decode_mov_register_immediate(ByteReader& in, uint8_t op, Instruction& instr) {
+    bool wide = (op & 0b1000) != 0;
+    instr.opcode = Opcode::Mov;
+    instr.width = width_of(wide);
+    instr.dest_kind = OperandKind::Register;
+    instr.dest = general_register(op, wide);
+    set_immediate_source(instr, wide ? in.next16() : in.next8());
+}
+
+// 0xC6/0xC7: mov r/m, immediate
+void decode_mov_rm_immediate(ByteReader& in, uint8_t op, Instruction& instr) {
+    bool wide = (op & 1) != 0;
+    uint8_t modrm = in.next8();
+    if (((modrm >> 3) & 7) != 0) {
+        throw std::runtime_error("Invalid mov immediate encoding");
+    }
+
+    instr.opcode = Opcode::Mov;
+    instr.width = width_of(wide);
+    decode_rm(in, modrm, wide, instr, instr.dest_kind, instr.dest);
+    set_immediate_source(instr, wide ? in.next16() : in.next8());
+}
+
+// 0x70-0x7F and 0xE0-0xE3: short jumps with a signed 8-bit offset
+void decode_short_jump(ByteReader& in, uint8_t op, Instruction& instr) {
+    if (op >= 0xE0) {
+        instr.opcode = static_cast<Opcode>(static_cast<uint8_t>(Opcode::Loopnz) + (op - 0xE0));
+    } else {
+        instr.opcode = static_cast<Opcode>(static_cast<uint8_t>(Opcode::Jo) + (op - 0x70));
+    }
+    instr.width = OperandWidth::Byte;
+    instr.displacement = in.next8_sign_extended();
+}
+
+constexpr std::array<DecodeHandler, 256> make_decode_table() {
+    std::array<DecodeHandler, 256> table{};
+
+    for (uint8_t base : {0x00, 0x28, 0x38}) {
+        for (uint8_t i = 0; i < 4; ++i) {
+            table[base + i] = decode_arithmetic_rm_reg;
+        }
+        table[base + 4] = decode_arithmetic_accumulator;
+        table[base + 5] = decode_arithmetic_accumulator;
+    }
+
+    for (uint8_t op = 0x70; op <= 0x7F; ++op) table[op] = decode_short_jump;
+    for (uint8_t op = 0x80; op <= 0x83; ++op) table[op] = decode_arithmetic_immediate;
+    for (uint8_t op = 0x88; op <= 0x8B; ++op) table[op] = decode_mov_rm_reg;
+    table[0x8C] = decode_mov_segment;
+    table[0x8E] = decode_mov_segment;
+    for (uint8_t op = 0xA0; op <= 0xA3; ++op) table[op] = decode_mov_accumulator_memory;
+    for (uint8_t op = 0xB0; op <= 0xBF; ++op) table[op] = decode_mov_register_immediate;
+    table[0xC6] = decode_mov_rm_immediate;
+    table[0xC7] = decode_mov_rm_immediate;
+    for (uint8_t op = 0xE0; op <= 0xE3; ++op) table[op] = decode_short_jump;
+
+    return table;
+}
+
+constexpr std::array<DecodeHandler, 256> DECODE_TABLE = make_decode_table();
+
+// Segment override prefixes: es: cs: ss: ds:
+RegisterId segment_prefix(uint8_t byte) {
+    switch (byte) {
+        case 0x26: return RegisterId::ES;
+        case 0x2E: return RegisterId::CS;
+        case 0x36: return RegisterId::SS;
+        case 0x3E: return RegisterId::DS;
+        default: return RegisterId::None;
+    }
+}
+
+std::string hex_byte(uint8_t value) {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    return std::string("0x") + DIGITS[value >> 4] + DIGITS[value & 0xF];
+}
+
+}  // namespace
+
+void decode_instruction(const uint8_t* data, size_t size, size_t offset, Instruction& out) {
+    ByteReader in{data, size, offset};
+
+    out = Instruction{};
+    out.dest_kind = OperandKind::None;
+    out.src_kind = OperandKind::None;
+    out.dest = RegisterId::None;
+    out.src = RegisterId::None;
+    out.ea = EffectiveAddress::None;
+    out.segment = RegisterId::None;
+
+    uint8_t op = in.next8();
+    RegisterId segment = segment_prefix(op);
+    if (segment != RegisterId::None) {
+        out.segment = segment;
+        op = in.next8();
+    }
+
+    DecodeHandler handler = DECODE_TABLE[op];
+    if (!handler) {
+        throw std::runtime_error("Unsupported opcode " + hex_byte(op));
+    }
+    handler(in, op, out);
+
+    out.size = static_cast<uint8_t>(in.pos - offset);
+}
+
+// Jump offsets are relative to the next instruction; targets are looked up by the
+// byte offset each line records as its line number
+static void resolve_jump_targets(Program& program, size_t end_offset) {
+    auto count = static_cast<uint32_t>(program.instructions.size());
+    for (uint32_t i = 0; i < count; ++i) {
+        const Instruction& instr = program.instructions[i];
+        if (!is_jump(instr.opcode)) continue;
+
+        auto next = static_cast<uint16_t>(program.lines[i].line_number + instr.size);
+        auto target = static_cast<uint16_t>(next + instr.displacement);
+        if (target == end_offset) {
+            program.lines[i].jump_target = count;
+            continue;
+        }
+
+        auto found = std::lower_bound(program.lines.begin(), program.lines.end(), target,
+                                      [](const ProgramLine& line, int offset) { return line.line_number < offset; });
+        if (found != program.lines.end() && found->line_number == target) {
+            program.lines[i].jump_target = static_cast<uint32_t>(found - program.lines.begin());
+        }
+    }
+}
+
+Program decode_program(const uint8_t* data, size_t size) {
+    Program program;
+    size_t offset = 0;
+
+    while (offset < size) {
+        Instruction instr;
+        ProgramLine info;
+        info.line_number = static_cast<int>(offset);
+        info.has_expected = false;
+
+        try {
+            decode_instruction(data, size, offset, instr);
+            info.display = program.keep(format_instruction(instr));
+        } catch (const std::exception& e) {
+            instr = Instruction{};
+            instr.opcode = Opcode::Invalid;
+            info.error = std::string(e.what()) + " at offset " + std::to_string(offset);
+            info.status.status = SimStatus::DecodeError;
+            info.status.line = static_cast<int32_t>(offset);
+            program.instructions.push_back(instr);
+            program.lines.push_back(std::move(info));
+            break;
+        }
+
+        offset += instr.size;
+        program.instructions.push_back(instr);
+        program.lines.push_back(std::move(info));
+    }
+
+    resolve_jump_targets(program, offset);
+    program.threaded = thread_instructions(program.instructions);
+    return program;
+}
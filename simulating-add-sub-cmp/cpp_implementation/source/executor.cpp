@@ -0,0 +1,157 @@
+#include <stdexcept>
+#include "effective_address.h"
+#include "executor.h"
+
+// Memory operands need the simulator's memory; register-only callers pass nullptr
+static Memory& require_memory(Memory* memory) {
+    if (!memory) {
+        throw std::runtime_error("Memory operands need simulator memory");
+    }
+    return *memory;
+}
+
+static uint16_t read_memory(const Registers& regs, Memory* memory, const Instruction& instr) {
+    uint32_t address = effective_address(regs, instr);
+    const Memory& mem = require_memory(memory);
+    return instr.width == OperandWidth::Byte ? mem.read8(address) : mem.read16(address);
+}
+
+static uint16_t read_source(const Registers& regs, Memory* memory, const Instruction& instr) {
+    switch (instr.src_kind) {
+        case OperandKind::Immediate: return instr.immediate;
+        case OperandKind::Register: return regs.read(instr.src);
+        case OperandKind::Memory: return read_memory(regs, memory, instr);
+        case OperandKind::None: break;
+    }
+    throw std::runtime_error("Missing source operand");
+}
+
+static uint16_t read_dest(const Registers& regs, Memory* memory, const Instruction& instr) {
+    return instr.dest_kind == OperandKind::Memory ? read_memory(regs, memory, instr) : regs.read(instr.dest);
+}
+
+template <typename Policy>
+static void write_dest(Registers& regs, Memory* memory, const Instruction& instr, uint16_t value) {
+    if (instr.dest_kind == OperandKind::Memory) {
+        uint32_t address = effective_address(regs, instr);
+        if (instr.width == OperandWidth::Byte) {
+            require_memory(memory).write8(address, static_cast<uint8_t>(value));
+        } else {
+            require_memory(memory).write16(address, value);
+        }
+        return;
+    }
+    if (instr.width == OperandWidth::Byte) {
+        regs.get8<Policy>(instr.dest) = static_cast<uint8_t>(value);  // Proxy tracks change per policy
+    } else {
+        regs.get16<Policy>(instr.dest) = value;
+    }
+}
+
+template <typename Policy>
+static void execute_arithmetic(Registers& regs, Memory* memory, const Instruction& instr, FlagsOp op,
+                               bool store_result) {
+    bool is_8bit = instr.width == OperandWidth::Byte;
+    uint16_t mask = is_8bit ? 0xFF : 0xFFFF;
+
+    uint16_t old_val = static_cast<uint16_t>(read_dest(regs, memory, instr) & mask);
+    uint16_t operand = static_cast<uint16_t>(read_source(regs, memory, instr) & mask);
+
+    uint16_t result = execute_alu(regs, op, old_val, operand, is_8bit);
+
+    if (store_result) {
+        write_dest<Policy>(regs, memory, instr, result);
+    }
+}
+
+template <typename Policy>
+static void execute(Registers& regs, Memory* memory, const Instruction& instr) {
+    switch (instr.opcode) {
+        case Opcode::Mov:
+            write_dest<Policy>(regs, memory, instr, read_source(regs, memory, instr));
+            return;
+        case Opcode::Add:
+            execute_arithmetic<Policy>(regs, memory, instr, FlagsOp::Add, true);
+            return;
+        case Opcode::Sub:
+            execute_arithmetic<Policy>(regs, memory, instr, FlagsOp::Sub, true);
+            return;
+        case Opcode::Cmp:
+            execute_arithmetic<Policy>(regs, memory, instr, FlagsOp::Sub, false);
+            return;
+        case Opcode::Invalid:
+            break;
+        default:
+            throw std::runtime_error(std::string(opcode_name(instr.opcode)) + " must go through execute_branch");
+    }
+    throw std::runtime_error("Cannot execute invalid instruction");
+}
+
+template <typename Policy>
+void execute_instruction(Registers& regs, const Instruction& instr) {
+    execute<Policy>(regs, nullptr, instr);
+}
+
+template <typename Policy>
+void execute_instruction(Registers& regs, Memory& memory, const Instruction& instr) {
+    execute<Policy>(regs, &memory, instr);
+}
+
+template <typename Policy>
+bool execute_branch(Registers& regs, const Instruction& instr) {
+    if (regs.lazy_flags_enabled()) {
+        regs.materialize_flags();
+    }
+    uint16_t flags = regs.flags.value;
+    bool cf = (flags & FLAG_CF) != 0;
+    bool zf = (flags & FLAG_ZF) != 0;
+    bool sf = (flags & FLAG_SF) != 0;
+    bool of = (flags & FLAG_OF) != 0;
+    bool pf = (flags & FLAG_PF) != 0;
+
+    switch (instr.opcode) {
+        case Opcode::Jo: return of;
+        case Opcode::Jno: return !of;
+        case Opcode::Jb: return cf;
+        case Opcode::Jnb: return !cf;
+        case Opcode::Je: return zf;
+        case Opcode::Jne: return !zf;
+        case Opcode::Jbe: return cf || zf;
+        case Opcode::Ja: return !cf && !zf;
+        case Opcode::Js: return sf;
+        case Opcode::Jns: return !sf;
+        case Opcode::Jp: return pf;
+        case Opcode::Jnp: return !pf;
+        case Opcode::Jl: return sf != of;
+        case Opcode::Jnl: return sf == of;
+        case Opcode::Jle: return zf || sf != of;
+        case Opcode::Jg: return !zf && sf == of;
+        case Opcode::Jcxz: return regs.cx.value == 0;
+        case Opcode::Loopnz:
+        case Opcode::Loopz:
+        case Opcode::Loop: {
+            // Decrementing CX leaves the flags alone
+            auto cx = regs.get16<Policy>(RegisterId::CX);
+            cx -= 1;
+            if (cx == 0) return false;
+            if (instr.opcode == Opcode::Loopz) return zf;
+            if (instr.opcode == Opcode::Loopnz) return !zf;
+            return true;
+        }
+        default:
+            break;
+    }
+    throw std::runtime_error(std::string(opcode_name(instr.opcode)) + " is not a jump");
+}
+
+template void execute_instruction<TracePolicy>(Registers& regs, const Instruction& instr);
+template void execute_instruction<ValidatePolicy>(Registers& regs, const Instruction& instr);
+template void execute_instruction<BenchPolicy>(Registers& regs, const Instruction& instr);
+
+template void execute_instruction<TracePolicy>(Registers& regs, Memory& memory, const Instruction& instr);
+template void execute_instruction<ValidatePolicy>(Registers& regs, Memory& memory, const Instruction& instr);
+template void execute_instruction<BenchPolicy>(Registers& regs, Memory& memory, const Instruction& instr);
+
+template bool execute_branch<TracePolicy>(Registers& regs, const Instruction& instr);
+template bool execute_branch<ValidatePolicy>(Registers& regs, const Instruction& instr);
+template bool execute_branch<BenchPolicy>(Registers& regs, const Instruction& instr);
@@ -0,0 +1,80 @@
+#include <sstream>
+#include "instruction.h"
+
+static constexpr const char* OPCODE_NAMES[OPCODE_COUNT] = {
+    "mov", "add", "sub", "cmp",
+    "jo", "jno", "jb", "jnb", "je", "jne", "jbe", "ja",
+    "js", "jns", "jp", "jnp", "jl", "jnl", "jle", "jg",
+    "loopnz", "loopz", "loop", "jcxz",
+    "invalid",
+};
+
+static constexpr const char* EFFECTIVE_ADDRESS_NAMES[] = {
+    "bx + si", "bx + di", "bp + si", "bp + di", "si", "di", "bp", "bx",
+};
+
+const char* opcode_name(Opcode opcode) {
+    return OPCODE_NAMES[static_cast<size_t>(opcode)];
+}
+
+static void format_memory(std::ostringstream& out, const Instruction& instr) {
+    if (instr.segment != RegisterId::None) {
+        out << register_name(instr.segment) << ":";
+    }
+
+    if (instr.ea == EffectiveAddress::Direct) {
+        out << "[" << instr.displacement << "]";
+        return;
+    }
+
+    out << "[" << EFFECTIVE_ADDRESS_NAMES[static_cast<size_t>(instr.ea)];
+    int16_t disp = static_cast<int16_t>(instr.displacement);
+    if (disp > 0) {
+        out << " + " << disp;
+    } else if (disp < 0) {
+        out << " - " << -static_cast<int>(disp);
+    }
+    out << "]";
+}
+
+static void format_operand(std::ostringstream& out, const Instruction& instr, OperandKind kind, RegisterId reg) {
+    switch (kind) {
+        case OperandKind::Register:
+            out << register_name(reg);
+            break;
+        case OperandKind::Immediate:
+            out << instr.immediate;
+            break;
+        case OperandKind::Memory:
+            format_memory(out, instr);
+            break;
+        case OperandKind::None:
+            break;
+    }
+}
+
+std::string format_instruction(const Instruction& instr) {
+    std::ostringstream out;
+    out << opcode_name(instr.opcode);
+
+    if (is_jump(instr.opcode)) {
+        // NASM-style offset relative to the start of the instruction
+        int offset = static_cast<int16_t>(instr.displacement) + instr.size;
+        out << " $" << (offset >= 0 ? "+" : "") << offset;
+        return out.str();
+    }
+
+    if (instr.dest_kind == OperandKind::None) {
+        return out.str();
+    }
+
+    out << " ";
+    // Memory with an immediate source has no register to imply the width
+    if (instr.dest_kind == OperandKind::Memory && instr.src_kind == OperandKind::Immediate) {
+        out << (instr.width == OperandWidth::Byte ? "byte " : "word ");
+    }
+    format_operand(out, instr, instr.dest_kind, instr.dest);
+    out << ", ";
+    format_operand(out, instr, instr.src_kind, instr.src);
+    return out.str();
+}
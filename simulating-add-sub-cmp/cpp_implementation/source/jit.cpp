@@ -0,0 +1,295 @@
+#include <cstring>
+#include <iterator>
+#include "alu.h"
+#include "jit.h"
+
+#if SIMULATOR_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+JitProgram::JitProgram(uint8_t* code, size_t capacity, size_t code_size, std::vector<JitEntry> entries,
+                       size_t run_count)
+    : m_code(code), m_capacity(capacity), m_code_size(code_size), m_entries(std::move(entries)),
+      m_run_count(run_count) {}
+
+#if SIMULATOR_JIT
+
+JitProgram::~JitProgram() {
+    munmap(m_code, m_capacity);
+}
+
+namespace {
+
+// Host registers for AX..SP: the first four share their byte registers with the
+// 8086 (al/ah, bl/bh, ...), the rest go to r8-r11 so SP never touches rsp
+constexpr uint8_t HOST_WORD[REGISTER16_COUNT] = {0, 3, 1, 2, 8, 9, 10, 11};
+// AL, AH, BL, BH, CL, CH, DL, DH as legacy byte registers, encodable without REX
+constexpr uint8_t HOST_BYTE[8] = {0, 4, 3, 7, 1, 5, 2, 6};
+
+// Both tables are indexed straight from RegisterId, so they must cover exactly the
+// registers translatable() lets through
+static_assert(static_cast<size_t>(RegisterId::SP) + 1 == std::size(HOST_WORD), "HOST_WORD must cover AX..SP");
+static_assert(static_cast<size_t>(RegisterId::DH) - static_cast<size_t>(RegisterId::AL) + 1 == std::size(HOST_BYTE),
+              "HOST_BYTE must cover AL..DH");
+
+constexpr uint8_t HOST_RAX = 0;
+constexpr uint8_t HOST_RCX = 1;
+constexpr uint8_t HOST_RBX = 3;
+constexpr uint8_t HOST_RDI = 7;   // First argument: the Registers pointer
+
+constexpr uint8_t OPERAND_SIZE_16 = 0x66;
+
+// Opcodes by Opcode::Mov..Cmp: "r/m, reg" forms and the group-1 /digit for immediates
+constexpr uint8_t REG_FORM_16[] = {0x89, 0x01, 0x29, 0x39};
+constexpr uint8_t REG_FORM_8[] = {0x88, 0x00, 0x28, 0x38};
+constexpr uint8_t IMMEDIATE_DIGIT[] = {0, 0, 5, 7};
+
+// A general register of the operand width: AX..SP for words, AL..DH for bytes
+bool is_general(RegisterId id, OperandWidth width) {
+    return width == OperandWidth::Byte ? is_8bit_register(id) : id <= RegisterId::SP;
+}
+
+bool translatable(const Instruction& instr) {
+    if (instr.opcode > Opcode::Cmp) return false;
+    if (instr.dest_kind != OperandKind::Register || !is_general(instr.dest, instr.width)) return false;
+    if (instr.src_kind == OperandKind::Immediate) return true;
+    return instr.src_kind == OperandKind::Register && is_general(instr.src, instr.width);
+}
+
+class Emitter {
+public:
+    explicit Emitter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void byte(uint8_t value) { m_out.push_back(value); }
+    void word(uint16_t value) {
+        byte(static_cast<uint8_t>(value));
+        byte(static_cast<uint8_t>(value >> 8));
+    }
+    void dword(uint32_t value) {
+        word(static_cast<uint16_t>(value));
+        word(static_cast<uint16_t>(value >> 16));
+    }
+
+    // REX only when an operand is r8-r15
+    void rex(uint8_t reg, uint8_t rm) {
+        uint8_t prefix = static_cast<uint8_t>(0x40 | ((reg >> 3) << 2) | (rm >> 3));
+        if (prefix != 0x40) byte(prefix);
+    }
+    void modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+        byte(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+    // [rdi + offset]
+    void field(uint8_t reg, size_t offset) {
+        if (offset < 0x80) {
+            modrm(1, reg, HOST_RDI);
+            byte(static_cast<uint8_t>(offset));
+        } else {
+            modrm(2, reg, HOST_RDI);
+            dword(static_cast<uint32_t>(offset));
+        }
+    }
+
+    void load16(uint8_t host, size_t offset) {
+        byte(OPERAND_SIZE_16);
+        rex(host, 0);
+        byte(0x8B);
+        field(host, offset);
+    }
+    void store16(uint8_t host, size_t offset) {
+        byte(OPERAND_SIZE_16);
+        rex(host, 0);
+        byte(0x89);
+        field(host, offset);
+    }
+
+    void instruction(const Instruction& instr) {
+        size_t op = static_cast<size_t>(instr.opcode);
+        bool immediate = instr.src_kind == OperandKind::Immediate;
+
+        if (instr.width == OperandWidth::Byte) {
+            uint8_t dest = host_byte(instr.dest);
+            if (!immediate) {
+                byte(REG_FORM_8[op]);
+                modrm(3, host_byte(instr.src), dest);
+            } else if (instr.opcode == Opcode::Mov) {
+                byte(static_cast<uint8_t>(0xB0 + dest));
+                byte(static_cast<uint8_t>(instr.immediate));
+            } else {
+                byte(0x80);
+                modrm(3, IMMEDIATE_DIGIT[op], dest);
+                byte(static_cast<uint8_t>(instr.immediate));
+            }
+            return;
+        }
+
+        uint8_t dest = host_word(instr.dest);
+        byte(OPERAND_SIZE_16);
+        if (!immediate) {
+            uint8_t src = host_word(instr.src);
+            rex(src, dest);
+            byte(REG_FORM_16[op]);
+            modrm(3, src, dest);
+        } else if (instr.opcode == Opcode::Mov) {
+            rex(0, dest);
+            byte(static_cast<uint8_t>(0xB8 + (dest & 7)));
+            word(instr.immediate);
+        } else {
+            rex(0, dest);
+            byte(0x81);
+            modrm(3, IMMEDIATE_DIGIT[op], dest);
+            word(instr.immediate);
+        }
+    }
+
+private:
+    // Only for registers translatable() accepted at this width
+    static uint8_t host_word(RegisterId id) {
+        return HOST_WORD[static_cast<size_t>(id)];
+    }
+    static uint8_t host_byte(RegisterId id) {
+        return HOST_BYTE[static_cast<size_t>(id) - static_cast<size_t>(RegisterId::AL)];
+    }
+
+    std::vector<uint8_t>& m_out;
+};
+
+// Offsets into Registers, taken from a live object since it is not standard-layout
+struct RegisterOffsets {
+    size_t words[REGISTER16_COUNT];
+    size_t flags;
+    size_t ip;
+
+    RegisterOffsets() {
+        Registers regs;
+        auto base = reinterpret_cast<const char*>(&regs);
+        for (size_t slot = 0; slot < REGISTER16_COUNT; ++slot) {
+            words[slot] = static_cast<size_t>(reinterpret_cast<const char*>(&(regs.*REGISTER_WORDS[slot])) - base);
+        }
+        flags = static_cast<size_t>(reinterpret_cast<const char*>(&regs.flags.value) - base);
+        ip = static_cast<size_t>(reinterpret_cast<const char*>(&regs.ip.value) - base);
+    }
+};
+
+void emit_run(std::vector<uint8_t>& code, const RegisterOffsets& offsets, const Instruction* instrs, size_t count) {
+    uint8_t used = 0;      // Bit per word slot
+    uint8_t written = 0;
+    bool sets_flags = false;
+    uint32_t ip_advance = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const Instruction& instr = instrs[i];
+        uint8_t dest = static_cast<uint8_t>(1u << word_slot(instr.dest));
+        used |= dest;
+        if (instr.src_kind == OperandKind::Register) used |= static_cast<uint8_t>(1u << word_slot(instr.src));
+        if (instr.opcode != Opcode::Cmp) written |= dest;
+        if (instr.opcode != Opcode::Mov) sets_flags = true;
+        ip_advance += instr.size;
+    }
+
+    Emitter out(code);
+    bool saves_rbx = (used & (1u << word_slot(RegisterId::BX))) != 0;
+    if (saves_rbx) out.byte(0x50 + HOST_RBX);   // push rbx (callee-saved)
+
+    for (size_t slot = 0; slot < REGISTER16_COUNT; ++slot) {
+        if (used & (1u << slot)) out.load16(HOST_WORD[slot], offsets.words[slot]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        out.instruction(instrs[i]);
+    }
+    // Plain stores leave the host flags as the last add/sub/cmp set them
+    for (size_t slot = 0; slot < REGISTER16_COUNT; ++slot) {
+        if (written & (1u << slot)) out.store16(HOST_WORD[slot], offsets.words[slot]);
+    }
+
+    if (sets_flags) {
+        // x86-64 keeps CF/PF/AF/ZF/SF/OF at the 8086 bit positions
+        out.byte(0x9C);                                  // pushfq
+        out.byte(0x58 + HOST_RAX);                       // pop rax
+        out.byte(0x25);                                  // and eax, ARITHMETIC_FLAGS_MASK
+        out.dword(ARITHMETIC_FLAGS_MASK);
+        out.byte(0x0F);                                  // movzx ecx, word [flags]
+        out.byte(0xB7);
+        out.field(HOST_RCX, offsets.flags);
+        out.byte(0x81);                                  // and ecx, ~ARITHMETIC_FLAGS_MASK
+        out.modrm(3, 4, HOST_RCX);
+        out.dword(static_cast<uint16_t>(~ARITHMETIC_FLAGS_MASK));
+        out.byte(0x09);                                  // or ecx, eax
+        out.modrm(3, HOST_RAX, HOST_RCX);
+        out.store16(HOST_RCX, offsets.flags);
+    }
+    if (ip_advance > 0) {
+        out.byte(OPERAND_SIZE_16);                       // add word [ip], imm16; flags are saved already
+        out.byte(0x81);
+        out.field(0, offsets.ip);
+        out.word(static_cast<uint16_t>(ip_advance));
+    }
+
+    if (saves_rbx) out.byte(0x58 + HOST_RBX);   // pop rbx
+    out.byte(0xC3);                              // ret
+}
+
+}  // namespace
+
+std::shared_ptr<const JitProgram> jit_compile(const Program& program) {
+    size_t count = program.instructions.size();
+
+    // Runs may only be entered at their first instruction
+    std::vector<bool> leader(count + 1, false);
+    leader[0] = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (!is_jump(program.instructions[i].opcode)) continue;
+        leader[i + 1] = true;
+        uint32_t target = program.lines[i].jump_target;
+        if (target < count) leader[target] = true;
+    }
+
+    RegisterOffsets offsets;
+    std::vector<uint8_t> code;
+    std::vector<size_t> starts;
+    std::vector<JitEntry> entries(count, JitEntry{nullptr, 0});
+    std::vector<size_t> code_offsets(count, 0);
+
+    for (size_t i = 0; i < count;) {
+        if (!translatable(program.instructions[i])) {
+            ++i;
+            continue;
+        }
+        size_t end = i + 1;
+        while (end < count && !leader[end] && translatable(program.instructions[end])) ++end;
+
+        starts.push_back(i);
+        code_offsets[i] = code.size();
+        entries[i].end = static_cast<uint32_t>(end);
+        emit_run(code, offsets, &program.instructions[i], end - i);
+        i = end;
+    }
+    if (starts.empty()) return nullptr;
+
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t capacity = (code.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return nullptr;
+
+    auto base = static_cast<uint8_t*>(memory);
+    std::memcpy(base, code.data(), code.size());
+    // Never writable and executable at the same time
+    if (mprotect(memory, capacity, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, capacity);
+        return nullptr;
+    }
+
+    for (size_t start : starts) {
+        entries[start].function = reinterpret_cast<JitFunction>(base + code_offsets[start]);
+    }
+    return std::make_shared<const JitProgram>(base, capacity, code.size(), std::move(entries), starts.size());
+}
+
+#else
+
+JitProgram::~JitProgram() = default;
+
+std::shared_ptr<const JitProgram> jit_compile(const Program&) {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include "listing_runner.h"
+#include "logger.h"
+
+namespace fs = std::filesystem;
+
+static bool has_wildcard(const std::string& text) {
+    return text.find_first_of("*?") != std::string::npos;
+}
+
+// Matches '*' (any run of characters) and '?' (one character)
+static bool wildcard_match(const char* pattern, const char* text) {
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*text) {
+        if (*pattern == '?' || *pattern == *text) {
+            ++pattern;
+            ++text;
+        } else if (*pattern == '*') {
+            star = pattern++;
+            resume = text;
+        } else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') ++pattern;
+    return *pattern == '\0';
+}
+
+bool is_listing_pattern(const std::string& input) {
+    std::error_code ec;
+    return has_wildcard(input) || fs::is_directory(input, ec);
+}
+
+std::vector<std::string> expand_listings(const std::string& input) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+
+    if (fs::is_directory(input, ec)) {
+        for (const auto& entry : fs::directory_iterator(input, ec)) {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".txt") {
+                paths.push_back(entry.path().string());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    // Walk the pattern one component at a time, fanning out at each wildcard
+    fs::path pattern(input);
+    std::vector<fs::path> current{pattern.root_path()};
+    for (const auto& component : pattern.relative_path()) {
+        std::string part = component.string();
+        std::vector<fs::path> next;
+        for (const auto& base : current) {
+            if (!has_wildcard(part)) {
+                next.push_back(base / component);
+                continue;
+            }
+            fs::path dir = base.empty() ? fs::path(".") : base;
+            for (const auto& entry : fs::directory_iterator(dir, ec)) {
+                std::string name = entry.path().filename().string();
+                if (wildcard_match(part.c_str(), name.c_str())) {
+                    next.push_back(base / name);
+                }
+            }
+        }
+        current = std::move(next);
+    }
+
+    for (const auto& path : current) {
+        if (fs::is_regular_file(path, ec)) {
+            paths.push_back(path.string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static ListingStatus classify(const SimulationResult& result) {
+    if (result.errors > 0) return ListingStatus::Fail;
+    if (!result.passed()) return ListingStatus::Mismatch;
+    return ListingStatus::Pass;
+}
+
+std::vector<ListingReport> run_listings(WorkStealingPool& pool, const std::vector<std::string>& paths,
+                                        const RunnerOptions& options) {
+    std::vector<ListingReport> reports(paths.size());
+    std::mutex flush_mutex;
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        pool.submit([&, i] {
+            ListingReport& report = reports[i];
+            report.path = paths[i];
+
+            Simulator sim;
+            sim.set_lazy_flags(options.lazy_flags);
+            sim.set_alu_kernel(options.alu_kernel);
+            sim.set_max_steps(options.max_steps);
+            sim.set_cycle_model(options.cycle_model);
+            sim.set_program_cache(options.program_cache);
+            std::unique_ptr<Profiler> profile;
+            if (options.profiler) {
+                profile = std::make_unique<Profiler>();
+                sim.set_profiler(profile.get());
+            }
+            sim.output().set_buffered(true, options.capture_debug);
+
+            auto start = std::chrono::steady_clock::now();
+            try {
+                report.result = sim.run_simulation(report.path);
+                report.status = classify(report.result);
+            } catch (const std::exception& e) {
+                report.status = ListingStatus::Fail;
+                report.error = e.what();
+            }
+            report.milliseconds =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(flush_mutex);
+            sim.output().flush();
+            if (profile) options.profiler->merge(*profile);
+        });
+    }
+
+    pool.wait_idle();
+    return reports;
+}
+
+static const char* status_name(ListingStatus status) {
+    switch (status) {
+        case ListingStatus::Pass: return "PASS";
+        case ListingStatus::Mismatch: return "MISMATCH";
+        case ListingStatus::Fail: return "FAIL";
+    }
+    return "?";
+}
+
+void log_listing_report(const std::vector<ListingReport>& reports, double wall_milliseconds) {
+    size_t counts[3] = {};
+    double total_milliseconds = 0.0;
+
+    LOGGER.Info("");
+    LOGGER.Info("=== Listing report ===");
+    for (const auto& report : reports) {
+        counts[static_cast<size_t>(report.status)]++;
+        total_milliseconds += report.milliseconds;
+
+        std::ostringstream line;
+        line << std::left << std::setw(9) << status_name(report.status) << std::right << std::fixed
+             << std::setprecision(3) << std::setw(10) << report.milliseconds << " ms  " << report.path;
+        if (report.result.cycles > 0) {
+            line << "  " << report.result.cycles << " clocks";
+        }
+
+        if (!report.error.empty()) {
+            line << "  (" << report.error << ")";
+        } else if (report.status != ListingStatus::Pass) {
+            const SimulationResult& r = report.result;
+            line << "  (";
+            if (r.errors > 0) line << r.errors << " errors, ";
+            line << r.mismatches << " mismatches";
+            if (r.final_checked && !r.final_match) line << ", final state differs";
+            line << ")";
+        }
+        LOGGER.Info("{}", line.str());
+    }
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3) << reports.size() << " listings: "
+            << counts[static_cast<size_t>(ListingStatus::Pass)] << " passed, "
+            << counts[static_cast<size_t>(ListingStatus::Mismatch)] << " mismatched, "
+            << counts[static_cast<size_t>(ListingStatus::Fail)] << " failed in " << wall_milliseconds
+            << " ms wall (" << total_milliseconds << " ms summed)";
+    LOGGER.Info("{}", summary.str());
+}
@@ -1,15 +1,162 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
 #include "configs_loader.h"
+#include "jit.h"
+#include "listing_runner.h"
 #include "logger.h"
+#include "program_cache.h"
 #include "simulator.h"
+#include "simulator_daemon.h"
+#include "trace.h"
 
 struct SimulatorConfigs {
     Config<std::string> input_file{
         "input_file",
         nullptr,
         "--input",
-        "Path to assembly file to simulate",
-        true,
+        "Path to assembly file to simulate, or a directory / glob of listings to run in parallel",
+        false,
+        ""
+    };
+
+    Config<std::string> binary_file{
+        "binary_file",
+        nullptr,
+        "--binary",
+        "Path to assembled 8086 binary to decode and simulate",
+        false,
+        ""
+    };
+
+    Config<bool> lazy_flags{
+        "lazy_flags",
+        nullptr,
+        "--lazy-flags",
+        "Compute flags only when they are read",
+        false,
+        false
+    };
+
+    Config<std::string> alu_kernel{
+        "alu_kernel",
+        nullptr,
+        "--alu",
+        "ALU kernel for add/sub/cmp: reference or table",
+        false,
+        "reference"
+    };
+
+    Config<int> jobs{
+        "jobs",
+        "-j",
+        "--jobs",
+        "Worker threads for directory / glob input (0 = all cores)",
+        false,
+        0
+    };
+
+    Config<std::string> trace_file{
+        "trace_file",
+        nullptr,
+        "--trace-file",
+        "Write the per-step register/flag changes to a compact binary trace instead of the log",
+        false,
+        ""
+    };
+
+    Config<std::string> mode{
+        "mode",
+        nullptr,
+        "--mode",
+        "Execution policy: trace (log and validate every step) or bench (raw throughput)",
+        false,
+        "trace"
+    };
+
+    Config<int> repeat{
+        "repeat",
+        nullptr,
+        "--repeat",
+        "Passes over the program in bench mode",
+        false,
+        1
+    };
+
+    Config<bool> jit{
+        "jit",
+        nullptr,
+        "--jit",
+        "In bench mode, run straight-line code as native x86-64 code",
+        false,
+        false
+    };
+
+    Config<bool> pipeline{
+        "pipeline",
+        nullptr,
+        "--pipeline",
+        "Parse the --input listing on a second thread while executing it (no jumps)",
+        false,
+        false
+    };
+
+    Config<std::string> program_cache{
+        "program_cache",
+        nullptr,
+        "--program-cache",
+        "Keep compiled listings in this directory and reuse them while a listing is unchanged",
+        false,
+        ""
+    };
+
+    Config<std::string> serve{
+        "serve",
+        nullptr,
+        "--serve",
+        "Stay resident and run listings sent by simulator_client over this Unix domain socket",
+        false,
+        ""
+    };
+
+    Config<int> max_steps{
+        "max_steps",
+        nullptr,
+        "--max-steps",
+        "Stop a program that has not finished after this many instructions (0 = no limit)",
+        false,
+        1000000
+    };
+
+    Config<std::string> cycles{
+        "cycles",
+        nullptr,
+        "--cycles",
+        "Estimate clocks per traced step and per listing: off, 8086 or 8088",
+        false,
+        "off"
+    };
+
+    Config<bool> profile{
+        "profile",
+        nullptr,
+        "--profile",
+        "Time each step's stages and mnemonics and print p50/p99/max at exit",
+        false,
+        false
+    };
+
+    Config<std::string> profile_file{
+        "profile_file",
+        nullptr,
+        "--profile-file",
+        "Also write the profile to this path, as JSON for *.json and CSV otherwise",
+        false,
         ""
     };
 
@@ -23,30 +170,164 @@ struct SimulatorConfigs {
     };
 
     auto get_all_configs() {
-        return std::tie(input_file, verbosity);
+        return std::tie(input_file, binary_file, lazy_flags, alu_kernel, jobs, trace_file, mode, repeat,
+                        jit, pipeline, program_cache, serve, max_steps, cycles, profile, profile_file, verbosity);
     }
 
     auto get_all_configs() const {
-        return std::tie(input_file, verbosity);
+        return std::tie(input_file, binary_file, lazy_flags, alu_kernel, jobs, trace_file, mode, repeat,
+                        jit, pipeline, program_cache, serve, max_steps, cycles, profile, profile_file, verbosity);
     }
 };
 
+constexpr size_t TRACE_BUFFER_RECORDS = 4096;
+
+// Prints the profile's percentiles and writes it to --profile-file if given
+static bool report_profile(const SimulatorConfigs& configs, const Profiler& profiler) {
+    LOGGER.Info("");
+    LOGGER.Info("=== Profile ({}) ===", TIMESTAMP_UNIT);
+    auto log_row = [](const std::string& kind, const std::string& name, const std::string& count,
+                      const std::string& p50, const std::string& p99, const std::string& max) {
+        std::ostringstream line;
+        line << std::left << std::setw(9) << kind << std::setw(10) << name << std::right << std::setw(10) << count
+             << std::setw(10) << p50 << std::setw(10) << p99 << std::setw(10) << max;
+        LOGGER.Info("{}", line.str());
+    };
+    log_row("kind", "name", "count", "p50", "p99", "max");
+    for (const ProfileRow& row : profiler.rows()) {
+        if (row.count == 0) continue;
+        log_row(row.kind, row.name, std::to_string(row.count), std::to_string(row.p50), std::to_string(row.p99),
+                std::to_string(row.max));
+    }
+
+    if (configs.profile_file.was_provided && !profiler.write(configs.profile_file.value)) {
+        LOGGER.Error("Cannot write profile: {}", configs.profile_file.value);
+        return false;
+    }
+    return true;
+}
+
+// Runs every listing matched by --input in parallel; non-zero exit if any did not pass
+static int run_listing_suite(const SimulatorConfigs& configs, AluKernel alu_kernel, CycleModel cycle_model,
+                             Profiler* profiler, const ProgramCache* program_cache) {
+    std::vector<std::string> paths = expand_listings(configs.input_file.value);
+    if (paths.empty()) {
+        LOGGER.Error("No listings match: {}", configs.input_file.value);
+        return 1;
+    }
+    if (configs.jobs.value < 0) {
+        LOGGER.Error("Invalid job count: {}", configs.jobs.value);
+        return 1;
+    }
+
+    RunnerOptions options;
+    options.lazy_flags = configs.lazy_flags.value;
+    options.alu_kernel = alu_kernel;
+    options.capture_debug = configs.verbosity.value == "debug";
+    options.max_steps = static_cast<uint64_t>(configs.max_steps.value);
+    options.cycle_model = cycle_model;
+    options.profiler = profiler;
+    options.program_cache = program_cache;
+
+    WorkStealingPool pool(static_cast<size_t>(configs.jobs.value));
+    LOGGER.Info("Running {} listings on {} threads", paths.size(), pool.thread_count());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ListingReport> reports = run_listings(pool, paths, options);
+    double wall_milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    log_listing_report(reports, wall_milliseconds);
+    if (profiler && !report_profile(configs, *profiler)) return 1;
+
+    bool all_passed = std::all_of(reports.begin(), reports.end(),
+                                  [](const ListingReport& r) { return r.status == ListingStatus::Pass; });
+    return all_passed ? 0 : 1;
+}
+
+static std::atomic<bool> g_stop_serving{false};
+
+static void stop_serving(int) {
+    g_stop_serving.store(true);
+}
+
+// Serves client requests until SIGINT or SIGTERM
+static int run_daemon(const SimulatorConfigs& configs, const ProgramCache* program_cache) {
+    if (configs.jobs.value < 0) {
+        LOGGER.Error("Invalid job count: {}", configs.jobs.value);
+        return 1;
+    }
+    std::signal(SIGINT, stop_serving);
+    std::signal(SIGTERM, stop_serving);
+
+    try {
+        SimulatorDaemon daemon(configs.serve.value, static_cast<size_t>(configs.jobs.value), program_cache);
+        daemon.serve(g_stop_serving);
+        return 0;
+    } catch (const std::exception& e) {
+        LOGGER.Error("Daemon error: {}", e.what());
+        return 1;
+    }
+}
+
+// Times the program under BenchPolicy: no change tracking, step logging or validation
+static int run_bench_mode(Simulator& sim, const Program& program, int repeat) {
+    if (repeat < 1) {
+        LOGGER.Error("Invalid repeat count: {}", repeat);
+        return 1;
+    }
+
+    if (program.jit) {
+        LOGGER.Info("JIT: {} translated runs in {} bytes of native code", program.jit->run_count(),
+                    program.jit->code_size());
+    }
+
+    // Every pass starts from a fresh machine, so each one runs the same instructions
+    SimulationResult result;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < repeat; ++pass) {
+        sim.reset();
+        result = sim.run_program<BenchPolicy>(program);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double executed = static_cast<double>(result.instructions) * repeat;
+    LOGGER.Info("Bench: {} instructions x {} passes in {} ms", result.instructions, repeat, seconds * 1e3);
+    if (executed > 0) {
+        LOGGER.Info("       {} ns/instruction, {} M instructions/s", seconds * 1e9 / executed,
+                    executed / seconds / 1e6);
+    }
+    if (result.errors > 0) {
+        LOGGER.Warn("{} lines failed per pass", result.errors);
+    }
+    LOGGER.Info("Final registers: {}", sim.get_registers().dump());
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     ConfigsLoader<SimulatorConfigs> configs(argv[0]);
 
-    if (!configs.parse_and_validate(argc, argv)) {
+    bool parsed = configs.parse_and_validate(argc, argv);
+    // A daemon takes its listings from clients instead
+    bool single_source = configs.serve.was_provided
+                             ? !configs.input_file.was_provided && !configs.binary_file.was_provided
+                             : configs.input_file.was_provided != configs.binary_file.was_provided;
+
+    if (!parsed || !single_source) {
         Logger::Config error_config;
         error_config.print_metadata = false;
         Logger::Init(error_config);
         if (!configs.get_error().empty()) {
             LOGGER.Error("{}", configs.get_error());
             configs.print_usage();
+        } else if (!single_source) {
+            LOGGER.Error(configs.serve.was_provided ? "--serve takes its listings from simulator_client"
+                                                    : "Exactly one of --input or --binary is required");
+            configs.print_usage();
         }
         return 1;
     }
 
-    std::string input_file = configs.input_file.value;
-
     Logger::Config logger_config;
     if (configs.verbosity.was_provided) {
         logger_config.level = Logger::ParseLogLevel(configs.verbosity.value);
@@ -55,9 +336,125 @@ int main(int argc, char* argv[]) {
 
     LOGGER.Info("=== Computer Enhance - 8086 Simulator ===");
 
+    AluKernel alu_kernel = AluKernel::Reference;
+    if (configs.alu_kernel.value == "table") {
+        alu_kernel = AluKernel::Table;
+    } else if (configs.alu_kernel.value != "reference") {
+        LOGGER.Error("Unknown ALU kernel: {}", configs.alu_kernel.value);
+        return 1;
+    }
+
+    CycleModel cycle_model = CycleModel::Off;
+    if (!parse_cycle_model(configs.cycles.value, cycle_model)) {
+        LOGGER.Error("Unknown cycle model: {}", configs.cycles.value);
+        return 1;
+    }
+
+    bool bench_mode = configs.mode.value == "bench";
+    if (!bench_mode && configs.mode.value != "trace") {
+        LOGGER.Error("Unknown mode: {}", configs.mode.value);
+        return 1;
+    }
+
+    if (configs.jit.value && (!bench_mode || !jit_available())) {
+        LOGGER.Error(bench_mode ? "--jit needs an x86-64 System V host" : "--jit only applies to --mode bench");
+        return 1;
+    }
+
+    if (configs.pipeline.value && (bench_mode || !configs.input_file.was_provided ||
+                                   is_listing_pattern(configs.input_file.value))) {
+        LOGGER.Error("--pipeline needs a single --input listing in trace mode");
+        return 1;
+    }
+
+    std::unique_ptr<ProgramCache> program_cache;
+    if (configs.program_cache.was_provided) {
+        if (configs.pipeline.value) {
+            LOGGER.Error("--pipeline parses as it runs; it cannot use --program-cache");
+            return 1;
+        }
+        program_cache = std::make_unique<ProgramCache>(configs.program_cache.value);
+    }
+
+    if (configs.serve.was_provided) {
+        if (bench_mode || configs.pipeline.value || configs.trace_file.was_provided || configs.profile.value ||
+            configs.profile_file.was_provided) {
+            LOGGER.Error("--serve runs traced listings; clients choose the other options per run");
+            return 1;
+        }
+        return run_daemon(configs, program_cache.get());
+    }
+
+    if (configs.max_steps.value < 0) {
+        LOGGER.Error("Invalid step limit: {}", configs.max_steps.value);
+        return 1;
+    }
+
+    std::unique_ptr<Profiler> profiler;
+    if (configs.profile.value || configs.profile_file.was_provided) {
+        if (bench_mode) {
+            LOGGER.Error("--profile times traced runs; it has no effect with --mode bench");
+            return 1;
+        }
+        profiler = std::make_unique<Profiler>();
+    }
+
+    if (configs.input_file.was_provided && is_listing_pattern(configs.input_file.value)) {
+        if (bench_mode) {
+            LOGGER.Error("--mode bench needs a single --input file or --binary");
+            return 1;
+        }
+        if (configs.trace_file.was_provided) {
+            LOGGER.Error("--trace-file needs a single --input file or --binary");
+            return 1;
+        }
+        return run_listing_suite(configs, alu_kernel, cycle_model, profiler.get(), program_cache.get());
+    }
+
     try {
         Simulator sim;
-        sim.run_simulation(input_file);
+        sim.set_lazy_flags(configs.lazy_flags.value);
+        sim.set_alu_kernel(alu_kernel);
+        sim.set_max_steps(static_cast<uint64_t>(configs.max_steps.value));
+        sim.set_cycle_model(cycle_model);
+        sim.set_profiler(profiler.get());
+        sim.set_program_cache(program_cache.get());
+
+        if (bench_mode) {
+            sim.set_jit(configs.jit.value);
+            Program program = configs.binary_file.was_provided ? sim.load_binary(configs.binary_file.value)
+                                                               : sim.load_program(configs.input_file.value);
+            return run_bench_mode(sim, program, configs.repeat.value);
+        }
+
+        std::unique_ptr<TraceWriter> trace_writer;
+        std::unique_ptr<TraceBuffer> trace_buffer;
+        if (configs.trace_file.was_provided) {
+            trace_writer = std::make_unique<TraceWriter>(configs.trace_file.value);
+            trace_buffer = std::make_unique<TraceBuffer>(TRACE_BUFFER_RECORDS);
+            trace_buffer->set_writer(trace_writer.get());
+            sim.set_trace(trace_buffer.get());
+        }
+
+        SimulationResult result;
+        if (configs.binary_file.was_provided) {
+            result = sim.run_program(sim.load_binary(configs.binary_file.value));
+        } else if (configs.pipeline.value) {
+            result = sim.run_pipelined(configs.input_file.value);
+        } else {
+            result = sim.run_simulation(configs.input_file.value);
+        }
+
+        if (trace_writer) {
+            trace_buffer->flush();
+            if (!trace_writer->finish()) {
+                LOGGER.Error("Cannot write trace file: {}", configs.trace_file.value);
+                return 1;
+            }
+            LOGGER.Info("Trace: {} steps, {} records, {} bytes written to {}", result.instructions,
+                        trace_writer->records_written(), trace_writer->bytes_written(), configs.trace_file.value);
+        }
+        if (profiler && !report_profile(configs, *profiler)) return 1;
         return 0;
     } catch (const std::exception& e) {
         LOGGER.Error("Simulator error: {}", e.what());
@@ -0,0 +1,12 @@
+#include <cstring>
+#include "memory.h"
+
+Memory::Memory() : m_bytes(new uint8_t[MEMORY_SIZE]()) {}
+
+void Memory::clear() {
+    if (m_dirty_begin < m_dirty_end) {
+        std::memset(m_bytes.get() + m_dirty_begin, 0, m_dirty_end - m_dirty_begin);
+    }
+    m_dirty_begin = MEMORY_SIZE;
+    m_dirty_end = 0;
+}
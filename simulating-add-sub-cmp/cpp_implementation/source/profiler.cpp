@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <fstream>
+#include "profiler.h"
+
+static constexpr const char* STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+    "parse", "tokenize", "lookup", "compile", "execute", "flag_diff", "trace", "validate",
+};
+
+const char* profile_stage_name(ProfileStage stage) {
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+static unsigned highest_bit(uint64_t value) {
+#if defined(__GNUC__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+#endif
+}
+
+static size_t bucket_index(uint64_t value) {
+    if (value < 8) return static_cast<size_t>(value);
+    unsigned octave = highest_bit(value);
+    size_t sub = static_cast<size_t>((value >> (octave - 2)) & 3);
+    return 8 + (octave - 3) * 4 + sub;
+}
+
+static uint64_t bucket_upper_bound(size_t index) {
+    if (index < 8) return index;
+    unsigned octave = static_cast<unsigned>((index - 8) / 4 + 3);
+    uint64_t sub = (index - 8) % 4;
+    uint64_t lower = (4 + sub) << (octave - 2);
+    return lower + (uint64_t(1) << (octave - 2)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    m_buckets[bucket_index(value)]++;
+    m_count++;
+    m_sum += value;
+    m_max = std::max(m_max, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) m_buckets[i] += other.m_buckets[i];
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max(m_max, other.m_max);
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (m_count == 0) return 0;
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(m_count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) return std::min(bucket_upper_bound(i), m_max);
+    }
+    return m_max;
+}
+
+void Profiler::merge(const Profiler& other) {
+    for (size_t i = 0; i < PROFILE_STAGE_COUNT; ++i) m_stages[i].merge(other.m_stages[i]);
+    for (size_t i = 0; i < OPCODE_COUNT; ++i) m_opcodes[i].merge(other.m_opcodes[i]);
+}
+
+static ProfileRow make_row(const char* kind, const char* name, const LatencyHistogram& histogram) {
+    return {kind, name, histogram.count(), histogram.mean(), histogram.percentile(0.50),
+            histogram.percentile(0.99), histogram.max()};
+}
+
+std::vector<ProfileRow> Profiler::rows() const {
+    std::vector<ProfileRow> rows;
+    for (size_t i = 0; i < PROFILE_STAGE_COUNT; ++i) {
+        rows.push_back(make_row("stage", STAGE_NAMES[i], m_stages[i]));
+    }
+    for (size_t i = 0; i < OPCODE_COUNT; ++i) {
+        if (m_opcodes[i].count() == 0) continue;
+        rows.push_back(make_row("mnemonic", opcode_name(static_cast<Opcode>(i)), m_opcodes[i]));
+    }
+    return rows;
+}
+
+bool Profiler::write(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    std::vector<ProfileRow> table = rows();
+    if (json) {
+        out << "{\n  \"unit\": \"" << TIMESTAMP_UNIT << "\",\n  \"rows\": [\n";
+        for (size_t i = 0; i < table.size(); ++i) {
+            const ProfileRow& row = table[i];
+            out << "    {\"kind\": \"" << row.kind << "\", \"name\": \"" << row.name << "\", \"count\": " << row.count
+                << ", \"mean\": " << row.mean << ", \"p50\": " << row.p50 << ", \"p99\": " << row.p99
+                << ", \"max\": " << row.max << "}" << (i + 1 < table.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    } else {
+        out << "kind,name,count,mean_" << TIMESTAMP_UNIT << ",p50,p99,max\n";
+        for (const ProfileRow& row : table) {
+            out << row.kind << "," << row.name << "," << row.count << "," << row.mean << "," << row.p50 << ","
+                << row.p99 << "," << row.max << "\n";
+        }
+    }
+    return static_cast<bool>(out);
+}
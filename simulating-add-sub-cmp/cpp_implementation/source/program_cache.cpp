@@ -0,0 +1,330 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include "program_cache.h"
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = {'S', 'I', 'M', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t CACHE_VERSION = 4;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;   // Reads back differently on a host of the other endianness
+constexpr const char* CACHE_EXTENSION = ".simcache";
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t instruction_size;    // sizeof(Instruction) when written
+    uint32_t line_size;           // sizeof(CachedLine) when written
+    uint64_t source_hash;
+    uint64_t source_check;        // check_hash of the listing, to tell source_hash collisions apart
+    uint64_t source_size;
+    uint64_t payload_checksum;    // content_hash of everything after the header
+    uint32_t instruction_count;
+    uint32_t final_line_count;
+    uint32_t string_table_size;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(CacheHeader) == 72, "CacheHeader layout grew unexpectedly");
+
+constexpr uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Second 64-bit hash of the listing, built unlike content_hash (MurmurHash3-style
+// lanes and finalizer), so a listing colliding with another under one hash still
+// differs under the other
+uint64_t check_hash(std::string_view bytes) {
+    constexpr uint64_t C1 = 0x87C37B91114253D5;
+    constexpr uint64_t C2 = 0x4CF5AD432745937F;
+
+    uint64_t hash = 0x9368E53C2F6AF274 ^ bytes.size();
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, sizeof(word));
+        hash ^= rotate_left(word * C1, 31) * C2;
+        hash = rotate_left(hash, 27) * 5 + 0x52DCE729;
+    }
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < bytes.size(); ++i, shift += 8) {
+        tail |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << shift;
+    }
+    hash ^= rotate_left(tail * C1, 31) * C2;
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCD;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53;
+    return hash ^ (hash >> 33);
+}
+
+struct CachedView {
+    uint32_t offset;
+    uint32_t size;
+};
+
+// ProgramLine with its views as offsets: into the listing, or for errors into
+// the string table at the end of the entry
+struct CachedLine {
+    int32_t line_number;
+    uint32_t jump_target;
+    CachedView display;
+    CachedView error;
+    CachedView unknown_registers[MAX_EXPECTED_REGISTERS];
+    uint16_t register_values[MAX_EXPECTED_REGISTERS];
+    uint16_t flags_mask;
+    uint16_t flags_value;
+    RegisterId register_ids[MAX_EXPECTED_REGISTERS];
+    char unknown_flags[MAX_EXPECTED_FLAGS];
+    uint8_t register_count;
+    uint8_t unknown_register_count;
+    uint8_t unknown_flag_count;
+    uint8_t has_expected;
+    SimStatus status;             // LineStatus of the line; its line is line_number
+    Opcode status_opcode;
+    uint8_t reserved;
+    uint16_t status_column;
+    uint16_t status_length;
+};
+
+static_assert(sizeof(CachedLine) == 92, "CachedLine layout grew unexpectedly");
+static_assert(std::is_trivially_copyable_v<CachedLine>, "CachedLine is copied as bytes");
+
+bool cache_view(std::string_view text, std::string_view view, CachedView& out) {
+    out = {0, 0};
+    if (view.empty()) return true;
+    if (view.data() < text.data() || view.data() + view.size() > text.data() + text.size()) return false;
+    out = {static_cast<uint32_t>(view.data() - text.data()), static_cast<uint32_t>(view.size())};
+    return true;
+}
+
+bool resolve_view(std::string_view text, CachedView view, std::string_view& out) {
+    if (view.offset > text.size() || view.size > text.size() - view.offset) return false;
+    out = text.substr(view.offset, view.size);
+    return true;
+}
+
+bool cache_line(std::string_view text, const ProgramLine& info, std::string& strings, CachedLine& cached) {
+    cached.line_number = info.line_number;
+    cached.jump_target = info.jump_target;
+    if (!cache_view(text, info.display, cached.display)) return false;
+    cached.error = {static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(info.error.size())};
+    strings += info.error;
+    cached.status = info.status.status;
+    cached.status_opcode = info.status.opcode;
+    cached.status_column = info.status.column;
+    cached.status_length = info.status.length;
+
+    const ExpectedState& expected = info.expected;
+    cached.has_expected = info.has_expected ? 1 : 0;
+    cached.register_count = expected.registers.count;
+    for (size_t i = 0; i < expected.registers.size(); ++i) {
+        cached.register_ids[i] = expected.registers.items[i].id;
+        cached.register_values[i] = expected.registers.items[i].value;
+    }
+    cached.flags_mask = expected.flags_mask;
+    cached.flags_value = expected.flags_value;
+    cached.unknown_register_count = expected.unknown_registers.count;
+    for (size_t i = 0; i < expected.unknown_registers.size(); ++i) {
+        if (!cache_view(text, expected.unknown_registers.items[i], cached.unknown_registers[i])) return false;
+    }
+    cached.unknown_flag_count = expected.unknown_flags.count;
+    std::memcpy(cached.unknown_flags, expected.unknown_flags.items, expected.unknown_flags.size());
+    return true;
+}
+
+bool restore_line(std::string_view text, std::string_view strings, const CachedLine& cached, ProgramLine& info) {
+    if (cached.register_count > MAX_EXPECTED_REGISTERS || cached.unknown_register_count > MAX_EXPECTED_REGISTERS ||
+        cached.unknown_flag_count > MAX_EXPECTED_FLAGS || cached.status > SimStatus::DecodeError ||
+        cached.status_opcode > Opcode::Invalid) {
+        return false;
+    }
+    std::string_view error;
+    if (!resolve_view(text, cached.display, info.display) || !resolve_view(strings, cached.error, error)) return false;
+
+    info.line_number = cached.line_number;
+    info.jump_target = cached.jump_target;
+    info.error.assign(error.data(), error.size());
+    info.has_expected = cached.has_expected != 0;
+    if (cached.status != SimStatus::Ok) {
+        info.status = {cached.status, cached.status_opcode, cached.status_column, cached.status_length,
+                       cached.line_number};
+    }
+
+    ExpectedState& expected = info.expected;
+    for (size_t i = 0; i < cached.register_count; ++i) {
+        expected.registers.push_back({cached.register_ids[i], cached.register_values[i]});
+    }
+    expected.flags_mask = cached.flags_mask;
+    expected.flags_value = cached.flags_value;
+    for (size_t i = 0; i < cached.unknown_register_count; ++i) {
+        std::string_view name;
+        if (!resolve_view(text, cached.unknown_registers[i], name)) return false;
+        expected.unknown_registers.push_back(name);
+    }
+    for (size_t i = 0; i < cached.unknown_flag_count; ++i) {
+        expected.unknown_flags.push_back(cached.unknown_flags[i]);
+    }
+    return true;
+}
+
+template <typename T>
+void append_bytes(std::string& out, const T* items, size_t count) {
+    out.append(reinterpret_cast<const char*>(items), count * sizeof(T));
+}
+
+}  // namespace
+
+uint64_t content_hash(std::string_view bytes) {
+    constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15;   // 2^64 / golden ratio
+    constexpr uint64_t FNV_PRIME = 0x100000001B3;
+
+    uint64_t hash = 0xCBF29CE484222325 ^ bytes.size();   // FNV offset basis
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, sizeof(word));
+        word *= MULTIPLIER;
+        word ^= word >> 32;
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    for (; i < bytes.size(); ++i) {
+        hash = (hash ^ static_cast<unsigned char>(bytes[i])) * FNV_PRIME;
+    }
+    return hash ^ (hash >> 29);
+}
+
+ProgramCache::ProgramCache(std::string directory) : m_directory(std::move(directory)) {}
+
+std::string ProgramCache::entry_path(uint64_t hash) const {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (size_t i = 0; i < name.size(); ++i) {
+        name[name.size() - 1 - i] = DIGITS[(hash >> (4 * i)) & 0xF];
+    }
+    return (std::filesystem::path(m_directory) / (name + CACHE_EXTENSION)).string();
+}
+
+bool ProgramCache::load(Program& program, std::string_view text, uint64_t hash) const {
+
+    std::unique_ptr<MappedFile> entry;
+    try {
+        entry = std::make_unique<MappedFile>(entry_path(hash));
+    } catch (const std::exception&) {
+        return false;
+    }
+    const uint8_t* bytes = entry->bytes();
+
+    CacheHeader header;
+    if (entry->size() < sizeof(header)) return false;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.byte_order != BYTE_ORDER_MARK || header.instruction_size != sizeof(Instruction) ||
+        header.line_size != sizeof(CachedLine) || header.source_hash != hash || header.source_size != text.size() ||
+        header.source_check != check_hash(text)) {
+        return false;
+    }
+
+    size_t count = header.instruction_count;
+    size_t instructions_size = count * sizeof(Instruction);
+    size_t lines_size = count * sizeof(CachedLine);
+    size_t final_size = header.final_line_count * sizeof(CachedView);
+    if (entry->size() != sizeof(header) + instructions_size + lines_size + final_size + header.string_table_size) {
+        return false;
+    }
+    const uint8_t* payload = bytes + sizeof(header);
+    if (content_hash({reinterpret_cast<const char*>(payload), entry->size() - sizeof(header)}) !=
+        header.payload_checksum) {
+        return false;
+    }
+
+    const uint8_t* lines_data = payload + instructions_size;
+    const uint8_t* final_data = lines_data + lines_size;
+    std::string_view strings(reinterpret_cast<const char*>(final_data + final_size), header.string_table_size);
+
+    std::vector<Instruction> instructions(count);
+    std::memcpy(instructions.data(), payload, instructions_size);
+
+    std::vector<ProgramLine> lines(count);
+    for (size_t i = 0; i < count; ++i) {
+        CachedLine cached;
+        std::memcpy(&cached, lines_data + i * sizeof(CachedLine), sizeof(cached));
+        if (!restore_line(text, strings, cached, lines[i])) return false;
+    }
+
+    std::vector<std::string_view> final_section(header.final_line_count);
+    for (size_t i = 0; i < final_section.size(); ++i) {
+        CachedView view;
+        std::memcpy(&view, final_data + i * sizeof(CachedView), sizeof(view));
+        if (!resolve_view(text, view, final_section[i])) return false;
+    }
+
+    program.instructions = std::move(instructions);
+    program.lines = std::move(lines);
+    program.final_section = std::move(final_section);
+    return true;
+}
+
+bool ProgramCache::store(const Program& program, std::string_view text, uint64_t hash) const {
+    if (text.size() > UINT32_MAX || program.instructions.size() > UINT32_MAX) return false;
+
+    std::string payload;
+    payload.reserve(program.instructions.size() * (sizeof(Instruction) + sizeof(CachedLine)));
+    append_bytes(payload, program.instructions.data(), program.instructions.size());
+
+    std::string strings;
+    for (const ProgramLine& info : program.lines) {
+        CachedLine cached{};
+        if (!cache_line(text, info, strings, cached)) return false;
+        append_bytes(payload, &cached, 1);
+    }
+    for (std::string_view line : program.final_section) {
+        CachedView view;
+        if (!cache_view(text, line, view)) return false;
+        append_bytes(payload, &view, 1);
+    }
+    if (strings.size() > UINT32_MAX) return false;
+    payload += strings;
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.instruction_size = sizeof(Instruction);
+    header.line_size = sizeof(CachedLine);
+    header.source_hash = hash;
+    header.source_check = check_hash(text);
+    header.source_size = text.size();
+    header.payload_checksum = content_hash(payload);
+    header.instruction_count = static_cast<uint32_t>(program.instructions.size());
+    header.final_line_count = static_cast<uint32_t>(program.final_section.size());
+    header.string_table_size = static_cast<uint32_t>(strings.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+
+    // Written aside and renamed into place, so readers see the old entry or the whole new one
+    std::string path = entry_path(hash);
+    std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,6 @@
+#include "register_id.h"
+
+const char* register_name(RegisterId id) {
+    if (id == RegisterId::None) return "none";
+    return REGISTER_NAMES[static_cast<size_t>(id)].data();
+}
@@ -21,6 +21,21 @@ void Flags::reset() {
     value = 0;
 }
 
+const char* Flags::name(uint16_t mask) {
+    switch (mask) {
+        case FLAG_CF: return "CF";
+        case FLAG_PF: return "PF";
+        case FLAG_AF: return "AF";
+        case FLAG_ZF: return "ZF";
+        case FLAG_SF: return "SF";
+        case FLAG_TF: return "TF";
+        case FLAG_IF: return "IF";
+        case FLAG_DF: return "DF";
+        case FLAG_OF: return "OF";
+        default: return "??";
+    }
+}
+
 std::string Flags::dump() const {
     std::ostringstream out;
     out << "FLAGS: "
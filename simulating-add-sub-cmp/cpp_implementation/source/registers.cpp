@@ -1,44 +1,51 @@
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
+#include "alu.h"
 #include "registers.h"
 
-Registers::Registers() {
-    reg16_map = {
-        {"ax", &ax}, {"bx", &bx}, {"cx", &cx}, {"dx", &dx},
-        {"si", &si}, {"di", &di}, {"bp", &bp}, {"sp", &sp},
-    };
-
-    reg8_map = {
-        {"ah", &ax.high}, {"al", &ax.low},
-        {"bh", &bx.high}, {"bl", &bx.low},
-        {"ch", &cx.high}, {"cl", &cx.low},
-        {"dh", &dx.high}, {"dl", &dx.low},
-    };
-}
+Registers::Registers()
+    : m_captured_flags_value(0), m_pending_flags{0, 0, 0, FlagsOp::None, 0}, m_lazy_flags(false),
+      m_alu_kernel(AluKernel::Reference) {}
 
 Register16Proxy Registers::get16(const std::string& name) {
-    auto it = reg16_map.find(name);
-    if (it == reg16_map.end()) {
+    RegisterId id = register_id_from_name(name);
+    if (!is_16bit_register(id)) {
         throw std::runtime_error("Unknown 16-bit register: " + name);
     }
-    return Register16Proxy(*this, name, &(it->second->value));
+    return get16(id);
 }
 
 Register8Proxy Registers::get8(const std::string& name) {
-    auto it = reg8_map.find(name);
-    if (it == reg8_map.end()) {
+    RegisterId id = register_id_from_name(name);
+    if (!is_8bit_register(id)) {
         throw std::runtime_error("Unknown 8-bit register: " + name);
     }
-    return Register8Proxy(*this, name, it->second);
+    return get8(id);
+}
+
+uint16_t Registers::read(RegisterId id) const {
+    const Register16& reg = word_register(id);
+    if (is_8bit_register(id)) {
+        return is_high_byte(id) ? reg.high : reg.low;
+    }
+    return reg.value;
+}
+
+void Registers::write(RegisterId id, uint16_t value) {
+    if (is_8bit_register(id)) {
+        *byte_register(id) = static_cast<uint8_t>(value);
+    } else {
+        word_register(id).value = value;
+    }
 }
 
 bool Registers::is8(const std::string& name) const {
-    return reg8_map.count(name) > 0;
+    return is_8bit_register(register_id_from_name(name));
 }
 
 bool Registers::is16(const std::string& name) const {
-    return reg16_map.count(name) > 0;
+    return is_16bit_register(register_id_from_name(name));
 }
 
 std::string Registers::dump() const {
@@ -52,21 +59,26 @@ std::string Registers::dump() const {
         << "SI=" << std::setw(4) << si.value << " "
         << "DI=" << std::setw(4) << di.value << " "
         << "BP=" << std::setw(4) << bp.value << " "
-        << "SP=" << std::setw(4) << sp.value << " | "
-        << flags.dump();
+        << "SP=" << std::setw(4) << sp.value << " "
+        << "ES=" << std::setw(4) << es.value << " "
+        << "CS=" << std::setw(4) << cs.value << " "
+        << "SS=" << std::setw(4) << ss.value << " "
+        << "DS=" << std::setw(4) << ds.value << " "
+        << "IP=" << std::setw(4) << ip.value << " | "
+        << resolved_flags().dump();
 
     return out.str();
 }
 
-void Registers::mark_register_change(const std::string& name, uint16_t old_value, uint16_t new_value) {
+void Registers::mark_register_change(RegisterId id, uint16_t old_value, uint16_t new_value) {
     if (old_value != new_value) {
-        m_change_set.register_changes.push_back({name, old_value, new_value});
+        m_change_set.register_changes.push_back({id, old_value, new_value});
     }
 }
 
-void Registers::mark_flag_change(const std::string& flag_name, bool old_value, bool new_value) {
+void Registers::mark_flag_change(uint16_t flag_mask, bool old_value, bool new_value) {
     if (old_value != new_value) {
-        m_change_set.flags_changes.push_back({flag_name, old_value, new_value});
+        m_change_set.flags_changes.push_back({flag_mask, old_value, new_value});
     }
 }
 
@@ -76,33 +88,50 @@ ChangeSet Registers::get_last_changes() {
     return result;
 }
 
+void Registers::discard_changes() {
+    m_change_set.clear();
+}
+
 void Registers::capture_flags() {
+    materialize_flags();
     m_captured_flags_value = flags.value;
 }
 
+void Registers::set_lazy_flags(bool enabled) {
+    materialize_flags();
+    m_lazy_flags = enabled;
+}
+
+void Registers::set_alu_kernel(AluKernel kernel) {
+    materialize_flags();
+    m_alu_kernel = kernel;
+}
+
+Flags Registers::resolved_flags() const {
+    Flags resolved = flags;
+    if (m_pending_flags.op != FlagsOp::None) {
+        resolved.value = static_cast<uint16_t>((resolved.value & ~ARITHMETIC_FLAGS_MASK) |
+                                               arithmetic_flags(m_alu_kernel, m_pending_flags));
+    }
+    return resolved;
+}
+
+void Registers::materialize_flags() {
+    if (m_pending_flags.op == FlagsOp::None) return;
+    flags = resolved_flags();
+    m_pending_flags.op = FlagsOp::None;
+}
+
 void Registers::check_flag_changes() {
+    materialize_flags();
     uint16_t current_flags = flags.value;
+    if (current_flags == m_captured_flags_value) return;
 
-    const struct {
-        const char* name;
-        uint16_t mask;
-    } flag_bits[] = {
-        {"CF", 0x0001},
-        {"PF", 0x0004},
-        {"AF", 0x0010},
-        {"ZF", 0x0040},
-        {"SF", 0x0080},
-        {"TF", 0x0100},
-        {"IF", 0x0200},
-        {"DF", 0x0400},
-        {"OF", 0x0800}
-    };
-
-    for (const auto& flag : flag_bits) {
-        bool old_val = (m_captured_flags_value & flag.mask) != 0;
-        bool new_val = (current_flags & flag.mask) != 0;
+    for (uint16_t mask : TRACED_FLAGS) {
+        bool old_val = (m_captured_flags_value & mask) != 0;
+        bool new_val = (current_flags & mask) != 0;
         if (old_val != new_val) {
-            mark_flag_change(flag.name, old_val, new_val);
+            mark_flag_change(mask, old_val, new_val);
         }
     }
 }
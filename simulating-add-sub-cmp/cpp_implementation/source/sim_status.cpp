@@ -0,0 +1,70 @@
+#include "sim_status.h"
+
+const char* status_name(SimStatus status) {
+    switch (status) {
+        case SimStatus::Ok: return "ok";
+        case SimStatus::CannotOpenFile: return "cannot_open_file";
+        case SimStatus::OutOfMemory: return "out_of_memory";
+        case SimStatus::EmptyCommand: return "empty_command";
+        case SimStatus::UnknownCommand: return "unknown_command";
+        case SimStatus::JumpNeedsProgram: return "jump_needs_program";
+        case SimStatus::MissingLabel: return "missing_label";
+        case SimStatus::WrongOperandCount: return "wrong_operand_count";
+        case SimStatus::TwoMemoryOperands: return "two_memory_operands";
+        case SimStatus::EmptyOperand: return "empty_operand";
+        case SimStatus::UnknownOperand: return "unknown_operand";
+        case SimStatus::UnknownDestination: return "unknown_destination";
+        case SimStatus::InvalidImmediate: return "invalid_immediate";
+        case SimStatus::ImmediateOutOfRange: return "immediate_out_of_range";
+        case SimStatus::MalformedMemoryOperand: return "malformed_memory_operand";
+        case SimStatus::InvalidSegmentOverride: return "invalid_segment_override";
+        case SimStatus::InvalidAddressRegister: return "invalid_address_register";
+        case SimStatus::InvalidAddressRegisters: return "invalid_address_registers";
+        case SimStatus::OperandSizeMismatch: return "operand_size_mismatch";
+        case SimStatus::AmbiguousOperandSize: return "ambiguous_operand_size";
+        case SimStatus::InvalidHexValue: return "invalid_hex_value";
+        case SimStatus::TooManyExpectations: return "too_many_expectations";
+        case SimStatus::UnknownLabel: return "unknown_label";
+        case SimStatus::PipelinedJump: return "pipelined_jump";
+        case SimStatus::JumpTargetOutsideProgram: return "jump_target_outside_program";
+        case SimStatus::StepLimit: return "step_limit";
+        case SimStatus::DecodeError: return "decode_error";
+        case SimStatus::InternalError: return "internal_error";
+    }
+    return "unknown";
+}
+
+std::string status_message(SimStatus status, Opcode opcode, std::string_view text) {
+    std::string detail(text);
+    switch (status) {
+        case SimStatus::Ok: return "OK";
+        case SimStatus::CannotOpenFile: return "Cannot open file: " + detail;
+        case SimStatus::OutOfMemory: return "Out of memory";
+        case SimStatus::EmptyCommand: return "Empty command";
+        case SimStatus::UnknownCommand: return "Unknown command: " + detail;
+        case SimStatus::JumpNeedsProgram: return std::string(opcode_name(opcode)) + " can only run inside a program";
+        case SimStatus::MissingLabel: return std::string(opcode_name(opcode)) + " requires a label";
+        case SimStatus::WrongOperandCount: return std::string(opcode_name(opcode)) + " requires 2 arguments";
+        case SimStatus::TwoMemoryOperands: return "Only one operand may be in memory";
+        case SimStatus::EmptyOperand: return "Empty operand";
+        case SimStatus::UnknownOperand: return "Unknown operand: " + detail;
+        case SimStatus::UnknownDestination: return "Unknown destination register: " + detail;
+        case SimStatus::InvalidImmediate: return "Invalid immediate: " + detail;
+        case SimStatus::ImmediateOutOfRange: return "Immediate out of range: " + detail;
+        case SimStatus::MalformedMemoryOperand: return "Malformed memory operand: " + detail;
+        case SimStatus::InvalidSegmentOverride: return "Invalid segment override: " + detail;
+        case SimStatus::InvalidAddressRegister: return "Invalid address register: " + detail;
+        case SimStatus::InvalidAddressRegisters: return "Invalid address registers: " + detail;
+        case SimStatus::OperandSizeMismatch: return "Operand size does not match register " + detail;
+        case SimStatus::AmbiguousOperandSize: return "Operand size is ambiguous, add byte or word: " + detail;
+        case SimStatus::InvalidHexValue: return "Invalid hex value: " + detail;
+        case SimStatus::TooManyExpectations: return "Too many expected changes: " + detail;
+        case SimStatus::UnknownLabel: return "Unknown label: " + detail;
+        case SimStatus::PipelinedJump: return "Jumps need the whole program; run without --pipeline";
+        case SimStatus::JumpTargetOutsideProgram: return "Jump target is outside the program";
+        case SimStatus::StepLimit: return "Step limit reached";
+        case SimStatus::DecodeError: return detail.empty() ? "Cannot decode instruction" : detail;
+        case SimStatus::InternalError: return "Internal simulator error while running " + detail;
+    }
+    return "Unknown status";
+}
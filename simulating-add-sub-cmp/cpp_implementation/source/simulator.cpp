@@ -1,318 +1,934 @@
 #include <algorithm>
-#include <fstream>
+#include <charconv>
 #include <iomanip>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include "commands.h"
-#include "logger.h"
+#include "decoder.h"
+#include "effective_address.h"
+#include "executor.h"
+#include "jit.h"
+#include "program_cache.h"
 #include "simulator.h"
+#include "spsc_ring.h"
+#include "trace.h"
 
-static std::vector<std::string> split(const std::string& s) {
-    std::istringstream iss(s);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (iss >> token) tokens.push_back(token);
-    return tokens;
+// A mnemonic and two operands, plus one slot so a surplus operand is still counted
+constexpr size_t MAX_LINE_TOKENS = 4;
+
+static bool is_space(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+static std::string_view trim(std::string_view str) {
+    while (!str.empty() && is_space(str.front())) str.remove_prefix(1);
+    while (!str.empty() && is_space(str.back())) str.remove_suffix(1);
+    return str;
+}
+
+static bool starts_with(std::string_view str, std::string_view prefix) {
+    return str.substr(0, prefix.size()) == prefix;
+}
+
+// Next whitespace-separated token at or after pos; empty once the text is exhausted.
+// A memory operand stays one token: spaces inside its brackets do not split it, and
+// a "byte"/"word" size in front of it is kept with it.
+static std::string_view next_token(std::string_view text, size_t& pos) {
+    while (pos < text.size() && is_space(text[pos])) pos++;
+    size_t start = pos;
+    int depth = 0;
+    while (pos < text.size() && (depth > 0 || !is_space(text[pos]))) {
+        if (text[pos] == '[') depth++;
+        if (text[pos] == ']') depth--;
+        pos++;
+    }
+    std::string_view token = text.substr(start, pos - start);
+    if (token == "byte" || token == "word") {
+        size_t operand_pos = pos;
+        if (!next_token(text, operand_pos).empty()) {
+            pos = operand_pos;
+            token = text.substr(start, pos - start);
+        }
+    }
+    return token;
+}
+
+// Stores up to max_tokens views and returns the total token count
+static size_t split_tokens(std::string_view text, std::string_view* tokens, size_t max_tokens) {
+    size_t count = 0;
+    size_t pos = 0;
+    for (std::string_view token = next_token(text, pos); !token.empty(); token = next_token(text, pos)) {
+        if (count < max_tokens) tokens[count] = token;
+        count++;
+    }
+    return count;
+}
+
+static bool parse_hex(std::string_view text, uint16_t& value) {
+    unsigned long parsed = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), parsed, 16);
+    if (ec != std::errc() || end == text.data()) return false;
+    value = static_cast<uint16_t>(parsed);
+    return true;
+}
+
+// Status of a line whose fault is `text`, a view into the line's command `line`
+static LineStatus line_status(SimStatus status, Opcode opcode, int line_number, std::string_view line,
+                              std::string_view text) {
+    LineStatus result;
+    result.status = status;
+    result.opcode = opcode;
+    result.line = line_number;
+    if (!text.empty() && text.data() >= line.data()) {
+        result.column = static_cast<uint16_t>(std::min<size_t>(text.data() - line.data(), UINT16_MAX));
+        result.length = static_cast<uint16_t>(std::min<size_t>(text.size(), UINT16_MAX));
+    }
+    return result;
+}
+
+// Counts a failed line, keeping the status of the first
+static void record_error(SimulationResult& result, const LineStatus& status) {
+    if (result.errors++ == 0) result.first_error = status;
+}
+
+// Marks a line as failing to compile, with the message the trace reports for it
+static void fail_line(ProgramLine& info, const LineStatus& status, std::string_view text) {
+    info.status = status;
+    info.error = status_message(status.status, status.opcode, text);
 }
 
 Simulator::Simulator() : m_regs() {}
 
-void Simulator::run_simulation(const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file) {
-        LOGGER.Error("Cannot open file: {}", filepath);
-        throw std::runtime_error("Cannot open file: " + filepath);
+void Simulator::reset() {
+    bool lazy_flags = m_regs.lazy_flags_enabled();
+    AluKernel alu_kernel = m_regs.alu_kernel();
+    m_regs = Registers();
+    m_regs.set_lazy_flags(lazy_flags);
+    m_regs.set_alu_kernel(alu_kernel);
+    m_memory.clear();
+    m_output.clear();
+}
+
+SimulationResult Simulator::run_simulation(const std::string& filepath) {
+    SimulationResult result;
+    SimStatus status = try_run_simulation(filepath, result);
+    if (status != SimStatus::Ok) {
+        throw std::runtime_error(status_message(status, Opcode::Invalid, filepath));
     }
+    return result;
+}
 
-    LOGGER.Info("Starting simulation from file: {}", filepath);
+SimStatus Simulator::try_run_simulation(const std::string& filepath, SimulationResult& result) noexcept {
+    Program program;
+    SimStatus status = try_load_program(filepath, program);
+    if (status != SimStatus::Ok) return status;
+    try {
+        result = run_program(program);
+        return SimStatus::Ok;
+    } catch (const std::bad_alloc&) {
+        return SimStatus::OutOfMemory;
+    } catch (const std::exception&) {
+        return SimStatus::InternalError;
+    }
+}
 
-    std::string line;
-    int line_num = 0;
-    std::vector<std::string> final_section;
-    bool in_final_section = false;
+// The one place a listing can fail as a whole; any other exception on the
+// exception-free path is out of memory or a fault in the simulator itself
+std::shared_ptr<const MappedFile> Simulator::open_file(const std::string& filepath) noexcept {
+    try {
+        return std::make_shared<const MappedFile>(filepath);
+    } catch (const std::exception&) {
+        m_output.error("Cannot open file: {}", filepath);
+        return nullptr;
+    }
+}
 
-    while (std::getline(file, line)) {
+std::shared_ptr<const MappedFile> Simulator::map_file(const std::string& filepath) {
+    std::shared_ptr<const MappedFile> file = open_file(filepath);
+    if (!file) throw std::runtime_error(status_message(SimStatus::CannotOpenFile, Opcode::Invalid, filepath));
+    return file;
+}
+
+// Points each jump at the instruction its label names
+static void resolve_labels(Program& program, const std::unordered_map<std::string_view, uint32_t>& labels) {
+    for (size_t i = 0; i < program.instructions.size(); ++i) {
+        if (!is_jump(program.instructions[i].opcode)) continue;
+
+        ProgramLine& info = program.lines[i];
+        size_t pos = 0;
+        next_token(info.display, pos);
+        std::string_view label = next_token(info.display, pos);
+
+        auto found = labels.find(label);
+        if (found != labels.end()) {
+            info.jump_target = found->second;
+        } else {
+            Opcode opcode = program.instructions[i].opcode;
+            fail_line(info, line_status(SimStatus::UnknownLabel, opcode, info.line_number, info.display, label), label);
+            program.instructions[i].opcode = Opcode::Invalid;
+        }
+    }
+}
+
+// Walks a listing's lines up to its "Final" marker. on_label gets each "name:" with
+// the index of the next instruction, on_line each command (expectation comment
+// included) and its line number. Returns the offset of the "Final" line, or the
+// text size when there is none; line_num ends at the "Final" line.
+template <typename OnLabel, typename OnLine>
+static size_t scan_listing(std::string_view text, int& line_num, OnLabel&& on_label, OnLine&& on_line) {
+    size_t pos = 0;
+    uint32_t instruction_count = 0;
+    line_num = 0;
+
+    while (pos < text.size()) {
+        size_t line_start = pos;
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
         line_num++;
 
-        if (line.find("Final") == 0) {
-            LOGGER.Debug("Found 'Final' marker at line {}", line_num);
-            in_final_section = true;
-            final_section.push_back(line);
-            continue;
+        if (starts_with(line, "Final")) return line_start;
+        if (line.empty() || line[0] == '-' || is_space(line[0])) continue;
+
+        // "name:" labels the next instruction, which may follow on the same line
+        size_t label_pos = 0;
+        std::string_view first = next_token(line, label_pos);
+        if (first.size() > 1 && first.back() == ':') {
+            on_label(first.substr(0, first.size() - 1), instruction_count);
+            line = trim(line.substr(label_pos));
+            if (line.empty() || line[0] == ';') continue;
         }
 
-        if (in_final_section) {
-            final_section.push_back(line);
-            continue;
+        on_line(line, line_num);
+        instruction_count++;
+    }
+    return text.size();
+}
+
+// The "Final registers" section from its marker on, one view per line
+static std::vector<std::string_view> split_final_section(std::string_view text, size_t pos) {
+    std::vector<std::string_view> lines;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+Program Simulator::load_program(const std::string& filepath) {
+    Program program;
+    SimStatus status = try_load_program(filepath, program);
+    if (status != SimStatus::Ok) {
+        throw std::runtime_error(status_message(status, Opcode::Invalid, filepath));
+    }
+    return program;
+}
+
+SimStatus Simulator::try_load_program(const std::string& filepath, Program& program) noexcept {
+    try {
+        std::shared_ptr<const MappedFile> source = open_file(filepath);
+        if (!source) return SimStatus::CannotOpenFile;
+
+        program = Program();
+        program.source = std::move(source);
+        m_output.info("Starting simulation from file: {}", filepath);
+        compile_listing(program, program.source->view());
+        return SimStatus::Ok;
+    } catch (const std::bad_alloc&) {
+        return SimStatus::OutOfMemory;
+    } catch (const std::exception&) {
+        return SimStatus::InternalError;
+    }
+}
+
+Program Simulator::load_text(std::string text) {
+    m_output.info("Starting simulation from inline listing of {} bytes", text.size());
+
+    Program program;
+    std::string_view listing = program.keep(std::move(text));
+    compile_listing(program, listing);
+    return program;
+}
+
+void Simulator::compile_listing(Program& program, std::string_view text) {
+    uint64_t hash = 0;
+    if (m_program_cache) {
+        hash = content_hash(text);
+        if (m_program_cache->load(program, text, hash)) {
+            m_output.debug("Loaded {} instructions from {}", program.instructions.size(),
+                           m_program_cache->entry_path(hash));
+            program.threaded = thread_instructions(program.instructions);
+            if (m_jit) program.jit = jit_compile(program);
+            return;
+        }
+    }
+
+    // One cheap pass over the mapping sizes the arrays, so the parse loop never regrows them
+    size_t line_estimate = static_cast<size_t>(std::count(text.begin(), text.end(), '\n')) + 1;
+    program.instructions.reserve(line_estimate);
+    program.lines.reserve(line_estimate);
+
+    int line_num = 0;
+    std::unordered_map<std::string_view, uint32_t> labels;   // Name -> index of the next instruction
+    size_t final_pos = scan_listing(
+        text, line_num, [&](std::string_view label, uint32_t next) { labels[label] = next; },
+        [&](std::string_view line, int number) {
+            ProgramLine& info = program.lines.emplace_back();
+            program.instructions.push_back(compile_line(line, number, info, m_profiler));
+        });
+
+    if (final_pos < text.size()) {
+        m_output.debug("Found 'Final' marker at line {}", line_num);
+        program.final_section = split_final_section(text, final_pos);
+    }
+
+    resolve_labels(program, labels);
+    if (m_program_cache && !m_program_cache->store(program, text, hash)) {
+        m_output.warn("Cannot write program cache entry {}", m_program_cache->entry_path(hash));
+    }
+    program.threaded = thread_instructions(program.instructions);
+    if (m_jit) program.jit = jit_compile(program);
+}
+
+Program Simulator::load_binary(const std::string& filepath) {
+    std::shared_ptr<const MappedFile> file = map_file(filepath);
+
+    m_output.info("Starting simulation from binary: {}", filepath);
+
+    Program program = decode_program(file->bytes(), file->size());
+    if (m_jit) program.jit = jit_compile(program);
+    return program;
+}
+
+Instruction Simulator::compile_line(std::string_view line, int line_num, ProgramLine& info, Profiler* profiler) {
+    info.line_number = line_num;
+    info.has_expected = false;
+
+    size_t comment_pos = line.find(';');
+    std::string_view display = (comment_pos != std::string_view::npos) ? line.substr(0, comment_pos) : line;
+    while (!display.empty() && is_space(display.back())) {
+        display.remove_suffix(1);
+    }
+    info.display = display;
+
+    Instruction invalid{};
+    invalid.opcode = Opcode::Invalid;
+
+    CommandLine cmd_line;
+    std::string_view fault;
+    SimStatus status;
+    {
+        ProfileScope scope(profiler, ProfileStage::Parse);
+        status = parse_command_line(line, cmd_line, fault);
+    }
+    if (status != SimStatus::Ok) {
+        fail_line(info, line_status(status, Opcode::Invalid, line_num, line, fault), fault);
+        return invalid;
+    }
+    info.expected = cmd_line.expected;
+    info.has_expected = cmd_line.has_expected;
+
+    std::string_view tokens[MAX_LINE_TOKENS];
+    size_t token_count;
+    {
+        ProfileScope scope(profiler, ProfileStage::Tokenize);
+        token_count = split_tokens(cmd_line.command, tokens, MAX_LINE_TOKENS);
+    }
+    if (token_count == 0) {
+        fail_line(info, line_status(SimStatus::EmptyCommand, Opcode::Invalid, line_num, line, {}), {});
+        return invalid;
+    }
+
+    const CommandEntry* entry;
+    {
+        ProfileScope scope(profiler, ProfileStage::Lookup);
+        entry = find_command(tokens[0]);
+    }
+    if (!entry) {
+        fail_line(info, line_status(SimStatus::UnknownCommand, Opcode::Invalid, line_num, line, tokens[0]), tokens[0]);
+        return invalid;
+    }
+
+    // The label is resolved once the whole listing is read
+    if (is_jump(entry->opcode)) {
+        if (token_count != 2) {
+            fail_line(info, line_status(SimStatus::MissingLabel, entry->opcode, line_num, line, tokens[0]), tokens[0]);
+            return invalid;
+        }
+        Instruction jump{};
+        jump.opcode = entry->opcode;
+        jump.width = OperandWidth::Byte;
+        jump.ea = EffectiveAddress::None;
+        jump.dest = RegisterId::None;
+        jump.src = RegisterId::None;
+        jump.segment = RegisterId::None;
+        return jump;
+    }
+
+    ProfileScope scope(profiler, ProfileStage::Compile);
+    Instruction instr;
+    status = try_compile_command(entry->opcode, tokens + 1, token_count - 1, instr, fault);
+    if (status != SimStatus::Ok) {
+        fail_line(info, line_status(status, entry->opcode, line_num, line, fault), fault);
+        return invalid;
+    }
+    return instr;
+}
+
+template <typename Policy>
+SimulationResult Simulator::run_program(const Program& program) {
+    SimulationResult result;
+    uint32_t step = 0;
+
+    uint64_t attempted = 0;  // Unlike step, also counts lines that failed
+    m_regs.ip.value = 0;     // Every run starts at the first instruction
+    if constexpr (Policy::COUNT_CYCLES) {
+        m_cycles.reset();
+    }
+
+    m_blocks.reset(program);
+    for (uint32_t block = m_blocks.entry(); block != NO_BLOCK;) {
+        if (m_max_steps != 0 && attempted >= m_max_steps) {
+            m_output.error("Stopped after {} instructions; the program may not terminate", attempted);
+            LineStatus status;
+            status.status = SimStatus::StepLimit;
+            status.line = program.lines[m_blocks[block].start].line_number;
+            record_error(result, status);
+            break;
+        }
+        attempted += m_blocks[block].end - m_blocks[block].start;
+        m_blocks.count_execution(block);
+        bool taken = run_block<Policy>(program, m_blocks[block], result, step);
+        block = m_blocks.successor(block, taken);
+    }
+
+    if constexpr (Policy::LOG_STEPS) {
+        for (const BasicBlock& block : m_blocks.blocks()) {
+            m_output.debug("Block at line {} ({} instructions): {} executions",
+                           program.lines[block.start].line_number, block.end - block.start, block.executions);
+        }
+    }
+
+    finish_run<Policy>(program.final_section, result);
+    return result;
+}
+
+// Clock total and final-state comparison, once a run has executed its last instruction
+template <typename Policy>
+void Simulator::finish_run(const std::vector<std::string_view>& final_section, SimulationResult& result) {
+    if constexpr (Policy::COUNT_CYCLES) {
+        result.cycles = m_cycles.total();
+        if (m_cycles.enabled()) {
+            m_output.info("Total clocks: {}", result.cycles);
+        }
+    }
+
+    if constexpr (Policy::VALIDATE) {
+        m_output.info("");
+        if (!final_section.empty()) {
+            m_output.info("Final state comparison:");
+            result.final_checked = true;
+            result.final_match = compare_final_state(final_section);
         }
+    } else {
+        m_regs.materialize_flags();
+    }
+}
+
+namespace {
+
+// One compiled line on its way from the parser thread to the executor
+struct PipelineLine {
+    Instruction instruction;
+    ProgramLine info;
+};
+
+// Lines in flight between the parser and the executor, and how many the
+// executor takes per batch
+constexpr size_t PIPELINE_RING_LINES = 4096;
+constexpr size_t PIPELINE_BATCH_LINES = 256;
+
+}  // namespace
 
-        if (line.empty() || line[0] == '-' || std::isspace(line[0])) continue;
+template <typename Policy>
+SimulationResult Simulator::run_pipelined(const std::string& filepath) {
+    std::shared_ptr<const MappedFile> source = map_file(filepath);
+    std::string_view text = source->view();
 
-        LOGGER.Debug("Processing line {}: {}", line_num, line);
+    m_output.info("Starting pipelined simulation from file: {}", filepath);
 
+    SpscRing<PipelineLine> ring(PIPELINE_RING_LINES);
+    std::atomic<bool> abandoned{false};   // Set if the executor stops early, so the parser cannot block
+    std::exception_ptr parse_error;
+    size_t final_pos = text.size();
+    int final_line = 0;
+
+    // Profiles are per thread; the parser's joins the simulator's once it is done
+    std::unique_ptr<Profiler> parse_profile = m_profiler ? std::make_unique<Profiler>() : nullptr;
+
+    std::thread parser([&] {
         try {
-            CommandLine cmd_line = parse_command_line(line);
+            final_pos = scan_listing(
+                text, final_line, [](std::string_view, uint32_t) {},
+                [&](std::string_view line, int number) {
+                    PipelineLine item{};
+                    item.instruction = compile_line(line, number, item.info, parse_profile.get());
+                    // Lines are executed as they arrive, so a label further down cannot be resolved
+                    if (is_jump(item.instruction.opcode)) {
+                        fail_line(item.info,
+                                  line_status(SimStatus::PipelinedJump, item.instruction.opcode, number, line, {}), {});
+                        item.instruction.opcode = Opcode::Invalid;
+                    }
+                    while (!ring.try_push(item)) {
+                        if (abandoned.load(std::memory_order_relaxed)) throw std::runtime_error("Executor stopped");
+                        std::this_thread::yield();
+                    }
+                });
+        } catch (...) {
+            if (!abandoned.load(std::memory_order_relaxed)) parse_error = std::current_exception();
+        }
+        ring.close();
+    });
+
+    SimulationResult result;
+    uint32_t step = 0;
+    m_regs.ip.value = 0;
+    if constexpr (Policy::COUNT_CYCLES) {
+        m_cycles.reset();
+    }
 
-            m_regs.capture_flags();
-            std::string result = run_command(cmd_line.command);
-            m_regs.check_flag_changes();
-
-            ChangeSet changes = m_regs.get_last_changes();
-            std::ostringstream change_str;
-            if (changes.has_changes()) {
-                for (const auto& reg_change : changes.register_changes) {
-                    change_str << reg_change.name << ":0x" << std::hex << reg_change.old_value
-                              << "->0x" << reg_change.new_value << " ";
-                }
-                for (const auto& flag_change : changes.flags_changes) {
-                    change_str << flag_change.flag_name << ":"
-                              << (flag_change.old_value ? "1" : "0") << "->"
-                              << (flag_change.new_value ? "1" : "0") << " ";
-                }
+    // Each popped batch runs as one straight-line block of a scratch program
+    Program batch;
+    batch.instructions.reserve(PIPELINE_BATCH_LINES);
+    batch.lines.reserve(PIPELINE_BATCH_LINES);
+    try {
+        while (true) {
+            batch.instructions.clear();
+            batch.lines.clear();
+            size_t count = ring.pop_batch(PIPELINE_BATCH_LINES, [&](PipelineLine& item) {
+                batch.instructions.push_back(item.instruction);
+                batch.lines.push_back(std::move(item.info));
+            });
+            if (count == 0) {
+                if (ring.drained()) break;
+                std::this_thread::yield();
+                continue;
             }
+            BasicBlock block{0, static_cast<uint32_t>(count), NO_BLOCK, NO_BLOCK, 1};
+            run_block<Policy>(batch, block, result, step);
+        }
+    } catch (...) {
+        abandoned.store(true, std::memory_order_relaxed);
+        parser.join();
+        throw;
+    }
+    parser.join();
+    if (parse_error) std::rethrow_exception(parse_error);
+
+    if (m_profiler) m_profiler->merge(*parse_profile);
+    if (final_pos < text.size()) {
+        m_output.debug("Found 'Final' marker at line {}", final_line);
+    }
+    finish_run<Policy>(split_final_section(text, final_pos), result);
+    return result;
+}
 
-            size_t comment_pos = line.find(';');
-            std::string display_line = (comment_pos != std::string::npos) ? line.substr(0, comment_pos) : line;
-            while (!display_line.empty() && std::isspace(display_line.back())) {
-                display_line.pop_back();
+template <typename Policy>
+bool Simulator::run_block(const Program& program, const BasicBlock& block, SimulationResult& result, uint32_t& step) {
+    bool taken = false;
+    // Constant null unless the policy profiles, so the scopes below compile away
+    Profiler* profiler = Policy::PROFILE_STAGES ? m_profiler : nullptr;
+
+    for (uint32_t i = block.start; i < block.end; ++i) {
+        // With nothing to do between steps, the block runs as native code, then as
+        // threaded code up to its closing jump or anything else left to this loop
+        if constexpr (!Policy::TRACK_CHANGES && !Policy::LOG_STEPS && !Policy::VALIDATE) {
+            if (program.jit) {
+                while (i < block.end) {
+                    const JitEntry* entry = program.jit->entry(i);
+                    if (!entry) break;
+                    if (m_regs.lazy_flags_enabled()) m_regs.materialize_flags();
+                    entry->function(&m_regs);
+                    result.instructions += entry->end - i;
+                    step += entry->end - i;
+                    i = entry->end;
+                }
+                if (i >= block.end) break;
             }
+            if (program.is_threaded()) {
+                auto stop = static_cast<uint32_t>(run_threaded(m_regs, program.threaded.data(), i));
+                result.instructions += stop - i;
+                step += stop - i;
+                i = stop;
+                if (i >= block.end) break;
+            }
+        }
+
+        const Instruction& instr = program.instructions[i];
+        const ProgramLine& info = program.lines[i];
 
-            if (change_str.str().empty()) {
-                LOGGER.Info("{}", display_line);
+        if constexpr (Policy::LOG_STEPS) {
+            m_output.debug("Processing line {}: {}", info.line_number, info.display);
+        }
+
+        if (instr.opcode == Opcode::Invalid) {
+            m_output.error("Error processing line {}: {}", info.line_number, info.error);
+            record_error(result, info.status);
+            continue;
+        }
+
+        if constexpr (Policy::TRACK_CHANGES) {
+            m_regs.capture_flags();
+        }
+        // The odd-address penalty depends on the address before the step changes any register
+        uint32_t address = 0;
+        if constexpr (Policy::COUNT_CYCLES) {
+            if (m_cycles.enabled() && instr.ea != EffectiveAddress::None && !is_jump(instr.opcode)) {
+                address = effective_address(m_regs, instr);
+            }
+        }
+        bool outside = false;
+        {
+            ProfileScope scope(profiler, ProfileStage::Execute, instr.opcode);
+            if (is_jump(instr.opcode)) {
+                taken = execute_branch<Policy>(m_regs, instr);
+                outside = taken && info.jump_target == INVALID_JUMP_TARGET;
             } else {
-                LOGGER.Info("{} ; {}", display_line, change_str.str());
+                execute_instruction<Policy>(m_regs, m_memory, instr);
+            }
+            if (!outside) advance_ip<Policy>(m_regs, instr, taken);
+        }
+        if (outside) {
+            LineStatus status = line_status(SimStatus::JumpTargetOutsideProgram, instr.opcode, info.line_number,
+                                            info.display, {});
+            m_output.error("Error processing line {}: {}",
+                           info.line_number, status_message(status.status, status.opcode, {}));
+            record_error(result, status);
+            continue;
+        }
+        CycleCost cost;
+        if constexpr (Policy::COUNT_CYCLES) {
+            cost = m_cycles.charge(instr, address, taken);
+        }
+        if constexpr (Policy::TRACK_CHANGES) {
+            {
+                ProfileScope scope(profiler, ProfileStage::FlagDiff);
+                m_regs.check_flag_changes();
+            }
+            ProfileScope scope(profiler, ProfileStage::Trace);
+            if (m_trace) {
+                m_trace->record_step(step, m_regs.get_last_changes());
+            } else if constexpr (Policy::LOG_STEPS) {
+                trace_step(info, cost);
             }
+        }
+        step++;
+        result.instructions++;
 
-            if (cmd_line.has_expected) {
-                compare_with_expected(cmd_line.expected);
+        if constexpr (Policy::VALIDATE) {
+            if (info.has_expected) {
+                ProfileScope scope(profiler, ProfileStage::Validate);
+                result.mismatches += compare_with_expected(info.expected);
             }
-        } catch (const std::exception& e) {
-            LOGGER.Error("Error processing line {}: {}", line_num, e.what());
         }
     }
+    return taken;
+}
+
+template SimulationResult Simulator::run_program<TracePolicy>(const Program& program);
+template SimulationResult Simulator::run_program<ValidatePolicy>(const Program& program);
+template SimulationResult Simulator::run_program<BenchPolicy>(const Program& program);
+template SimulationResult Simulator::run_pipelined<TracePolicy>(const std::string& filepath);
+template SimulationResult Simulator::run_pipelined<ValidatePolicy>(const std::string& filepath);
+template SimulationResult Simulator::run_pipelined<BenchPolicy>(const std::string& filepath);
 
-    LOGGER.Info("");
-    if (!final_section.empty()) {
-        LOGGER.Info("Final state comparison:");
-        compare_final_state(final_section);
+Timeline Simulator::timeline(const Program& program, uint32_t checkpoint_interval) {
+    m_regs.ip.value = 0;
+    return Timeline(m_regs, m_memory, program, checkpoint_interval);
+}
+
+void Simulator::trace_step(const ProgramLine& info, const CycleCost& cost) {
+    std::string changes = format_changes(m_regs.get_last_changes());
+    if (m_cycles.enabled()) {
+        std::string clocks = format_cycles(cost, m_cycles.total());
+        if (changes.empty()) {
+            m_output.info("{} ; {}", info.display, clocks);
+        } else {
+            m_output.info("{} ; {} | {}", info.display, clocks, changes);
+        }
+    } else if (changes.empty()) {
+        m_output.info("{}", info.display);
+    } else {
+        m_output.info("{} ; {}", info.display, changes);
     }
 }
 
 std::string Simulator::run_command(const std::string& line) {
-    auto tokens = split(line);
+    std::string_view tokens[MAX_LINE_TOKENS];
+    size_t token_count;
+    {
+        ProfileScope scope(m_profiler, ProfileStage::Tokenize);
+        token_count = split_tokens(line, tokens, MAX_LINE_TOKENS);
+    }
 
-    if (tokens.empty()) {
-        LOGGER.Warn("Empty command line received");
+    if (token_count == 0) {
+        m_output.warn("Empty command line received");
         throw std::runtime_error("Empty command");
     }
 
-    const std::string& cmd = tokens[0];
-    uint32_t cmd_hash = hash_command(cmd.c_str());
+    std::string_view cmd = tokens[0];
+    m_output.debug("Looking up command: {} (hash: {})", cmd, hash_command(cmd));
 
-    LOGGER.Debug("Looking up command: {} (hash: {})", cmd, cmd_hash);
+    const CommandEntry* entry;
+    {
+        ProfileScope scope(m_profiler, ProfileStage::Lookup);
+        entry = find_command(cmd);
+    }
+    if (!entry) {
+        m_output.error("Unknown command: {}", cmd);
+        throw std::runtime_error("Unknown command: " + std::string(cmd));
+    }
 
-    for (size_t i = 0; i < COMMANDS_TABLE_SIZE; ++i) {
-        if (commands_table[i].hash == cmd_hash) {
-            // Pass Registers and arguments excluding command itself
-            std::vector<std::string> args(tokens.begin() + 1, tokens.end());
-            LOGGER.Debug("Executing command '{}' with {} arguments", cmd, args.size());
-            return commands_table[i].handler(m_regs, args);
-        }
+    // Changes left over from a previous command would otherwise pile up; afterwards
+    // get_registers().get_last_changes() reports just this one
+    m_regs.discard_changes();
+
+    // Compiled straight from the token views, same as a listing line
+    m_output.debug("Executing command '{}' with {} arguments", cmd, token_count - 1);
+    Instruction instr;
+    {
+        ProfileScope scope(m_profiler, ProfileStage::Compile);
+        instr = compile_command(entry->opcode, tokens + 1, token_count - 1);
+    }
+    {
+        ProfileScope scope(m_profiler, ProfileStage::Execute, instr.opcode);
+        execute_instruction(m_regs, m_memory, instr);
     }
+    if (instr.dest_kind == OperandKind::Memory) {
+        m_output.debug("{}", format_instruction(instr));
+    } else {
+        m_output.debug("{} -> {} = {}", format_instruction(instr), register_name(instr.dest), m_regs.read(instr.dest));
+    }
+    return "OK";
+}
 
-    LOGGER.Error("Unknown command: {}", cmd);
-    throw std::runtime_error("Unknown command: " + cmd);
+// Listing expectations behave like sets: a repeated flag or register keeps one entry.
+// These return false when an expectation no longer fits.
+static bool add_unknown_flag(ExpectedState& expected, char flag) {
+    for (char existing : expected.unknown_flags) {
+        if (existing == flag) return true;
+    }
+    if (expected.unknown_flags.full()) return false;
+    expected.unknown_flags.push_back(flag);
+    return true;
 }
 
-CommandLine Simulator::parse_command_line(const std::string& line) {
-    CommandLine result;
+static bool expect_flag(ExpectedState& expected, char flag, bool set) {
+    uint16_t bit = flag_letter_bit(flag);
+    if (bit == 0) return add_unknown_flag(expected, flag);
+    expected.flags_mask |= bit;
+    expected.flags_value = static_cast<uint16_t>(set ? expected.flags_value | bit : expected.flags_value & ~bit);
+    return true;
+}
+
+static bool set_expected_register(ExpectedState& expected, std::string_view name, uint16_t value) {
+    RegisterId id = register_id_from_name(name);
+    if (id == RegisterId::None) {
+        for (std::string_view existing : expected.unknown_registers) {
+            if (existing == name) return true;
+        }
+        if (expected.unknown_registers.full()) return false;
+        expected.unknown_registers.push_back(name);
+        return true;
+    }
+    for (size_t i = 0; i < expected.registers.size(); ++i) {
+        if (expected.registers.items[i].id == id) {
+            expected.registers.items[i].value = value;
+            return true;
+        }
+    }
+    if (expected.registers.full()) return false;
+    expected.registers.push_back({id, value});
+    return true;
+}
+
+SimStatus Simulator::parse_command_line(std::string_view line, CommandLine& result, std::string_view& fault) {
     result.has_expected = false;
 
     // Find semicolon separator
     size_t semicolon_pos = line.find(';');
-    if (semicolon_pos == std::string::npos) {
+    if (semicolon_pos == std::string_view::npos) {
         // No expected output, just command
         result.command = line;
-        return result;
+        return SimStatus::Ok;
     }
 
     // Extract command (before semicolon)
     result.command = line.substr(0, semicolon_pos);
 
     // Extract expected changes (after semicolon)
-    std::string expected_str = line.substr(semicolon_pos + 1);
+    std::string_view expected_str = line.substr(semicolon_pos + 1);
     result.has_expected = true;
 
     // Parse expected changes
     // Format: "reg:0xOLD->0xNEW" or "flags:OLD->NEW"
-    std::istringstream iss(expected_str);
-    std::string token;
-
-    while (iss >> token) {
+    size_t pos = 0;
+    for (std::string_view token = next_token(expected_str, pos); !token.empty();
+         token = next_token(expected_str, pos)) {
         size_t colon_pos = token.find(':');
-        if (colon_pos == std::string::npos) continue;
+        if (colon_pos == std::string_view::npos) continue;
 
-        std::string name = token.substr(0, colon_pos);
-        std::string change = token.substr(colon_pos + 1);
+        std::string_view name = token.substr(0, colon_pos);
+        std::string_view change = token.substr(colon_pos + 1);
+
+        size_t arrow_pos = change.find("->");
+        if (arrow_pos == std::string_view::npos) continue;
 
         if (name == "flags") {
             // Parse flag changes: "->S" (set) or "S->" (clear) or "S->Z" (both)
-            size_t arrow_pos = change.find("->");
-            if (arrow_pos != std::string::npos) {
-                std::string old_flags = change.substr(0, arrow_pos);
-                std::string new_flags = change.substr(arrow_pos + 2);
-
-                // Flags cleared (in old but not in new)
-                for (char flag : old_flags) {
-                    if (new_flags.find(flag) == std::string::npos) {
-                        result.expected.flags_cleared.insert(std::string(1, flag));
-                    }
+            std::string_view old_flags = change.substr(0, arrow_pos);
+            std::string_view new_flags = change.substr(arrow_pos + 2);
+
+            // Flags cleared (in old but not in new)
+            for (char flag : old_flags) {
+                if (new_flags.find(flag) == std::string_view::npos && !expect_flag(result.expected, flag, false)) {
+                    fault = token;
+                    return SimStatus::TooManyExpectations;
                 }
+            }
 
-                // Flags set (in new but not in old)
-                for (char flag : new_flags) {
-                    if (old_flags.find(flag) == std::string::npos) {
-                        result.expected.flags_set.insert(std::string(1, flag));
-                    }
+            // Flags set (in new but not in old)
+            for (char flag : new_flags) {
+                if (old_flags.find(flag) == std::string_view::npos && !expect_flag(result.expected, flag, true)) {
+                    fault = token;
+                    return SimStatus::TooManyExpectations;
                 }
             }
         } else {
             // Parse register change: "0xOLD->0xNEW"
-            size_t arrow_pos = change.find("->");
-            if (arrow_pos != std::string::npos) {
-                std::string new_val_str = change.substr(arrow_pos + 2);
-                // Remove "0x" prefix if present
-                if (new_val_str.substr(0, 2) == "0x") {
-                    new_val_str = new_val_str.substr(2);
-                }
-                // Parse hex value
-                uint16_t new_val = static_cast<uint16_t>(std::stoul(new_val_str, nullptr, 16));
-                result.expected.register_changes[name] = new_val;
+            std::string_view new_val_str = change.substr(arrow_pos + 2);
+            // Remove "0x" prefix if present
+            if (starts_with(new_val_str, "0x")) {
+                new_val_str.remove_prefix(2);
+            }
+            uint16_t value = 0;
+            if (!parse_hex(new_val_str, value)) {
+                fault = new_val_str;
+                return SimStatus::InvalidHexValue;
+            }
+            if (!set_expected_register(result.expected, name, value)) {
+                fault = token;
+                return SimStatus::TooManyExpectations;
             }
         }
     }
 
-    return result;
-}
-
-static std::string trim(const std::string& str) {
-    size_t start = 0;
-    while (start < str.size() && std::isspace(str[start])) start++;
-    size_t end = str.size();
-    while (end > start && std::isspace(str[end - 1])) end--;
-    return str.substr(start, end - start);
+    return SimStatus::Ok;
 }
 
-void Simulator::compare_with_expected(const ExpectedState& expected) {
-    bool all_match = true;
-
-    for (const auto& [reg_name, expected_value] : expected.register_changes) {
-        uint16_t actual_value;
-        if (m_regs.is8(reg_name)) {
-            actual_value = m_regs.get8(reg_name);
-        } else if (m_regs.is16(reg_name)) {
-            actual_value = m_regs.get16(reg_name);
-        } else {
-            LOGGER.Error("Unknown register in expected output: {}", reg_name);
-            all_match = false;
-            continue;
-        }
+size_t Simulator::compare_with_expected(const ExpectedState& expected) {
+    size_t mismatches = 0;
 
-        if (actual_value != expected_value) {
-            LOGGER.Error("MISMATCH: {} expected 0x{:x}, got 0x{:x}",
-                        reg_name, expected_value, actual_value);
-            all_match = false;
+    for (const ExpectedRegister& reg : expected.registers) {
+        uint16_t actual_value = m_regs.read(reg.id);
+        if (actual_value != reg.value) {
+            m_output.error("MISMATCH: {} expected 0x{:x}, got 0x{:x}", register_name(reg.id), reg.value, actual_value);
+            mismatches++;
         }
     }
 
-    for (const auto& flag_name : expected.flags_set) {
-        bool flag_value = false;
-        if (flag_name == "C") flag_value = m_regs.flags.CF;
-        else if (flag_name == "P") flag_value = m_regs.flags.PF;
-        else if (flag_name == "A") flag_value = m_regs.flags.AF;
-        else if (flag_name == "Z") flag_value = m_regs.flags.ZF;
-        else if (flag_name == "S") flag_value = m_regs.flags.SF;
-        else if (flag_name == "O") flag_value = m_regs.flags.OF;
-        else if (flag_name == "D") flag_value = m_regs.flags.DF;
-        else if (flag_name == "I") flag_value = m_regs.flags.IF;
-        else {
-            LOGGER.Error("Unknown flag in expected output: {}", flag_name);
-            all_match = false;
-            continue;
-        }
-
-        if (!flag_value) {
-            LOGGER.Error("MISMATCH: Flag {} expected to be set but is clear", flag_name);
-            all_match = false;
+    if (expected.flags_mask) {
+        uint16_t wrong = (m_regs.resolved_flags().value ^ expected.flags_value) & expected.flags_mask;
+        for (size_t i = 0; wrong && i < sizeof(FLAG_LETTERS); ++i) {
+            if (!(wrong & FLAG_LETTER_BITS[i])) continue;
+            if (expected.flags_value & FLAG_LETTER_BITS[i]) {
+                m_output.error("MISMATCH: Flag {} expected to be set but is clear", FLAG_LETTERS[i]);
+            } else {
+                m_output.error("MISMATCH: Flag {} expected to be clear but is set", FLAG_LETTERS[i]);
+            }
+            mismatches++;
         }
     }
 
-    for (const auto& flag_name : expected.flags_cleared) {
-        bool flag_value = false;
-        if (flag_name == "C") flag_value = m_regs.flags.CF;
-        else if (flag_name == "P") flag_value = m_regs.flags.PF;
-        else if (flag_name == "A") flag_value = m_regs.flags.AF;
-        else if (flag_name == "Z") flag_value = m_regs.flags.ZF;
-        else if (flag_name == "S") flag_value = m_regs.flags.SF;
-        else if (flag_name == "O") flag_value = m_regs.flags.OF;
-        else if (flag_name == "D") flag_value = m_regs.flags.DF;
-        else if (flag_name == "I") flag_value = m_regs.flags.IF;
-        else {
-            LOGGER.Error("Unknown flag in expected output: {}", flag_name);
-            all_match = false;
-            continue;
-        }
-
-        if (flag_value) {
-            LOGGER.Error("MISMATCH: Flag {} expected to be clear but is set", flag_name);
-            all_match = false;
-        }
+    for (std::string_view name : expected.unknown_registers) {
+        m_output.error("Unknown register in expected output: {}", name);
+        mismatches++;
+    }
+    for (char flag_name : expected.unknown_flags) {
+        m_output.error("Unknown flag in expected output: {}", flag_name);
+        mismatches++;
     }
 
-    if (all_match && (expected.register_changes.size() > 0 || expected.flags_set.size() > 0 || expected.flags_cleared.size() > 0)) {
-        LOGGER.Debug("All expected changes match!");
+    if (mismatches == 0 && (!expected.registers.empty() || expected.flags_mask)) {
+        m_output.debug("All expected changes match!");
     }
+    return mismatches;
 }
 
-void Simulator::compare_final_state(const std::vector<std::string>& final_section) {
-    std::unordered_map<std::string, uint16_t> expected_regs;
-    std::string expected_flags;
+bool Simulator::compare_final_state(const std::vector<std::string_view>& final_section) {
+    struct FinalRegister {
+        std::string_view name;
+        uint16_t value;
+    };
+    std::vector<FinalRegister> expected_regs;
+    std::string_view expected_flags;
+    bool has_invalid = false;
 
     for (const auto& line : final_section) {
-        LOGGER.Info("{}", line);
+        m_output.info("{}", line);
 
-        std::string trimmed = trim(line);
-        if (trimmed.find("Final") == 0 || trimmed.empty()) continue;
+        std::string_view trimmed = trim(line);
+        if (starts_with(trimmed, "Final") || trimmed.empty()) continue;
 
         size_t colon_pos = trimmed.find(':');
-        if (colon_pos == std::string::npos) continue;
+        if (colon_pos == std::string_view::npos) continue;
 
-        std::string key = trim(trimmed.substr(0, colon_pos));
-        std::string value_str = trim(trimmed.substr(colon_pos + 1));
+        std::string_view key = trim(trimmed.substr(0, colon_pos));
+        std::string_view value_str = trim(trimmed.substr(colon_pos + 1));
 
         if (key == "flags") {
             expected_flags = value_str;
         } else {
             size_t hex_pos = value_str.find("0x");
-            if (hex_pos != std::string::npos) {
+            if (hex_pos != std::string_view::npos) {
                 size_t end_pos = value_str.find(' ', hex_pos);
-                std::string hex_val = value_str.substr(hex_pos + 2, end_pos - hex_pos - 2);
-                uint16_t reg_value = static_cast<uint16_t>(std::stoul(hex_val, nullptr, 16));
-                expected_regs[key] = reg_value;
+                std::string_view hex_val = value_str.substr(hex_pos + 2, end_pos - hex_pos - 2);
+                uint16_t reg_value = 0;
+                if (!parse_hex(hex_val, reg_value)) {
+                    m_output.error("Invalid hex value in final state: {}", hex_val);
+                    has_invalid = true;
+                    continue;
+                }
+                auto existing = std::find_if(expected_regs.begin(), expected_regs.end(),
+                                             [&](const FinalRegister& reg) { return reg.name == key; });
+                if (existing != expected_regs.end()) {
+                    existing->value = reg_value;
+                } else {
+                    expected_regs.push_back({key, reg_value});
+                }
             }
         }
     }
 
-    LOGGER.Info("");
-    LOGGER.Info("Actual final state:");
+    m_output.info("");
+    m_output.info("Actual final state:");
 
-    bool has_diff = false;
+    bool has_diff = has_invalid;
     std::ostringstream actual_output;
 
     for (const auto& [reg_name, expected_value] : expected_regs) {
+        RegisterId id = register_id_from_name(reg_name);
         uint16_t actual_value = 0;
-        if (m_regs.is16(reg_name)) {
-            actual_value = m_regs.get16(reg_name);
+        if (is_16bit_register(id)) {
+            actual_value = m_regs.read(id);
         }
 
         actual_output << "      " << reg_name << ": 0x" << std::hex << std::setw(4) << std::setfill('0')
@@ -325,6 +941,7 @@ void Simulator::compare_final_state(const std::vector<std::string>& final_sectio
         actual_output << "\n";
     }
 
+    m_regs.materialize_flags();
     std::string actual_flags_str;
     if (m_regs.flags.CF) actual_flags_str += "C";
     if (m_regs.flags.PF) actual_flags_str += "P";
@@ -341,9 +958,10 @@ void Simulator::compare_final_state(const std::vector<std::string>& final_sectio
         has_diff = true;
     }
 
-    LOGGER.Info("{}", actual_output.str());
+    m_output.info("{}", actual_output.str());
 
     if (!has_diff) {
-        LOGGER.Info("\nAll final state values match!");
+        m_output.info("\nAll final state values match!");
     }
+    return !has_diff;
 }
@@ -0,0 +1,397 @@
+#include <chrono>
+#include <stdexcept>
+#include "logger.h"
+#include "simulator_daemon.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+SimulatorDaemon::SimulatorDaemon(std::string socket_path, size_t thread_count, const ProgramCache* program_cache)
+    : m_socket_path(std::move(socket_path)), m_program_cache(program_cache), m_pool(thread_count) {}
+
+DaemonResponse SimulatorDaemon::run(DaemonRequest request) {
+    DaemonResponse response;
+    std::unique_ptr<Simulator> sim = acquire_simulator();
+    sim->set_lazy_flags(request.lazy_flags);
+    sim->set_alu_kernel(request.alu_kernel);
+    sim->set_cycle_model(request.cycle_model);
+    sim->set_max_steps(request.max_steps);
+    sim->set_program_cache(m_program_cache);
+    sim->output().set_buffered(true, request.capture_debug);
+
+    if (request.source == DaemonSource::Path) {
+        SimStatus status = sim->try_run_simulation(request.program, response.result);
+        response.ran = status == SimStatus::Ok;
+        if (!response.ran) response.error = status_message(status, Opcode::Invalid, request.program);
+    } else {
+        try {
+            Program program = sim->load_text(std::move(request.program));
+            response.result = sim->run_program(program);
+            response.ran = true;
+        } catch (const std::exception& e) {
+            response.error = e.what();
+        }
+    }
+
+    response.final_registers = sim->get_registers().dump();
+    sim->output().drain([&](OutputLevel level, std::string text) {
+        response.output.push_back({level, std::move(text)});
+    });
+    release_simulator(std::move(sim));
+    return response;
+}
+
+std::unique_ptr<Simulator> SimulatorDaemon::acquire_simulator() {
+    {
+        std::lock_guard<std::mutex> lock(m_simulators_mutex);
+        if (!m_idle_simulators.empty()) {
+            std::unique_ptr<Simulator> sim = std::move(m_idle_simulators.back());
+            m_idle_simulators.pop_back();
+            return sim;
+        }
+    }
+    return std::make_unique<Simulator>();
+}
+
+void SimulatorDaemon::release_simulator(std::unique_ptr<Simulator> sim) {
+    sim->reset();
+    std::lock_guard<std::mutex> lock(m_simulators_mutex);
+    m_idle_simulators.push_back(std::move(sim));
+}
+
+#ifdef _WIN32
+
+void SimulatorDaemon::serve(const std::atomic<bool>&) {
+    throw std::runtime_error("The simulator daemon needs Unix domain sockets");
+}
+
+bool SimulatorDaemon::serve_request(int, const std::string&) {
+    return false;
+}
+
+void SimulatorDaemon::return_connection(int, std::string) {}
+
+DaemonClient::DaemonClient(const std::string&) {
+    throw std::runtime_error("The simulator daemon needs Unix domain sockets");
+}
+
+DaemonClient::~DaemonClient() = default;
+
+DaemonResponse DaemonClient::run(const DaemonRequest&) {
+    throw std::runtime_error("The simulator daemon needs Unix domain sockets");
+}
+
+#else
+
+namespace {
+
+// How long the accept loop waits before looking at `stop` again
+constexpr int STOP_POLL_MILLISECONDS = 200;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;   // A vanished peer is an error, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Owns a descriptor: a socket, or an end of the accept loop's wake pipe
+class Socket {
+public:
+    explicit Socket(int fd) : m_fd(fd) {}
+    ~Socket() {
+        if (m_fd >= 0) close(m_fd);
+    }
+
+    Socket(Socket&& other) noexcept : m_fd(other.release()) {}
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    int fd() const { return m_fd; }
+    int release() {
+        int fd = m_fd;
+        m_fd = -1;
+        return fd;
+    }
+
+private:
+    int m_fd;
+};
+
+std::string system_error(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+sockaddr_un socket_address(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path must be 1 to " + std::to_string(sizeof(address.sun_path) - 1) +
+                                 " characters: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+Socket open_socket() {
+    Socket socket_fd(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (socket_fd.fd() < 0) throw std::runtime_error(system_error("Cannot create socket"));
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(socket_fd.fd(), SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return socket_fd;
+}
+
+bool try_connect(int fd, const sockaddr_un& address) {
+    return connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+}
+
+Socket bind_listener(const std::string& path) {
+    sockaddr_un address = socket_address(path);
+    Socket listener = open_socket();
+    if (bind(listener.fd(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        if (errno != EADDRINUSE) throw std::runtime_error(system_error("Cannot bind " + path));
+
+        // Something is at the path: a live daemon answers, a stale socket does not
+        Socket probe = open_socket();
+        if (try_connect(probe.fd(), address)) {
+            throw std::runtime_error("A simulator daemon is already serving on " + path);
+        }
+        unlink(path.c_str());
+        if (bind(listener.fd(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            throw std::runtime_error(system_error("Cannot bind " + path));
+        }
+    }
+    if (listen(listener.fd(), SOMAXCONN) != 0) throw std::runtime_error(system_error("Cannot listen on " + path));
+    return listener;
+}
+
+void set_write_timeout(int fd) {
+    timeval timeout{};
+    timeout.tv_sec = CONNECTION_WRITE_TIMEOUT_SECONDS;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+bool write_all(int fd, const std::string& bytes) {
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t count = send(fd, bytes.data() + written, bytes.size() - written, SEND_FLAGS);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        written += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+bool read_all(int fd, char* out, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count = recv(fd, out + done, size - done, 0);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        done += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// Appends whatever has arrived on fd without waiting; false once the peer has
+// closed the connection or it failed
+bool receive_available(int fd, std::string& received) {
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t count = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (count > 0) {
+            received.append(chunk, static_cast<size_t>(count));
+            continue;
+        }
+        if (count == 0) return false;
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+// Moves the first whole frame's body out of `received`; false while it is incomplete
+bool take_frame(std::string& received, std::string& body) {
+    if (received.size() < DAEMON_FRAME_HEADER_SIZE) return false;
+    uint32_t size = frame_body_size(received.data());
+    if (size > MAX_DAEMON_FRAME_SIZE) throw std::runtime_error("Daemon message too large");
+    if (received.size() - DAEMON_FRAME_HEADER_SIZE < size) return false;
+    body.assign(received, DAEMON_FRAME_HEADER_SIZE, size);
+    received.erase(0, DAEMON_FRAME_HEADER_SIZE + size);
+    return true;
+}
+
+// A connection the accept loop holds between requests
+struct Connection {
+    Socket socket;
+    std::string received;   // Bytes of requests not yet taken
+    bool closed = false;    // The peer is done sending; requests already received are still answered
+};
+
+// False when the peer closed the connection before a whole frame arrived
+bool read_frame(int fd, std::string& body) {
+    char header[DAEMON_FRAME_HEADER_SIZE];
+    if (!read_all(fd, header, sizeof(header))) return false;
+    uint32_t size = frame_body_size(header);
+    if (size > MAX_DAEMON_FRAME_SIZE) throw std::runtime_error("Daemon message too large");
+    body.resize(size);
+    return read_all(fd, body.data(), size);
+}
+
+}  // namespace
+
+void SimulatorDaemon::serve(const std::atomic<bool>& stop) {
+    Socket listener = bind_listener(m_socket_path);
+
+    // Workers write a byte here when they hand a connection back, so the poll below wakes for it
+    int wake_fds[2];
+    if (pipe(wake_fds) != 0) throw std::runtime_error(system_error("Cannot create the daemon wake pipe"));
+    Socket wake_read(wake_fds[0]);
+    Socket wake_write(wake_fds[1]);
+    set_nonblocking(wake_read.fd());
+    set_nonblocking(wake_write.fd());   // A full pipe already has a wake-up pending
+    m_wake_fd = wake_write.fd();
+
+    LOGGER.Info("Serving on {} with {} threads", m_socket_path, m_pool.thread_count());
+
+    // Connections between requests; polled after the listener and the wake pipe
+    std::vector<Connection> idle;
+    std::vector<pollfd> entries;
+    while (!stop.load(std::memory_order_relaxed)) {
+        entries.clear();
+        entries.push_back({listener.fd(), POLLIN, 0});
+        entries.push_back({wake_read.fd(), POLLIN, 0});
+        for (const Connection& connection : idle) {
+            entries.push_back({connection.socket.fd(), POLLIN, 0});
+        }
+        int ready = poll(entries.data(), entries.size(), STOP_POLL_MILLISECONDS);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        std::vector<Connection> open;
+        for (size_t i = 0; i < idle.size(); ++i) {
+            if (entries[i + 2].revents != 0) {
+                idle[i].closed = !receive_available(idle[i].socket.fd(), idle[i].received);
+            }
+            open.push_back(std::move(idle[i]));
+        }
+
+        if (entries[1].revents != 0) {
+            char drained[64];
+            while (read(wake_read.fd(), drained, sizeof(drained)) > 0) {}
+            std::lock_guard<std::mutex> lock(m_returned_mutex);
+            for (auto& [fd, received] : m_returned_connections) {
+                open.push_back({Socket(fd), std::move(received), false});
+            }
+            m_returned_connections.clear();
+        }
+
+        if (entries[0].revents != 0) {
+            int fd = accept(listener.fd(), nullptr, nullptr);
+            if (fd >= 0) {   // Otherwise interrupted, or the client gave up before we got to it
+                set_write_timeout(fd);
+                open.push_back({Socket(fd), std::string(), false});
+            }
+        }
+
+        // Each connection with a whole request leaves the loop until its response is written
+        idle.clear();
+        for (Connection& connection : open) {
+            std::string body;
+            try {
+                if (!take_frame(connection.received, body)) {
+                    if (!connection.closed) idle.push_back(std::move(connection));
+                    continue;
+                }
+            } catch (const std::exception& e) {
+                LOGGER.Warn("Dropped a daemon connection: {}", e.what());
+                continue;
+            }
+            int fd = connection.socket.release();
+            m_pool.submit([this, fd, body = std::move(body), received = std::move(connection.received)]() mutable {
+                Socket socket(fd);
+                try {
+                    if (!serve_request(socket.fd(), body)) return;
+                } catch (const std::exception& e) {
+                    LOGGER.Warn("Dropped a daemon connection: {}", e.what());
+                    return;
+                }
+                return_connection(socket.release(), std::move(received));
+            });
+        }
+    }
+
+    LOGGER.Info("Stopping; finishing requests in flight");
+    m_pool.wait_idle();
+    {
+        std::lock_guard<std::mutex> lock(m_returned_mutex);
+        for (const auto& returned : m_returned_connections) {
+            close(returned.first);
+        }
+        m_returned_connections.clear();
+    }
+    m_wake_fd = -1;
+    unlink(m_socket_path.c_str());
+}
+
+bool SimulatorDaemon::serve_request(int fd, const std::string& body) {
+    auto start = std::chrono::steady_clock::now();
+    DaemonResponse response;
+    try {
+        response = run(decode_request(body));
+    } catch (const std::exception& e) {
+        response.error = e.what();
+    }
+    if (!write_all(fd, encode_response(response))) return false;
+
+    LOGGER.Debug("Served a request in {} ms: {} instructions, {} errors, {} mismatches",
+                 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+                 response.result.instructions, response.result.errors, response.result.mismatches);
+    return true;
+}
+
+void SimulatorDaemon::return_connection(int fd, std::string received) {
+    {
+        std::lock_guard<std::mutex> lock(m_returned_mutex);
+        m_returned_connections.emplace_back(fd, std::move(received));
+    }
+    // Failing with EAGAIN is fine: the full pipe holds wake-ups the loop has yet to read
+    char wake = 0;
+    [[maybe_unused]] ssize_t written = write(m_wake_fd, &wake, 1);
+}
+
+DaemonClient::DaemonClient(const std::string& socket_path) {
+    sockaddr_un address = socket_address(socket_path);
+    Socket connection = open_socket();
+    if (!try_connect(connection.fd(), address)) {
+        throw std::runtime_error(system_error("Cannot connect to the simulator daemon at " + socket_path));
+    }
+    m_fd = connection.release();
+}
+
+DaemonClient::~DaemonClient() {
+    if (m_fd >= 0) close(m_fd);
+}
+
+DaemonResponse DaemonClient::run(const DaemonRequest& request) {
+    if (!write_all(m_fd, encode_request(request))) {
+        throw std::runtime_error(system_error("Cannot send to the simulator daemon"));
+    }
+    std::string body;
+    if (!read_frame(m_fd, body)) throw std::runtime_error("The simulator daemon closed the connection");
+    return decode_response(body);
+}
+
+#endif
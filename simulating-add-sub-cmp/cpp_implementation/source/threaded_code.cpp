@@ -0,0 +1,167 @@
+#include <array>
+#include <utility>
+#include "executor.h"
+#include "registers.h"
+#include "threaded_code.h"
+
+// Label addresses (`&&label`, `goto *ptr`) are a GNU extension, available in GCC and Clang
+#if defined(__GNUC__)
+#define SIMULATOR_COMPUTED_GOTO 1
+#else
+#define SIMULATOR_COMPUTED_GOTO 0
+#endif
+
+namespace {
+
+constexpr size_t KIND_VARIANTS = 4;  // 16-bit reg, 16-bit imm, 8-bit reg, 8-bit imm
+
+ThreadedKind thread_kind(const Instruction& instr) {
+    bool immediate = instr.src_kind == OperandKind::Immediate;
+    if (instr.dest_kind != OperandKind::Register || (!immediate && instr.src_kind != OperandKind::Register)) {
+        return ThreadedKind::Exit;
+    }
+    // Handlers read a register source at the operand width. The compiler rejects
+    // mismatched pairs; anything else that builds one runs on the generic path.
+    bool byte_operands = instr.width == OperandWidth::Byte;
+    if (!immediate && is_8bit_register(instr.src) != byte_operands) return ThreadedKind::Exit;
+
+    size_t base;
+    switch (instr.opcode) {
+        case Opcode::Mov: base = static_cast<size_t>(ThreadedKind::MovReg16); break;
+        case Opcode::Add: base = static_cast<size_t>(ThreadedKind::AddReg16); break;
+        case Opcode::Sub: base = static_cast<size_t>(ThreadedKind::SubReg16); break;
+        case Opcode::Cmp: base = static_cast<size_t>(ThreadedKind::CmpReg16); break;
+        default: return ThreadedKind::Exit;
+    }
+    size_t variant = (byte_operands ? 2 : 0) + (immediate ? 1 : 0);
+    return static_cast<ThreadedKind>(base + variant);
+}
+
+// Everything a handler does is fixed by its kind: the mov/add/sub/cmp group is
+// KIND / 4, bit 1 selects 8-bit operands and bit 0 an immediate source
+template <size_t KIND>
+inline void execute_kind(Registers& regs, const ThreadedOp& op) {
+    constexpr size_t GROUP = KIND / KIND_VARIANTS;
+    constexpr bool IS_8BIT = (KIND & 2) != 0;
+    constexpr bool IMMEDIATE = (KIND & 1) != 0;
+    constexpr FlagsOp OP = GROUP == 0 ? FlagsOp::None : GROUP == 1 ? FlagsOp::Add : FlagsOp::Sub;
+    constexpr bool STORE = GROUP != 3;  // cmp only sets flags
+
+    uint16_t operand;
+    if constexpr (IMMEDIATE) {
+        operand = op.immediate;  // Already masked to the operand width
+    } else if constexpr (IS_8BIT) {
+        operand = regs.get8<BenchPolicy>(op.src);
+    } else {
+        operand = regs.get16<BenchPolicy>(op.src);
+    }
+
+    uint16_t result = operand;
+    if constexpr (OP != FlagsOp::None) {
+        uint16_t old_val = IS_8BIT ? uint16_t(regs.get8<BenchPolicy>(op.dest)) : uint16_t(regs.get16<BenchPolicy>(op.dest));
+        result = execute_alu(regs, OP, old_val, operand, IS_8BIT);
+    }
+
+    if constexpr (STORE) {
+        if constexpr (IS_8BIT) {
+            regs.get8<BenchPolicy>(op.dest) = static_cast<uint8_t>(result);
+        } else {
+            regs.get16<BenchPolicy>(op.dest) = result;
+        }
+    }
+    regs.ip.value = static_cast<uint16_t>(regs.ip.value + op.size);
+}
+
+constexpr size_t HANDLER_COUNT = static_cast<size_t>(ThreadedKind::Exit);
+
+#if !SIMULATOR_COMPUTED_GOTO
+// Portable dispatch: each handler returns the next op. MSVC does not guarantee
+// tail calls, so chaining handlers directly could overflow the stack on long programs.
+using ThreadedHandler = const ThreadedOp* (*)(Registers& regs, const ThreadedOp* op);
+
+template <size_t KIND>
+const ThreadedOp* handle_kind(Registers& regs, const ThreadedOp* op) {
+    execute_kind<KIND>(regs, *op);
+    return op + 1;
+}
+
+template <size_t... KINDS>
+constexpr auto make_handlers(std::index_sequence<KINDS...>) {
+    return std::array<ThreadedHandler, sizeof...(KINDS)>{handle_kind<KINDS>...};
+}
+
+constexpr auto HANDLERS = make_handlers(std::make_index_sequence<HANDLER_COUNT>{});
+#endif
+
+}  // namespace
+
+std::vector<ThreadedOp> thread_instructions(const std::vector<Instruction>& instructions) {
+    std::vector<ThreadedOp> code;
+    code.reserve(instructions.size() + 1);
+
+    for (const Instruction& instr : instructions) {
+        ThreadedOp op{};
+        op.kind = thread_kind(instr);
+        op.dest = instr.dest;
+        op.src = instr.src;
+        op.size = instr.size;
+        op.immediate = instr.width == OperandWidth::Byte ? static_cast<uint16_t>(instr.immediate & 0xFF)
+                                                         : instr.immediate;
+        code.push_back(op);
+    }
+
+    ThreadedOp end{};
+    end.kind = ThreadedKind::End;
+    code.push_back(end);
+    return code;
+}
+
+#if SIMULATOR_COMPUTED_GOTO
+
+size_t run_threaded(Registers& regs, const ThreadedOp* code, size_t start) {
+    const ThreadedOp* op = code + start;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    // In ThreadedKind order
+    static const void* const LABELS[THREADED_KIND_COUNT] = {
+        &&kind_0, &&kind_1, &&kind_2, &&kind_3, &&kind_4, &&kind_5, &&kind_6, &&kind_7,
+        &&kind_8, &&kind_9, &&kind_10, &&kind_11, &&kind_12, &&kind_13, &&kind_14, &&kind_15,
+        &&stop, &&stop,
+    };
+    static_assert(HANDLER_COUNT == 16, "LABELS must list one label per handler");
+
+    // Every handler ends in its own indirect jump, so each one gets its own
+    // branch history instead of sharing a single dispatch branch
+#define DISPATCH() goto *LABELS[static_cast<size_t>(op->kind)]
+#define HANDLER(KIND)                  \
+    kind_##KIND:                       \
+    execute_kind<KIND>(regs, *op);     \
+    ++op;                              \
+    DISPATCH();
+
+    DISPATCH();
+    HANDLER(0) HANDLER(1) HANDLER(2) HANDLER(3)
+    HANDLER(4) HANDLER(5) HANDLER(6) HANDLER(7)
+    HANDLER(8) HANDLER(9) HANDLER(10) HANDLER(11)
+    HANDLER(12) HANDLER(13) HANDLER(14) HANDLER(15)
+
+#undef HANDLER
+#undef DISPATCH
+#pragma GCC diagnostic pop
+
+stop:
+    return static_cast<size_t>(op - code);
+}
+
+#else
+
+size_t run_threaded(Registers& regs, const ThreadedOp* code, size_t start) {
+    const ThreadedOp* op = code + start;
+    while (op->kind < ThreadedKind::Exit) {
+        op = HANDLERS[static_cast<size_t>(op->kind)](regs, op);
+    }
+    return static_cast<size_t>(op - code);
+}
+
+#endif
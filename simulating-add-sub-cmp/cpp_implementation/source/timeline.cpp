@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <stdexcept>
+#include "effective_address.h"
+#include "executor.h"
+#include "timeline.h"
+
+Timeline::Timeline(Registers& regs, Memory& memory, const Program& program, uint32_t checkpoint_interval)
+    : m_regs(regs), m_memory(memory), m_program(program), m_interval(checkpoint_interval) {
+    if (m_interval == 0) {
+        throw std::runtime_error("Checkpoint interval must be positive");
+    }
+    m_regs.materialize_flags();
+    m_regs.discard_changes();
+    m_checkpoints.push_back({m_regs, 0, m_next, 0});
+}
+
+bool Timeline::step() {
+    if (finished()) return false;
+
+    if (m_cursor < m_steps.size()) {
+        // Already recorded: execute again, the journal entries are still valid
+        m_next = execute_next(false);
+    } else {
+        record_step();
+    }
+    m_cursor++;
+    return true;
+}
+
+// Executes the instruction at m_next and returns the one after it. When recording,
+// memory destinations are journaled; register changes are left in the change set.
+uint32_t Timeline::execute_next(bool record) {
+    const Instruction& instr = m_program.instructions[m_next];
+    const ProgramLine& info = m_program.lines[m_next];
+    uint32_t next = m_next + 1;
+
+    m_regs.discard_changes();
+    if (instr.opcode == Opcode::Invalid) return next;
+
+    uint32_t address = 0;
+    if (record && instr.dest_kind == OperandKind::Memory) {
+        address = effective_address(m_regs, instr);
+        uint16_t old_value = instr.width == OperandWidth::Byte ? m_memory.read8(address) : m_memory.read16(address);
+        m_memory_journal.push_back({address, old_value, old_value, instr.width});
+    }
+
+    bool taken = false;
+    if (is_jump(instr.opcode)) {
+        taken = execute_branch<TracePolicy>(m_regs, instr);
+        if (taken) {
+            if (info.jump_target == INVALID_JUMP_TARGET) {
+                throw std::runtime_error("Jump target is outside the program");
+            }
+            next = info.jump_target;
+        }
+    } else {
+        execute_instruction<TracePolicy>(m_regs, m_memory, instr);
+    }
+    advance_ip<TracePolicy>(m_regs, instr, taken);
+    m_regs.materialize_flags();
+
+    if (record && instr.dest_kind == OperandKind::Memory) {
+        m_memory_journal.back().new_value =
+            instr.width == OperandWidth::Byte ? m_memory.read8(address) : m_memory.read16(address);
+    }
+    return next;
+}
+
+void Timeline::record_step() {
+    StepRecord record{m_next, static_cast<uint32_t>(m_register_journal.size()),
+                      static_cast<uint32_t>(m_memory_journal.size())};
+    m_regs.materialize_flags();
+    uint16_t old_flags = m_regs.flags.value;
+
+    uint32_t next;
+    try {
+        next = execute_next(true);
+    } catch (...) {
+        // Roll back whatever the failed step already changed
+        m_regs.materialize_flags();
+        m_regs.flags.value = old_flags;
+        ChangeSet partial = m_regs.get_last_changes();
+        for (size_t i = partial.register_changes.size(); i-- > 0;) {
+            const RegisterChange& change = partial.register_changes.items[i];
+            m_regs.write(change.id, change.old_value);
+        }
+        move_memory(static_cast<uint32_t>(m_memory_journal.size()), record.memory_journal_start);
+        m_memory_journal.resize(record.memory_journal_start);
+        throw;
+    }
+
+    for (const RegisterChange& change : m_regs.get_last_changes().register_changes) {
+        m_register_journal.push_back({change.id, change.old_value});
+    }
+    if (m_regs.flags.value != old_flags) {
+        m_register_journal.push_back({RegisterId::None, old_flags});
+    }
+
+    m_steps.push_back(record);
+    m_next = next;
+    if (m_steps.size() % m_interval == 0) {
+        m_checkpoints.push_back({m_regs, m_steps.size(), m_next, static_cast<uint32_t>(m_memory_journal.size())});
+    }
+}
+
+bool Timeline::step_back() {
+    if (m_cursor == 0) return false;
+
+    const StepRecord& record = m_steps[m_cursor - 1];
+    uint32_t end = m_cursor < m_steps.size() ? m_steps[m_cursor].register_journal_start
+                                             : static_cast<uint32_t>(m_register_journal.size());
+    for (uint32_t i = end; i-- > record.register_journal_start;) {
+        const RegisterUndo& undo = m_register_journal[i];
+        if (undo.id == RegisterId::None) {
+            m_regs.flags.value = undo.old_value;
+        } else {
+            m_regs.write(undo.id, undo.old_value);
+        }
+    }
+    move_memory(memory_position(m_cursor), record.memory_journal_start);
+
+    m_next = record.instruction;
+    m_cursor--;
+    return true;
+}
+
+void Timeline::seek(uint64_t target) {
+    // The nearest checkpoint at or before the target, as far as it has been recorded
+    size_t index = static_cast<size_t>(std::min<uint64_t>(target / m_interval, m_checkpoints.size() - 1));
+    const Checkpoint& checkpoint = m_checkpoints[index];
+    if (target < m_cursor || checkpoint.step > m_cursor) {
+        restore_checkpoint(checkpoint);
+    }
+    while (m_cursor < target && step()) {
+    }
+}
+
+void Timeline::restore_checkpoint(const Checkpoint& checkpoint) {
+    move_memory(memory_position(m_cursor), checkpoint.memory_journal_size);
+    m_regs = checkpoint.regs;
+    m_next = checkpoint.next;
+    m_cursor = checkpoint.step;
+}
+
+// Memory as it was before step `step`, as a memory journal position
+uint32_t Timeline::memory_position(uint64_t step) const {
+    return step < m_steps.size() ? m_steps[step].memory_journal_start : static_cast<uint32_t>(m_memory_journal.size());
+}
+
+// Moves memory between journal positions: undoing writes going back, redoing them going forward
+void Timeline::move_memory(uint32_t from, uint32_t to) {
+    for (uint32_t i = from; i > to; --i) {
+        const MemoryWrite& write = m_memory_journal[i - 1];
+        if (write.width == OperandWidth::Byte) {
+            m_memory.write8(write.address, static_cast<uint8_t>(write.old_value));
+        } else {
+            m_memory.write16(write.address, write.old_value);
+        }
+    }
+    for (uint32_t i = from; i < to; ++i) {
+        const MemoryWrite& write = m_memory_journal[i];
+        if (write.width == OperandWidth::Byte) {
+            m_memory.write8(write.address, static_cast<uint8_t>(write.new_value));
+        } else {
+            m_memory.write16(write.address, write.new_value);
+        }
+    }
+}
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include "register_types.h"
+#include "trace.h"
+
+static constexpr char TRACE_MAGIC[8] = {'S', 'I', 'M', 'T', 'R', 'A', 'C', 'E'};
+static constexpr uint8_t TRACE_VERSION = 1;
+static constexpr uint8_t TRACE_TAG_REGISTER_MASK = 0x1F;
+static constexpr uint8_t TRACE_TAG_FLAGS = 0x20;
+static constexpr size_t TRACE_WRITE_CHUNK = 64 * 1024;
+
+static void append_hex(std::string& out, uint16_t value) {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    char digits[4];
+    int count = 0;
+    do {
+        digits[count++] = DIGITS[value & 0xF];
+        value = static_cast<uint16_t>(value >> 4);
+    } while (value != 0);
+    while (count > 0) out += digits[--count];
+}
+
+void append_register_change(std::string& out, RegisterId id, uint16_t old_value, uint16_t new_value) {
+    out += register_name(id);
+    out += ":0x";
+    append_hex(out, old_value);
+    out += "->0x";
+    append_hex(out, new_value);
+    out += ' ';
+}
+
+void append_flag_change(std::string& out, uint16_t mask, bool old_value, bool new_value) {
+    out += Flags::name(mask);
+    out += old_value ? ":1->" : ":0->";
+    out += new_value ? "1 " : "0 ";
+}
+
+std::string format_changes(const ChangeSet& changes) {
+    std::string out;
+    for (const auto& change : changes.register_changes) {
+        append_register_change(out, change.id, change.old_value, change.new_value);
+    }
+    for (const auto& change : changes.flags_changes) {
+        append_flag_change(out, change.mask, change.old_value, change.new_value);
+    }
+    return out;
+}
+
+std::string format_trace_step(const TraceRecord* records, size_t count) {
+    std::string out;
+    uint16_t toggled = 0;
+    uint16_t set = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i].reg != RegisterId::None) {
+            append_register_change(out, records[i].reg, records[i].old_value, records[i].new_value);
+        }
+        toggled |= records[i].flags_toggled;
+        set |= records[i].flags_set;
+    }
+    for (uint16_t mask : TRACED_FLAGS) {
+        if (toggled & mask) {
+            bool new_value = (set & mask) != 0;
+            append_flag_change(out, mask, !new_value, new_value);
+        }
+    }
+    return out;
+}
+
+// --- TraceBuffer ---
+
+TraceBuffer::TraceBuffer(size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+    m_records.resize(rounded);
+    m_mask = rounded - 1;
+}
+
+void TraceBuffer::push(const TraceRecord& record) {
+    if (m_head - m_tail == m_records.size()) {
+        if (m_writer) {
+            flush();
+        } else {
+            m_tail++;
+            m_dropped++;
+        }
+    }
+    m_records[static_cast<size_t>(m_head) & m_mask] = record;
+    m_head++;
+}
+
+void TraceBuffer::record_step(uint32_t step, const ChangeSet& changes) {
+    if (!changes.has_changes()) return;
+
+    uint16_t toggled = 0;
+    uint16_t set = 0;
+    for (const auto& change : changes.flags_changes) {
+        toggled = static_cast<uint16_t>(toggled | change.mask);
+        if (change.new_value) set = static_cast<uint16_t>(set | change.mask);
+    }
+
+    size_t register_count = changes.register_changes.size();
+    if (register_count == 0) {
+        push({step, 0, 0, toggled, set, RegisterId::None, {}});
+        return;
+    }
+
+    for (size_t i = 0; i < register_count; ++i) {
+        const RegisterChange& change = changes.register_changes.items[i];
+        bool last = i + 1 == register_count;
+        push({step, change.old_value, change.new_value,
+              last ? toggled : uint16_t(0), last ? set : uint16_t(0), change.id, {}});
+    }
+}
+
+void TraceBuffer::flush() {
+    if (!m_writer) return;
+
+    // The retained records are at most two contiguous runs of the ring
+    while (m_tail != m_head) {
+        size_t start = static_cast<size_t>(m_tail) & m_mask;
+        size_t run = std::min(static_cast<size_t>(m_head - m_tail), m_records.size() - start);
+        m_writer->write(&m_records[start], run);
+        m_tail += run;
+    }
+}
+
+// --- TraceWriter ---
+
+static void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+TraceWriter::TraceWriter(const std::string& path) : m_file(path, std::ios::binary | std::ios::trunc) {
+    if (!m_file) {
+        throw std::runtime_error("Cannot create trace file: " + path);
+    }
+    m_bytes.reserve(TRACE_WRITE_CHUNK + 64);
+    m_bytes.insert(m_bytes.end(), std::begin(TRACE_MAGIC), std::end(TRACE_MAGIC));
+    m_bytes.push_back(TRACE_VERSION);
+}
+
+TraceWriter::~TraceWriter() {
+    finish();
+}
+
+void TraceWriter::write(const TraceRecord* records, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const TraceRecord& record = records[i];
+
+        put_varint(m_bytes, record.step - m_state.last_step);
+        m_state.last_step = record.step;
+
+        bool has_flags = record.flags_toggled != 0;
+        m_bytes.push_back(static_cast<uint8_t>(static_cast<uint8_t>(record.reg) | (has_flags ? TRACE_TAG_FLAGS : 0)));
+
+        if (record.reg != RegisterId::None) {
+            uint16_t& last = m_state.last_value[static_cast<size_t>(record.reg)];
+            put_varint(m_bytes, record.old_value ^ last);
+            put_varint(m_bytes, record.new_value ^ record.old_value);
+            last = record.new_value;
+        }
+        if (has_flags) {
+            put_varint(m_bytes, record.flags_toggled);
+            put_varint(m_bytes, record.flags_set);
+        }
+
+        if (m_bytes.size() >= TRACE_WRITE_CHUNK) flush_bytes();
+    }
+    m_records_written += count;
+}
+
+void TraceWriter::flush_bytes() {
+    // A failed stream stays failed, so later chunks are dropped and finish() reports it
+    if (m_file.write(reinterpret_cast<const char*>(m_bytes.data()), static_cast<std::streamsize>(m_bytes.size()))) {
+        m_bytes_written += m_bytes.size();
+    }
+    m_bytes.clear();
+}
+
+bool TraceWriter::finish() {
+    if (m_file.is_open()) {
+        flush_bytes();
+        m_file.close();
+    }
+    return !m_file.fail();
+}
+
+// --- TraceReader ---
+
+TraceReader::TraceReader(const std::string& path) : m_pos(sizeof(TRACE_MAGIC) + 1) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open trace file: " + path);
+    }
+    m_bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    if (m_bytes.size() < m_pos || std::memcmp(m_bytes.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        throw std::runtime_error("Not a simulator trace file: " + path);
+    }
+    if (m_bytes[sizeof(TRACE_MAGIC)] != TRACE_VERSION) {
+        throw std::runtime_error("Unsupported trace version " + std::to_string(m_bytes[sizeof(TRACE_MAGIC)]));
+    }
+}
+
+uint64_t TraceReader::read_varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (m_pos >= m_bytes.size()) {
+            throw std::runtime_error("Truncated trace record");
+        }
+        uint8_t byte = m_bytes[m_pos++];
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("Malformed varint in trace");
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    if (m_pos == m_bytes.size()) return false;
+
+    record = TraceRecord{};
+    record.step = m_state.last_step + static_cast<uint32_t>(read_varint());
+    m_state.last_step = record.step;
+
+    if (m_pos >= m_bytes.size()) {
+        throw std::runtime_error("Truncated trace record");
+    }
+    uint8_t tag = m_bytes[m_pos++];
+    uint8_t reg = tag & TRACE_TAG_REGISTER_MASK;
+    if (reg > static_cast<uint8_t>(RegisterId::None)) {
+        throw std::runtime_error("Invalid register id in trace");
+    }
+    record.reg = static_cast<RegisterId>(reg);
+
+    if (record.reg != RegisterId::None) {
+        uint16_t& last = m_state.last_value[reg];
+        record.old_value = static_cast<uint16_t>(last ^ read_varint());
+        record.new_value = static_cast<uint16_t>(record.old_value ^ read_varint());
+        last = record.new_value;
+    }
+    if (tag & TRACE_TAG_FLAGS) {
+        record.flags_toggled = static_cast<uint16_t>(read_varint());
+        record.flags_set = static_cast<uint16_t>(read_varint());
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+#include "work_stealing_pool.h"
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::thread::hardware_concurrency();
+        if (thread_count == 0) thread_count = 1;
+    }
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        m_threads.emplace_back(&WorkStealingPool::worker_loop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    // Count the task before it becomes visible so a worker that takes it at once
+    // can never drive the counters below zero
+    {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        m_queued++;
+        m_unfinished++;
+    }
+    size_t index = m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_work_available.notify_one();
+}
+
+void WorkStealingPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(m_state_mutex);
+    m_idle.wait(lock, [this] { return m_unfinished == 0; });
+}
+
+bool WorkStealingPool::try_take(size_t index, std::function<void()>& task) {
+    // Own queue first, newest task (still warm in cache)
+    {
+        WorkerQueue& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest task from the next non-empty victim
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        WorkerQueue& victim = *m_queues[(index + offset) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::worker_loop(size_t index) {
+    for (;;) {
+        std::function<void()> task;
+        if (try_take(index, task)) {
+            {
+                std::lock_guard<std::mutex> lock(m_state_mutex);
+                m_queued--;
+            }
+            task();
+            bool idle;
+            {
+                std::lock_guard<std::mutex> lock(m_state_mutex);
+                idle = --m_unfinished == 0;
+            }
+            if (idle) m_idle.notify_all();
+            continue;
+        }
+
+        // A task submitted while we were scanning is already counted in m_queued,
+        // so we go round again instead of sleeping through it
+        std::unique_lock<std::mutex> lock(m_state_mutex);
+        m_work_available.wait(lock, [this] { return m_stopping || m_queued > 0; });
+        if (m_stopping && m_queued == 0) return;
+    }
+}
@@ -0,0 +1,174 @@
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include "configs_loader.h"
+#include "cycles.h"
+#include "logger.h"
+#include "simulator_daemon.h"
+
+// Runs one listing on a daemon started with simulator_main --serve and logs what
+// it sends back exactly as simulator_main would have logged it, so scripts can
+// switch between the two by changing the binary and adding --socket
+
+struct ClientConfigs {
+    Config<std::string> socket{
+        "socket",
+        nullptr,
+        "--socket",
+        "Unix domain socket the daemon serves on",
+        true,
+        ""
+    };
+
+    Config<std::string> input_file{
+        "input_file",
+        nullptr,
+        "--input",
+        "Path to assembly file to simulate",
+        false,
+        ""
+    };
+
+    Config<bool> read_stdin{
+        "stdin",
+        nullptr,
+        "--stdin",
+        "Send the listing read from standard input instead of a path",
+        false,
+        false
+    };
+
+    Config<bool> lazy_flags{
+        "lazy_flags",
+        nullptr,
+        "--lazy-flags",
+        "Compute flags only when they are read",
+        false,
+        false
+    };
+
+    Config<std::string> alu_kernel{
+        "alu_kernel",
+        nullptr,
+        "--alu",
+        "ALU kernel for add/sub/cmp: reference or table",
+        false,
+        "reference"
+    };
+
+    Config<int> max_steps{
+        "max_steps",
+        nullptr,
+        "--max-steps",
+        "Stop a program that has not finished after this many instructions (0 = no limit)",
+        false,
+        1000000
+    };
+
+    Config<std::string> cycles{
+        "cycles",
+        nullptr,
+        "--cycles",
+        "Estimate clocks per traced step and per listing: off, 8086 or 8088",
+        false,
+        "off"
+    };
+
+    Config<std::string> verbosity{
+        "verbosity",
+        "-v",
+        "--verbosity",
+        "Set log verbosity level",
+        false,
+        "info"
+    };
+
+    auto get_all_configs() {
+        return std::tie(socket, input_file, read_stdin, lazy_flags, alu_kernel, max_steps, cycles, verbosity);
+    }
+
+    auto get_all_configs() const {
+        return std::tie(socket, input_file, read_stdin, lazy_flags, alu_kernel, max_steps, cycles, verbosity);
+    }
+};
+
+static void log_output(const DaemonOutputLine& line) {
+    switch (line.level) {
+        case OutputLevel::Debug: LOGGER.Debug("{}", line.text); break;
+        case OutputLevel::Info:  LOGGER.Info("{}", line.text); break;
+        case OutputLevel::Warn:  LOGGER.Warn("{}", line.text); break;
+        case OutputLevel::Error: LOGGER.Error("{}", line.text); break;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    ConfigsLoader<ClientConfigs> configs(argv[0]);
+
+    bool parsed = configs.parse_and_validate(argc, argv);
+    bool single_source = configs.input_file.was_provided != configs.read_stdin.value;
+
+    if (!parsed || !single_source) {
+        Logger::Config error_config;
+        error_config.print_metadata = false;
+        Logger::Init(error_config);
+        LOGGER.Error("{}", parsed ? "Exactly one of --input or --stdin is required" : configs.get_error());
+        configs.print_usage();
+        return 1;
+    }
+
+    Logger::Config logger_config;
+    if (configs.verbosity.was_provided) {
+        logger_config.level = Logger::ParseLogLevel(configs.verbosity.value);
+    }
+    Logger::Init(logger_config);
+
+    LOGGER.Info("=== Computer Enhance - 8086 Simulator ===");
+
+    DaemonRequest request;
+    request.lazy_flags = configs.lazy_flags.value;
+    request.capture_debug = configs.verbosity.value == "debug";
+
+    if (configs.alu_kernel.value == "table") {
+        request.alu_kernel = AluKernel::Table;
+    } else if (configs.alu_kernel.value != "reference") {
+        LOGGER.Error("Unknown ALU kernel: {}", configs.alu_kernel.value);
+        return 1;
+    }
+    if (!parse_cycle_model(configs.cycles.value, request.cycle_model)) {
+        LOGGER.Error("Unknown cycle model: {}", configs.cycles.value);
+        return 1;
+    }
+    if (configs.max_steps.value < 0) {
+        LOGGER.Error("Invalid step limit: {}", configs.max_steps.value);
+        return 1;
+    }
+    request.max_steps = static_cast<uint64_t>(configs.max_steps.value);
+
+    if (configs.read_stdin.value) {
+        request.source = DaemonSource::Text;
+        request.program.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    } else {
+        // The daemon has its own working directory
+        std::error_code ec;
+        std::filesystem::path path = std::filesystem::absolute(configs.input_file.value, ec);
+        request.program = ec ? configs.input_file.value : path.string();
+    }
+
+    try {
+        DaemonClient client(configs.socket.value);
+        DaemonResponse response = client.run(request);
+        for (const DaemonOutputLine& line : response.output) {
+            log_output(line);
+        }
+        if (!response.ran) {
+            LOGGER.Error("Simulator error: {}", response.error);
+            return 1;
+        }
+        LOGGER.Debug("Final registers: {}", response.final_registers);
+        return 0;
+    } catch (const std::exception& e) {
+        LOGGER.Error("Client error: {}", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,65 @@
+#include <stdexcept>
+#include <vector>
+#include "configs_loader.h"
+#include "logger.h"
+#include "trace.h"
+
+// Turns a binary trace written by simulator_main --trace-file back into the
+// "ax:0x0->0x1 ZF:0->1 " change text, one line per step
+
+struct TraceDumpConfigs {
+    Config<std::string> trace_file{
+        "trace_file",
+        nullptr,
+        "--trace",
+        "Path to binary trace file",
+        true,
+        ""
+    };
+
+    auto get_all_configs() {
+        return std::tie(trace_file);
+    }
+
+    auto get_all_configs() const {
+        return std::tie(trace_file);
+    }
+};
+
+static void log_step(const std::vector<TraceRecord>& records) {
+    LOGGER.Info("step {} ; {}", records.front().step, format_trace_step(records.data(), records.size()));
+}
+
+int main(int argc, char* argv[]) {
+    ConfigsLoader<TraceDumpConfigs> configs(argv[0]);
+
+    Logger::Config logger_config;
+    logger_config.print_metadata = false;
+    Logger::Init(logger_config);
+
+    if (!configs.parse_and_validate(argc, argv)) {
+        LOGGER.Error("{}", configs.get_error());
+        configs.print_usage();
+        return 1;
+    }
+
+    try {
+        TraceReader reader(configs.trace_file.value);
+        std::vector<TraceRecord> step_records;
+        TraceRecord record;
+        while (reader.next(record)) {
+            if (!step_records.empty() && record.step != step_records.front().step) {
+                log_step(step_records);
+                step_records.clear();
+            }
+            step_records.push_back(record);
+        }
+        if (!step_records.empty()) {
+            log_step(step_records);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        LOGGER.Error("Trace error: {}", e.what());
+        return 1;
+    }
+}